@@ -66,7 +66,7 @@ int_8 = ir.IntType(8)
 void_ptr = ir.PointerType(ir.IntType(8))
 void_ptr_ptr = ir.PointerType(void_ptr)
 any_struct = glbctx.get_identified_type("Any")
-any_struct.set_body(int_64, int_64, int_64, int_32, void_ptr)
+any_struct.set_body(int_32, int_32, int_32, int_32, void_ptr)
 any_ptr = any_struct.as_pointer()
 any_ptr_ptr = any_ptr.as_pointer()
 null_val = ir.FormattedConstant(any_ptr, 'null')
@@ -200,6 +200,12 @@ class LlvmGen(object):
                 int_64,
                 [any_ptr]),
             "foidl_return_code")
+        ir.Function(
+            self.module,
+            ir.FunctionType(
+                ir.VoidType(),
+                [any_ptr_ptr.as_pointer(), int_64]),
+            "foidl_gc_register_roots")
 
     def _emit_literals(self, litmap):
         """Declare private literal pointers"""
@@ -285,6 +291,35 @@ class LlvmGen(object):
         builder.ret_void()
         return linitname
 
+    def _emit_groots(self):
+        """Emits the collector root table for literals and variables"""
+        grootname = self.source + "_groots"
+        roots = [
+            g for g in self.module.global_values
+            if isinstance(g, ir.GlobalVariable)
+            and g.type.pointee == any_ptr
+            and g.initializer is not None]
+        fn = self._reg_global_voidfunc(grootname, 0)
+        fn.linkage = "private"
+        builder = ir.IRBuilder(fn.append_basic_block('entry'))
+        if roots:
+            table = ir.GlobalVariable(
+                self.module,
+                ir.ArrayType(any_ptr_ptr, len(roots)),
+                self.source + "_roots")
+            table.linkage = "private"
+            table.align = 8
+            table.initializer = ir.Constant.literal_array(roots)
+            builder.call(
+                builder.module.get_global("foidl_gc_register_roots"),
+                [builder.gep(
+                    table,
+                    [ir.Constant(int_64, 0), ir.Constant(int_64, 0)],
+                    inbounds=True),
+                 ir.Constant(int_64, len(roots))])
+        builder.ret_void()
+        return grootname
+
     def _emit_vinits(self):
         """Emits the variable initializers"""
         vinitname = self.source + "_vinits"
@@ -806,6 +841,8 @@ class LlvmGen(object):
         linits = self._emit_linits(ptree['literals'])
         # Emit variable initializers
         vinits = self._emit_vinits()
+        # Emit collector roots
+        groots = self._emit_groots()
         # Main processing
         if self.main:
             self._emit_main()
@@ -823,4 +860,5 @@ class LlvmGen(object):
         wrtr(_modinits0)
         wrtr("    call void @" + self.source + "_linits()")
         wrtr("    call void @" + self.source + "_vinits()")
+        wrtr("    call void @" + self.source + "_groots()")
         wrtr(_modinitret)
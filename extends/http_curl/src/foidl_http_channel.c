@@ -29,12 +29,14 @@ static int inited = 0;
 
 static PFRTAny chttp_desc;
 static PFRTAny curl_http_type_identifier;
-static ft curl_http_type_hash;
+static uint32_t curl_http_type_hash;
+
+// Must match the FRTIOChannel layout
 
 typedef struct   FRTIOHttpChannel {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to curl handle
     PFRTAny     ctype;
@@ -77,14 +79,28 @@ static size_t http_header_handler(char* b, size_t size, size_t nitems, void *use
     return numbytes;
 }
 
+//  curl_easy_perform waits on the network, it runs through
+//  foidl_gc_blocking so a collection does not wait on it
+
+typedef struct PerformRequest {
+    CURL        *curl;
+    CURLcode    res;
+} PerformRequest;
+
+static void blocked_perform(void *arg) {
+    PerformRequest *req = (PerformRequest *) arg;
+    req->res = curl_easy_perform(req->curl);
+}
+
 //  http_read_handler
-//  Read data callback, reads data in chunks into memory
+//  Read data callback, reads data in chunks into memory. Runs inside
+//  foidl_gc_blocking so it uses the C heap rather than the runtime
 
 static size_t http_read_handler(
     void *contents, size_t size,size_t nmemb, void *chunk) {
     size_t realsize = size * nmemb;
     struct Chunk *mem = (struct Chunk *)chunk;
-    char *ptr = foidl_xreall(mem->memory, mem->size + realsize + 1);
+    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
     mem->memory = ptr;
     memcpy(&(mem->memory[mem->size]), contents, realsize);
     mem->size += realsize;
@@ -97,25 +113,28 @@ PFRTAny foidl_channel_http_write_bang(PFRTAny channel, PFRTAny data) {
     PFRTIOHttpChannel http = (PFRTIOHttpChannel)channel;
     CURL *curl = http->value;
     CURLcode cres;
+    PerformRequest req = {curl, CURLE_OK};
     struct Chunk mem;
-    mem.memory = foidl_xall(1);
+    mem.memory = malloc(1);
     mem.size = 0;
     curl_easy_setopt(curl, CURLOPT_URL, http->name->value);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&mem);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data->value);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)data->count);
     //curl_easy_setopt(curl, CURLOPT_NOBODY, 1); // For debugging header only
-    cres = curl_easy_perform(curl);
+    foidl_gc_blocking(blocked_perform, &req);
+    cres = req.res;
 
     if(!cres) {
         result = (PFRTAny)
             allocResponse(
                 http->ftype,
-                (PFRTAny) allocStringWithCptr(mem.memory,strlen(mem.memory)));
+                (PFRTAny) allocStringWithCopyCnt(mem.size,mem.memory));
     }
     else {
         ;
     }
+    free(mem.memory);
     return result;
 }
 localFunc(curl_ch_write,2,foidl_channel_http_write_bang);
@@ -128,24 +147,27 @@ PFRTAny foidl_channel_http_read_bang(PFRTAny channel) {
     PFRTIOHttpChannel http = (PFRTIOHttpChannel)channel;
     CURL *curl = http->value;
     CURLcode cres;
+    PerformRequest req = {curl, CURLE_OK};
     struct Chunk mem;
-    mem.memory = foidl_xall(1);
+    mem.memory = malloc(1);
     mem.size = 0;
     curl_easy_setopt(curl, CURLOPT_URL, http->name->value);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&mem);
     //curl_easy_setopt(curl, CURLOPT_NOBODY, 1); // For debugging header only
-    cres = curl_easy_perform(curl);
+    foidl_gc_blocking(blocked_perform, &req);
+    cres = req.res;
 
     if(!cres) {
         result = (PFRTAny)
             allocResponse(
                 http->ftype,
-                (PFRTAny) allocStringWithCptr(mem.memory,strlen(mem.memory)));
+                (PFRTAny) allocStringWithCopyCnt(mem.size,mem.memory));
         //printf("Download size: %u\n", (int) mem.size);
     }
     else {
         ;
     }
+    free(mem.memory);
     return result;
 }
 localFunc(curl_ch_read,1,foidl_channel_http_read_bang);
@@ -224,7 +246,7 @@ PFRTAny     foidl_register_curl_http(PFRTAny tname) {
     if( ! inited ) {
         inited=1;
         curl_http_type_identifier = tname;
-        curl_http_type_hash = (ft) hash(tname);
+        curl_http_type_hash = hash(tname);
         foidl_rtl_init_http_channel();
         setup_desc(tname);
         foidl_channel_extension(chttp_desc);
@@ -33,6 +33,6 @@ EXTERNC void*   _string_to_regex(const char* s);
 EXTERNC int     _is_match(const char* s, const char* pattern);
 EXTERNC int     _is_matchp(const char* s, void* pattern);
 EXTERNC void    _reduce_tokens(const char*s, ptoken_block);
-EXTERNC void    _string_split(void *rlist, const char *strng, void* pattern);
+EXTERNC void    _string_split(void *rlist, PFRTAny s, void* pattern);
 EXTERNC PFRTAny foidl_format(PFRTAny bstr, PFRTAny bcoll);
 #endif
@@ -58,18 +58,36 @@ typedef pthread_mutex_t     foidl_note_t;
 
 static const ft 	global_signature = 0xefefefef00000000;
 static const ft     alloc_signature  = 0xfefefeff00000000;
-static const ft     unkwn_signature  = 0xeeeeeeeeeeeeeeee;
-
-static const ft 	scalar_class 	 = 0xfffffffffffffff1;
-static const ft 	collection_class = 0xfffffffffffffff2;
-static const ft 	function_class 	 = 0xfffffffffffffff3;
-static const ft 	io_class 		 = 0xfffffffffffffff4;
-static const ft 	hamptnode_class  = 0xfffffffffffffff5;
-static const ft 	bitmapnode_class = 0xfffffffffffffff6;
-static const ft     worker_class     = 0xfffffffffffffff7;
-static const ft     response_class   = 0xfffffffffffffff8;
-
-static const ft 	iterator_class	 = 0xfffffffffffffffe;
+static const ft     unkwn_signature  = 0xeeeeeeee00000000;
+static const ft     arena_signature  = 0xaeaeaeae00000000;
+static const ft     signature_mask   = 0xffffffff00000000;
+static const ft     slab_class_mask  = 0x00000000000007ff;	// MEMSIG.bytes
+static const ft     str_retired      = 0x0000000000000800;	// See FRTStrSlice
+static const ft     str_shared       = 0x0000000000001000;	// See FRTStrSlice
+static const ft     raw_root         = 0x0000000000002000;	// See foidl_xall_root
+static const ft     str_builder      = 0x0000000000004000;	// See FRTStrBuffer
+static const ft     str_slice        = 0x0000000000008000;	// See FRTStrSlice
+static const ft     arena_size_mask  = 0x00000000ffffffff;
+static const ft     ref_one          = 0x0000000000010000;	// MEMSIG.refs
+static const ft     ref_mask         = 0x000000003fff0000;
+static const ft     ref_orphan       = 0x0000000040000000;
+static const ft     gc_mark          = 0x0000000080000000;
+
+//	Class and type tags are 32 bits and share the first header word
+
+static const ft 	scalar_class 	 = 0xfffffff1;
+static const ft 	collection_class = 0xfffffff2;
+static const ft 	function_class 	 = 0xfffffff3;
+static const ft 	io_class 		 = 0xfffffff4;
+static const ft 	hamptnode_class  = 0xfffffff5;
+static const ft 	bitmapnode_class = 0xfffffff6;
+static const ft     worker_class     = 0xfffffff7;
+static const ft     response_class   = 0xfffffff8;
+static const ft     rrbnode_class    = 0xfffffff9;
+static const ft     sortnode_class   = 0xfffffffa;
+static const ft     primdata_class   = 0xfffffffb;
+
+static const ft 	iterator_class	 = 0xfffffffe;
 
 //
 //	Type identifiers
@@ -77,67 +95,82 @@ static const ft 	iterator_class	 = 0xfffffffffffffffe;
 
 //	Support types
 
-static const ft 	nil_type 		= 0xffffffffe00000ad;
-static const ft 	end_type 		= 0xffffffffe00000aa;
+static const ft 	nil_type 		= 0xe00000ad;
+static const ft 	end_type 		= 0xe00000aa;
 
 //	Scalar types
-static const ft 	byte_type   	= 0xffffffff100000ac;
-static const ft 	keyword_type    = 0xffffffff100000ab;
-static const ft 	string_type 	= 0xffffffff100000aa;
-static const ft 	boolean_type    = 0xffffffff100000a9;
-static const ft 	character_type  = 0xffffffff100000a8;
-static const ft     regex_type      = 0xffffffff100000a7;
+static const ft 	byte_type   	= 0x100000ac;
+static const ft 	keyword_type    = 0x100000ab;
+static const ft 	string_type 	= 0x100000aa;
+static const ft 	boolean_type    = 0x100000a9;
+static const ft 	character_type  = 0x100000a8;
+static const ft     regex_type      = 0x100000a7;
+
+static const ft 	integer_type 	= 0x1000a8a9; // Deprecated for number_type
+static const ft     number_type     = 0x1000a8a8;
+
+//	Number representations, kept in the count of a number_type
 
-static const ft 	integer_type 	= 0xffffffff1000a8a9; // Deprecated for number_type
-static const ft     number_type     = 0xffffffff1000a8a8;
+static const ft 	number_mapm 	= 1;	// value is a M_APM
+static const ft 	number_fixnum 	= 2;	// value is a 64 bit integer
+static const ft 	number_float 	= 3;	// value holds a double
 
 //	Collection types
 
-static const ft 	list2_type      = 0xffffffff100000cf;
-static const ft 	vector2_type 	= 0xffffffff100000ce;
-static const ft 	set2_type       = 0xffffffff100000cd;
-static const ft 	map2_type       = 0xffffffff100000cc;
+static const ft 	list2_type      = 0x100000cf;
+static const ft 	vector2_type 	= 0x100000ce;
+static const ft 	set2_type       = 0x100000cd;
+static const ft 	map2_type       = 0x100000cc;
 
-static const ft 	mapentry_type   = 0xffffffff100000cb;
-static const ft 	linknode_type   = 0xffffffff100000ca;
+static const ft 	mapentry_type   = 0x100000cb;
+static const ft 	linknode_type   = 0x100000ca;
 
-static const ft 	series_type     = 0xffffffff100000c9;
-static const ft 	reduced_type    = 0xffffffff100000c8;
+static const ft 	series_type     = 0x100000c9;
+static const ft 	reduced_type    = 0x100000c8;
+
+static const ft 	sortedmap_type  = 0x100000c7;
+static const ft 	sortedset_type  = 0x100000c6;
+
+static const ft 	bytearray_type  = 0x100000c5;
+static const ft 	intarray_type   = 0x100000c4;
+static const ft 	floatarray_type = 0x100000c3;
 
 //	Iterator types
 
-static const ft 	vector_iterator_type = 0xffffffff300000cf;
-static const ft 	map_iterator_type 	 = 0xffffffff300000ce;
-static const ft 	set_iterator_type 	 = 0xffffffff300000cd;
-static const ft 	list_iterator_type   = 0xffffffff300000cc;
-static const ft 	series_iterator_type = 0xffffffff300000cb;
-static const ft 	channel_iterator_type = 0xffffffff300000ca;
-static const ft     string_iterator_type = 0xffffffff300000c9;
+static const ft 	vector_iterator_type = 0x300000cf;
+static const ft 	map_iterator_type 	 = 0x300000ce;
+static const ft 	set_iterator_type 	 = 0x300000cd;
+static const ft 	list_iterator_type   = 0x300000cc;
+static const ft 	series_iterator_type = 0x300000cb;
+static const ft 	channel_iterator_type = 0x300000ca;
+static const ft     string_iterator_type = 0x300000c9;
+static const ft     sorted_iterator_type = 0x300000c8;
+static const ft     prim_iterator_type   = 0x300000c7;
 
 //	Function/Lambda/Worker types
 
-static const ft 	funcref_type  = 0xffffffff100000ef;
-static const ft 	lambref_type  = 0xffffffff100000ee;
-static const ft 	funcinst_type = 0xffffffff100000ed;
-static const ft     worker_type   = 0xffffffff100000ec;
-static const ft     thrdpool_type = 0xffffffff100000eb;
-static const ft     thread_type   = 0xffffffff100000ea;
-static const ft     pool_control  = 0xffffffff100000e9;
+static const ft 	funcref_type  = 0x100000ef;
+static const ft 	lambref_type  = 0x100000ee;
+static const ft 	funcinst_type = 0x100000ed;
+static const ft     worker_type   = 0x100000ec;
+static const ft     thrdpool_type = 0x100000eb;
+static const ft     thread_type   = 0x100000ea;
+static const ft     pool_control  = 0x100000e9;
 
 //	IO types
 
-static const ft 	file_type   = 0xffffffff100000bf;
-//static const ft 	http_type   = 0xffffffff100000be;
-static const ft 	ip_type     = 0xffffffff100000bd;
-static const ft 	mem_type  	= 0xffffffff100000bc;
-static const ft 	cin_type    = 0xffffffff100000bb;
-static const ft 	cout_type   = 0xffffffff100000ba;
-static const ft 	cerr_type   = 0xffffffff100000b9;
-static const ft 	closed_type = 0xffffffff100000b8;
+static const ft 	file_type   = 0x100000bf;
+//static const ft 	http_type   = 0x100000be;
+static const ft 	ip_type     = 0x100000bd;
+static const ft 	mem_type  	= 0x100000bc;
+static const ft 	cin_type    = 0x100000bb;
+static const ft 	cout_type   = 0x100000ba;
+static const ft 	cerr_type   = 0x100000b9;
+static const ft 	closed_type = 0x100000b8;
 
 // Response Types
 
-//static const ft     http_response_type   = 0xffffffff100000b7;
+//static const ft     http_response_type   = 0x100000b7;
 
 //	Other constants
 
@@ -158,41 +191,86 @@ typedef struct _MEMSIG {
 	uint16_t 	used;
 } MEMSIG;
 
+//	Object header: class and type tags share one word, count and
+//	hash the next, so a scalar is 24 bytes plus the hidden fsig
+
 typedef struct FRTTypeG {
 	ft 			fsig;
-	ft 			fclass;
-	ft 			ftype;
-	ft 			count;
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	count;
 	uint32_t	hash;
 	void 		*value;	 	// Maps to count on collections
 } *PFRTTypeG;
 
 typedef struct FRTType {
-	ft 			fclass;
-	ft 			ftype;
-	ft 			count;
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	count;
 	uint32_t	hash;
 	void 		*value;	 	// Maps to count on collections
 } FRTAny, *PFRTType, *PFRTAny,*PFRTCollection;
 
 #define ANYTOG(s) (PFRTTypeG) ((void *)s - sizeof(ft))
+#define SIGOF(g) ((g)->fsig & signature_mask)
+
+//	A string slice shares its characters with the string it was cut
+//	from, which it keeps alive. Slices are only cut where the character
+//	after them is, or may be made, a NUL so value is still a C string.
+//	The heap header carries str_slice, arenas copy instead. The owner
+//	is marked str_shared and update!/droplast! move it to new characters.
+//	The old ones are retired to the owner (str_retired) and go with it
+
+typedef struct FRTStrSlice {
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	count;
+	uint32_t	hash;
+	void 		*value;
+	PFRTAny 	owner;
+} *PFRTStrSlice;
+
+#define STR_SLICE(s) (SIGOF(ANYTOG(s)) == alloc_signature \
+	&& ((ANYTOG(s))->fsig & str_slice) != 0)
+
+#define STR_SHARED(s) (SIGOF(ANYTOG(s)) == alloc_signature \
+	&& ((ANYTOG(s))->fsig & str_shared) != 0)
+
+#define STR_RETIRED(s) (SIGOF(ANYTOG(s)) == alloc_signature \
+	&& ((ANYTOG(s))->fsig & str_retired) != 0)
+
+//	A string builder is a hidden buffer with room to grow, owned by
+//	the transient string (the tip slice) that extend! appends to in
+//	place. Cutting another slice from a builder closes it so the
+//	slice keeps its NUL
+
+typedef struct FRTStrBuffer {
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	fill;
+	uint32_t	capacity;
+	void 		*value;
+} *PFRTStrBuffer;
+
+#define STR_BUILDER(s) (SIGOF(ANYTOG(s)) == alloc_signature \
+	&& ((ANYTOG(s))->fsig & str_builder) != 0)
 
 // Special Types
 
 typedef struct FRTRegExG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;      // Copy over from string basis
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;      // Copy over from string basis
     uint32_t    hash;       // Copy over from string basis
     PFRTAny     value;      // Initial String
     void        *regex;     // Compiled regex
 } *PFRTRegExG;
 
 typedef struct FRTRegEx {
-    ft          fclass;
-    ft          ftype;
-    ft          count;      // Copy over from string basis
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;      // Copy over from string basis
     uint32_t    hash;       // Copy over from string basis
     PFRTAny     value;      // Initial String
     void        *regex;     // Compiled regex
@@ -205,29 +283,44 @@ typedef struct FRTRegEx {
 //	Vector structures
 
 typedef struct FRTHamtNode {
-	ft 					fclass;
+	uint32_t			fclass;
+	uint32_t			edit; 		//	Owning transient, 0 if none
 	PFRTAny 			slots[32];
 } *PFRTHamtNode;
 
+//	Relaxed node, a HAMT node whose children may be less than full.
+//	sizes holds the cumulative element count through each slot
+
+typedef struct FRTRrbNode {
+	uint32_t			fclass;
+	uint32_t			edit;
+	PFRTAny 			slots[32];
+	uint32_t 			sizes[32];
+} *PFRTRrbNode;
+
 typedef struct FRTVectorG {
 	ft 				fsig;
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Vector
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Vector
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTHamtNode 	root; 		// 	Root HAMT node
     PFRTHamtNode 	tail; 		//	Tail collection
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
+    ft 				unhashed; 	//	Hash to be computed on demand
 } *PFRTVectorG;
 
 typedef struct FRTVector {
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Vector
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Vector
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTHamtNode 	root; 		// 	Root HAMT node
     PFRTHamtNode 	tail; 		//	Tail collection
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
+    ft 				unhashed; 	//	Hash to be computed on demand
 } *PFRTVector;
 
 //	List structures
@@ -236,36 +329,48 @@ typedef struct FRTLinkNode *PFRTLinkNode;
 
 typedef struct FRTLinkNodeG {
 	ft 				fsig;
-	ft 				fclass; 	//	FOIDL Class - collection_class
-	ft 				ftype;		//	FOIDL Type - linknode_type
+	uint32_t		fclass; 	//	FOIDL Class - collection_class
+	uint32_t		ftype;		//	FOIDL Type - linknode_type
     PFRTAny 		data;
     PFRTLinkNode 	next;
 } *PFRTLinkNodeG;
 
 typedef struct FRTLinkNode {
-	ft 				fclass; 	//	FOIDL Class - collection_class
-	ft 				ftype;		//	FOIDL Type - linknode_type
+	uint32_t		fclass; 	//	FOIDL Class - collection_class
+	uint32_t		ftype;		//	FOIDL Type - linknode_type
     PFRTAny 		data;
     PFRTLinkNode 	next;
 } *PFRTLinkNode;
 
+//	Positional index of a list, every LIST_SKIP'th node. Built on
+//	demand and immutable once published
+
+typedef struct FRTListSkips {
+	ft 				count; 		//	Entries in nodes
+	PFRTLinkNode 	nodes[1];
+} *PFRTListSkips;
+
 typedef struct FRTListG {
 	ft 				fsig;
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Vector
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Vector
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTLinkNode 	root; 		// 	Root
-    PFRTLinkNode 	rest; 		// 	Last
+    PFRTLinkNode 	rest; 		// 	Second
+    PFRTLinkNode 	last; 		// 	Last
+    PFRTListSkips 	skips; 		//	Positional index or NULL
 } *PFRTListG;
 
 typedef struct FRTList {
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Vector
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Vector
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTLinkNode 	root; 		// 	Root HAMT node
-    PFRTLinkNode 	rest; 		// 	Last
+    PFRTLinkNode 	rest; 		// 	Second
+    PFRTLinkNode 	last; 		// 	Last
+    PFRTListSkips 	skips; 		//	Positional index or NULL
 } *PFRTList;
 
 
@@ -273,16 +378,18 @@ typedef struct FRTList {
 
 typedef struct FRTBitmapNodeG {
 	ft 					fsig;
-	ft 					fclass;
+	uint32_t			fclass;
 	uint32_t 			datamap;
 	uint32_t 			nodemap;
+	uint32_t			edit; 		//	Owning transient, 0 if none
 	PFRTAny 			*slots;
 } *PFRTBitmapNodeG;
 
 typedef struct FRTBitmapNode {
-	ft 					fclass;
+	uint32_t			fclass;
 	uint32_t 			datamap;
 	uint32_t 			nodemap;
+	uint32_t			edit; 		//	Owning transient, 0 if none
 	PFRTAny 			*slots;
 } *PFRTBitmapNode;
 
@@ -290,26 +397,28 @@ typedef struct FRTBitmapNode {
 
 typedef struct FRTMapG {
 	ft 				fsig;
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Map
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Map
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTBitmapNode 	root; 		// 	Root HAMT node
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
 } *PFRTMapG;
 
 typedef struct FRTMap {
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Map
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Map
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTBitmapNode 	root; 		// 	Root HAMT node
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
 } *PFRTMap,*PFRTAssocType;
 
 typedef struct FRTMapEntry {
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Map
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Map
     PFRTAny 		key;
     PFRTAny 		value;
 } *PFRTMapEntry;
@@ -318,45 +427,91 @@ typedef struct FRTMapEntry {
 
 typedef struct FRTSetG {
 	ft 				fsig;
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Set
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Set
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTBitmapNode 	root; 		// 	Root CHAMP node
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
 } *PFRTSetG;
 
 typedef struct FRTSet {
-	ft 				fclass; 	//	FOIDL Class - Collection
-	ft 				ftype;		//	FOIDL Type - Set
-    ft 				count;    	//	Element count
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Set
+    uint32_t		count;    	//	Element count
 	uint32_t 		hash;
     PFRTBitmapNode 	root; 		// 	Root HAMT node
     ft 				shift;		//	Dynamic
+    ft 				edit; 		//	Transient token, 0 if persistent
 } *PFRTSet;
 
+//	Sorted map and set, a persistent B+ tree. Leaves hold the entries
+//	in key order, inner nodes their children with each child's least
+//	key. Unused keys and slots are end
+
+typedef struct FRTSortNode {
+	uint32_t			fclass;
+	uint32_t 			count; 		//	Keys in use
+	uint32_t 			leaf;
+	uint32_t 			size; 		//	Entries in the subtree
+	uint32_t 			hash; 		//	Sum of the subtree's entry hashes
+	PFRTAny 			keys[32];
+	PFRTAny 			slots[32]; 	//	Map values or children
+} *PFRTSortNode;
+
+typedef struct FRTSorted {
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Sorted map or set
+    uint32_t		count;    	//	Element count
+	uint32_t 		hash;
+    PFRTSortNode 	root;
+} *PFRTSorted;
+
+//	Unboxed byte, int and float arrays. The elements live in a data
+//	block that arrays may share, an array sees the first count of them.
+//	fill is how many have been written, so an array ending at fill can
+//	append in place
+
+typedef struct FRTPrimData {
+	uint32_t 		fclass; 	//	primdata_class
+	uint32_t 		width; 		//	Bytes per element
+	ft 				fill;
+	ft 				capacity;
+} *PFRTPrimData;
+
+#define PRIM_BYTES(d) 	((uint8_t *) ((PFRTPrimData) (d) + 1))
+
+typedef struct FRTPrimArray {
+	uint32_t		fclass; 	//	FOIDL Class - Collection
+	uint32_t		ftype;		//	FOIDL Type - Byte, int or float array
+    uint32_t		count;    	//	Element count
+	uint32_t 		hash; 		//	0 until first used
+    PFRTPrimData 	data;
+} *PFRTPrimArray;
+
 //	Function, Lambda and Concurrency Structures
 
 typedef struct   FRTFuncRefG {
 	ft 			fsig;
-	ft 			fclass;
-	ft 			ftype;
-    ft 			argcount;
+	uint32_t	fclass;
+	uint32_t	ftype;
+    uint32_t	argcount;
 	uint32_t 	spare;
     void 		*fnptr;
 } *PFRTFuncRefG;
 
 typedef struct   FRTFuncRef {
-	ft 			fclass;
-	ft 			ftype;
-    ft 			argcount;
+	uint32_t	fclass;
+	uint32_t	ftype;
+    uint32_t	argcount;
 	uint32_t 	spare;
     void 		*fnptr;
 } *PFRTFuncRef;
 
 typedef struct   FRTLambdaRef {
-	ft 			fclass;
-	ft 			ftype;
+	uint32_t	fclass;
+	uint32_t	ftype;
 	PFRTFuncRef ffuncref;
 	ft 			closures; 		//	Count of closed over args
 	//ft 			hash;
@@ -365,9 +520,9 @@ typedef struct   FRTLambdaRef {
 } *PFRTLambdaRef;
 
 typedef struct FRTFuncRef2 {
-	ft 			fclass;
-	ft 			ftype;
-	ft  		mcount;
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	mcount;
 	uint32_t 	spare;
 	void 		*fnptr;
 	PFRTAny 	args; 	         //	Could be a vector as well
@@ -376,9 +531,9 @@ typedef struct FRTFuncRef2 {
 
 typedef struct   FRTWorkerG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *fnptr;         // Invoication func
     PFRTAny     argcollection;
@@ -388,9 +543,9 @@ typedef struct   FRTWorkerG {
 } *PFRTWorkerG;
 
 typedef struct   FRTWorker {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *fnptr;         // Invoication func
     PFRTAny     argcollection;
@@ -401,9 +556,9 @@ typedef struct   FRTWorker {
 
 typedef struct FRTThreadG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *pool_parent;
     int         thid;
@@ -412,9 +567,9 @@ typedef struct FRTThreadG {
 } *PFRTThreadG;
 
 typedef struct FRTThread {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *pool_parent;
     int         thid;
@@ -424,9 +579,9 @@ typedef struct FRTThread {
 
 typedef struct   FRTThreadPoolG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *fnptr;
     PFRTAny     pool_state;
@@ -444,9 +599,9 @@ typedef struct   FRTThreadPoolG {
 } *PFRTThreadPoolG;
 
 typedef struct   FRTThreadPool {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *fnptr;
     PFRTAny     pool_state;
@@ -467,9 +622,9 @@ typedef struct   FRTThreadPool {
 
 typedef struct FRTSeriesG {
 	ft 			fsig;
-	ft 			fclass;
-	ft 			ftype;
-	ft 			spare1;
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	spare1;
 	uint32_t 	spare2;
 	PFRTAny 	start;
 	PFRTAny 	stop;
@@ -477,9 +632,9 @@ typedef struct FRTSeriesG {
 } *PFRTSeriesG;
 
 typedef struct FRTSeries {
-	ft 			fclass;
-	ft 			ftype;
-	ft 			spare1;
+	uint32_t	fclass;
+	uint32_t	ftype;
+	uint32_t	spare1;
 	uint32_t 	spare2;
 	PFRTAny 	start;
 	PFRTAny 	stop;
@@ -490,9 +645,9 @@ typedef struct FRTSeries {
 
 typedef struct   FRTIOChannelG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to IO handle
     PFRTAny     ctype;
@@ -500,9 +655,9 @@ typedef struct   FRTIOChannelG {
 } *PFRTIOChannelG;
 
 typedef struct   FRTIOChannel {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to IO handle
     PFRTAny     ctype;
@@ -511,9 +666,9 @@ typedef struct   FRTIOChannel {
 
 typedef struct   FRTIOFileChannelG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to IO handle
     PFRTAny     ctype;
@@ -524,9 +679,9 @@ typedef struct   FRTIOFileChannelG {
 } *PFRTIOFileChannelG;
 
 typedef struct   FRTIOFileChannel {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to IO handle
     PFRTAny     ctype;
@@ -534,23 +689,25 @@ typedef struct   FRTIOFileChannel {
     PFRTAny     name;
     PFRTAny     mode;
     PFRTAny     render;
+    PFRTAny     lines;          // Buffered chunk for line reads
+    ft          lpos;           // Read position in lines
 } *PFRTIOFileChannel;
 
 
 typedef struct  FRTResponseG {
     ft          fsig;
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to curl handle
     ft          resp_type;
 } *PFRTResponseG;
 
 typedef struct  FRTResponse {
-    ft          fclass;
-    ft          ftype;
-    ft          count;
+    uint32_t    fclass;
+    uint32_t    ftype;
+    uint32_t    count;
     uint32_t    hash;
     void        *value;         // Maps to curl handle
     ft          resp_type;
@@ -580,11 +737,15 @@ typedef struct  FRTResponse {
 		string_type,sizeof(str) - 1,0,_str ## insym}; \
 	static PFRTAny const insym = (PFRTAny) & _ ## insym.fclass
 
+//	Keywords are interned, equal keywords are the same object. Those
+//	declared with constKeyword are listed in foidl_rtl_init_keywords,
+//	which makes each insym the interned keyword with its text
+
 #define constKeyword(insym,str) \
 	char* const _str ## insym = str; \
-	const struct FRTTypeG _ ## insym = {global_signature,scalar_class, \
+	struct FRTTypeG _ ## insym = {global_signature,scalar_class, \
 		keyword_type,sizeof(str) - 1,0,_str ## insym}; \
-	PFRTAny const insym = (PFRTAny) & _ ## insym.fclass
+	PFRTAny insym = (PFRTAny) & _ ## insym.fclass
 
 #define localKeyword(insym,str) \
 	char* const _str ## insym = str; \
@@ -615,39 +776,41 @@ typedef PFRTAny (*_d2)(PFRTAny,PFRTAny);
 //  Iterators
 
 typedef struct FRTIterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	FOIDL Type - Vector
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	FOIDL Type - Vector
 	itrNext 		next;
 	typeGetter 		get;
 } *PFRTIterator;
 
 typedef struct FRTString_Iterator {
-    ft              fclass;     //  FOIDL Class - Iterator
-    ft              ftype;      //  string_iterator_type
+    uint32_t        fclass;     //  FOIDL Class - Iterator
+    uint32_t        ftype;      //  string_iterator_type
     itrNext         next;
     //typeGetter      get;
     char            *str;       //  Base string
     ft              hash;       //  hash (TBD)
     ft              slen;       //  max length
     ft              index;      //  Last fetched element
+    PFRTAny         string;     //  Held until exhausted
 } *PFRTString_Iterator;
 
 
 typedef struct FRTVector_Iterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	vector_iterator_type
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	vector_iterator_type
 	itrNext 		next;
 	typeGetter 		get;
     PFRTVector 		vector; 	// 	Base vector
 	ft 				hash; 		//	Vector hash (TBD)
     PFRTHamtNode 	node; 		//	Current Node
     ft 				base;		//	Base offset
+    ft 				limit; 		//	End of the current leaf
 	ft 				index; 		//	Last fetched element
 } *PFRTVector_Iterator;
 
 typedef struct FRTList_Iterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	list_iterator_type
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	list_iterator_type
 	itrNext 		next;
 	typeGetter 		get;
 	PFRTList 		list; 		//	Base list
@@ -655,8 +818,8 @@ typedef struct FRTList_Iterator {
 } *PFRTList_Iterator;
 
 typedef struct FRTTrie_Iterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	map_iterator_type
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	map_iterator_type
 	itrNext 		next;
 	typeGetter 		get;
 	int 			currentValueCursor;
@@ -665,11 +828,12 @@ typedef struct FRTTrie_Iterator {
 	int 			currentStackLevel;
 	int 			nodeCursorAndLength[MAX_I_DEPTH*2];
 	PFRTBitmapNode  nodes[MAX_I_DEPTH];
+	PFRTBitmapNode 	root; 		//	Held until exhausted
 } *PFRTTrie_Iterator,*PFRTMap_Iterator,*PFRTSet_Iterator;
 
 typedef struct FRTSeries_Iterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	series_iterator_type
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	series_iterator_type
 	itrNext 		next;
 	ft 				counter;
 	PFRTSeries 		series;
@@ -678,13 +842,33 @@ typedef struct FRTSeries_Iterator {
 } *PFRTSeries_Iterator;
 
 typedef struct FRTChannel_Iterator {
-	ft 				fclass; 	//	FOIDL Class - Iterator
-	ft 				ftype;		//	channel_iterator_type
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	channel_iterator_type
 	itrNext 		next;
 	uint32_t 		currRef;
 	PFRTIOChannel 	channel;
 } *PFRTChannel_Iterator;
 
+typedef struct FRTSorted_Iterator {
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	sorted_iterator_type
+	itrNext 		next;
+	typeGetter 		get;
+	PFRTSorted 		sorted;
+	int 			depth; 		//	Leaf level, -1 when done
+	uint32_t 		index[16];
+	PFRTSortNode 	nodes[16];
+} *PFRTSorted_Iterator;
+
+typedef struct FRTPrim_Iterator {
+	uint32_t		fclass; 	//	FOIDL Class - Iterator
+	uint32_t		ftype;		//	prim_iterator_type
+	itrNext 		next;
+	typeGetter 		get;
+	PFRTPrimArray 	array;
+	ft 				index; 		//	Next element
+} *PFRTPrim_Iterator;
+
 //	Local use structures
 
 //	Local structures
@@ -710,6 +894,39 @@ typedef struct GetResult {
 	PFRTAny 	isFound;
 } *PGetResult;
 
+//	Bottom up vector construction, full leaves are pushed to the open
+//	interior node a level up, the last leaf becomes the tail
+
+typedef struct VectorBuilder {
+	PFRTHamtNode 	leaf; 		//	Leaf being filled
+	PFRTHamtNode 	open[8]; 	//	Open interior node per level
+	uint32_t 		fill[8]; 	//	Children in each open node
+	uint32_t 		levels; 	//	Interior levels started
+	uint32_t 		count;
+	uint32_t 		hash;
+} *PVectorBuilder;
+
+//	Bulk CHAMP construction entry
+
+typedef struct ChampEntry {
+	uint64_t 	order; 		//	Hash digits, level 0 digit highest
+	uint32_t 	hash;
+	uint32_t 	seq; 		//	Arrival, the later of equal keys wins
+	PFRTAny 	key;
+	PFRTAny 	value;
+} *PChampEntry;
+
+//	Structural CHAMP merge and filter state
+
+typedef PFRTAny (*champ_combine)(PFRTAny, PFRTAny, PFRTAny);
+
+typedef struct ChampJoin {
+	PFRTAny 		fn; 		//	Merge combining function, if call is set
+	champ_combine 	call; 		//	Calls fn with both values of a key
+	ft 				count; 		//	Entries one side has and the other not
+	uint32_t 		hash; 		//	Hash of those entries
+} *PChampJoin;
+
 //
 //	Global Expansions
 //
@@ -728,7 +945,6 @@ void foidl_error_exit(int);
 
 
 EXTERNC void *foidl_alloc(ft);
-EXTERNC void foidl_release(void *);
 
 // RTL Asm Error functions
 
@@ -795,6 +1011,8 @@ EXTERNC PFRTAny 	foidl_pop(PFRTAny);
 EXTERNC PFRTAny 	foidl_pop_bang(PFRTAny);
 EXTERNC PFRTAny 	foidl_push(PFRTAny, PFRTAny);
 EXTERNC PFRTAny 	foidl_push_bang(PFRTAny, PFRTAny);
+EXTERNC PFRTAny 	foidl_transient_bang(PFRTAny);
+EXTERNC PFRTAny 	foidl_persistent_bang(PFRTAny);
 EXTERNC PFRTAny     foidl_apply(PFRTAny, PFRTAny);
 EXTERNC PFRTAny     foidl_map(PFRTAny, PFRTAny);
 EXTERNC PFRTAny 	foidl_fold(PFRTAny, PFRTAny, PFRTAny);
@@ -825,6 +1043,7 @@ EXTERNC PFRTAny foidl_not_equal_qmark(PFRTAny,PFRTAny);
 EXTERNC PFRTAny foidl_gteq_qmark(PFRTAny,PFRTAny);
 EXTERNC PFRTAny foidl_function_qmark(PFRTAny);
 EXTERNC PFRTAny foidl_number_qmark(PFRTAny);
+EXTERNC PFRTAny foidl_float_qmark(PFRTAny);
 EXTERNC PFRTAny foidl_collection_qmark(PFRTAny);
 EXTERNC PFRTAny foidl_extendable_qmark(PFRTAny);
 EXTERNC PFRTAny foidl_io_qmark(PFRTAny);
@@ -833,28 +1052,90 @@ EXTERNC PFRTAny function_strict_arg(PFRTAny, PFRTAny);
 EXTERNC PFRTAny string_type_qmark(PFRTAny);
 #endif
 
+#ifndef REFCOUNT_IMPL
+EXTERNC PFRTAny 	foidl_retain(PFRTAny);
+EXTERNC PFRTAny 	foidl_release(PFRTAny);
+EXTERNC PFRTAny 	foidl_release_temp(PFRTAny);
+EXTERNC PFRTAny 	foidl_release_type(PFRTAny);
+EXTERNC void 		foidl_unref(PFRTAny);
+EXTERNC void 		foidl_unref_node(PFRTBitmapNode, ft);
+EXTERNC void 		foidl_ref_flush();
+EXTERNC void 		foidl_ref_thread_release();
+EXTERNC ft 			foidl_ref_pending(ft **);
+EXTERNC void 		foidl_sig_flags(PFRTAny, ft, ft);
+#endif
+
+#ifndef GC_IMPL
+EXTERNC void 		foidl_gc_init();
+EXTERNC void 		foidl_gc_register_roots(PFRTAny **, ft);
+EXTERNC void 		foidl_gc_register_root(PFRTAny *);
+EXTERNC ft 			foidl_gc_rooted(PFRTAny);
+EXTERNC void 		foidl_gc_register_thread();
+EXTERNC void 		foidl_gc_release_thread();
+EXTERNC void 		foidl_gc_safepoint();
+EXTERNC void 		foidl_gc_poll();
+EXTERNC void 		foidl_gc_blocking(void (*)(void *), void *);
+EXTERNC PFRTAny 	foidl_gc_collect_bang();
+#endif
+
+#ifndef PROFILE_IMPL
+EXTERNC ft 			foidl_profiling;
+EXTERNC void 		foidl_profile_init();
+EXTERNC void 		foidl_profile_record(const char *, ft, ft);
+EXTERNC void 		foidl_profile_thread_release();
+EXTERNC void 		foidl_profile_report();
+EXTERNC PFRTAny 	foidl_profile_start_bang();
+EXTERNC PFRTAny 	foidl_profile_stop_bang();
+EXTERNC PFRTAny 	foidl_profile_dump_bang();
+#endif
+
+//	Records an allocation made by the enclosing function when profiling
+
+#define profile_slots 	0
+#define profile_alloc(kind,bytes) \
+	if(foidl_profiling) foidl_profile_record(__func__, (kind), (bytes))
+
 #ifndef HASH_IMPL
 EXTERNC uint32_t murmur3_32(const uint8_t*, size_t, uint32_t);
+EXTERNC uint64_t foidl_hash64(const uint8_t*, size_t, uint64_t);
+EXTERNC void 	 foidl_rtl_init_hash();
 EXTERNC uint32_t hash(PFRTAny);
 #endif
 
 #ifndef	ALLOC_IMPL
 
 EXTERNC const PFRTAny emtndarray[];
-EXTERNC void 			foidl_gc_init();
+EXTERNC void 			foidl_rtl_init_allocators();
+EXTERNC void 			foidl_thread_cache_release();
+EXTERNC PFRTAny 		foidl_arena_begin_bang();
+EXTERNC PFRTAny 		foidl_arena_end_bang();
+EXTERNC PFRTAny 		foidl_arena_promote_bang(PFRTAny);
+EXTERNC void *			foidl_arena_suspend();
+EXTERNC void 			foidl_arena_resume(void *);
+EXTERNC PFRTAny 		foidl_arena_detach(PFRTAny);
 EXTERNC void *			foidl_xall(int sz);
+EXTERNC void *			foidl_xall_shared(int sz);
+EXTERNC void *			foidl_xall_root(int sz);
 EXTERNC void *          foidl_xreall(void *, uint32_t);
 EXTERNC void 			foidl_xdel(void *);
+EXTERNC void 			foidl_heap_index();
+EXTERNC PFRTTypeG 		foidl_heap_block(void *, ft *);
+EXTERNC void 			foidl_heap_walk(void (*)(PFRTTypeG, ft));
+EXTERNC void 			foidl_arena_walk(void (*)(char *, char *));
 //	Scalar types
 EXTERNC PFRTAny 		*allocRawAnyArray(ft count);
 EXTERNC PFRTAny 		allocAny(ft fclass,ft ftype,void *value);
 EXTERNC PFRTAny 		allocGlobalString(char *);
 EXTERNC PFRTAny 		allocGlobalStringCopy(char *);
-EXTERNC PFRTAny 		allocGlobalKeywordCopy(char *);
+EXTERNC PFRTAny 		allocGlobalKeywordCopy(char *, uint32_t);
+EXTERNC void 			releaseGlobalKeywordCopy(PFRTAny);
 
 EXTERNC PFRTAny 		allocStringWithBufferSize(uint32_t);
 EXTERNC PFRTAny 		allocStringWithCopy(char *);
 EXTERNC PFRTAny 		allocStringWithCopyCnt(uint32_t, char *);
+EXTERNC PFRTAny 		allocStringSlice(PFRTAny, char *, uint32_t);
+EXTERNC PFRTAny 		allocStringShared(uint32_t);
+EXTERNC PFRTAny 		allocStringBuilder(uint32_t, char *, uint32_t, char *, uint32_t);
 EXTERNC PFRTAny         allocStringWithCptr(char *, long int);
 EXTERNC PFRTAny 		allocAndConcatString(uint32_t,char *, uint32_t, char *, uint32_t);
 
@@ -884,6 +1165,11 @@ EXTERNC PFRTMapEntry 	allocMapEntryWith(PFRTAny, PFRTAny);
 EXTERNC PFRTSeries 		allocSeries();
 EXTERNC PFRTBitmapNode 	allocNode();
 EXTERNC PFRTHamtNode 	allocHamtNode();
+EXTERNC PFRTRrbNode 	allocRrbNode();
+EXTERNC PFRTSortNode 	allocSortNode(uint32_t);
+EXTERNC PFRTSorted 		allocSorted(ft, PFRTSortNode);
+EXTERNC PFRTPrimData 	allocPrimData(uint32_t, ft);
+EXTERNC PFRTPrimArray 	allocPrimArray(ft, ft, PFRTPrimData);
 EXTERNC PFRTBitmapNode 	allocNodeWith(uint32_t, uint32_t, ft);
 EXTERNC PFRTBitmapNode 	allocNodeClone(PFRTBitmapNode, ft);
 EXTERNC PFRTBitmapNode 	allocNodeWithAll(uint32_t,uint32_t,PFRTAny *);
@@ -895,6 +1181,8 @@ EXTERNC PFRTIterator 	allocListIterator(PFRTList,itrNext);
 EXTERNC PFRTIterator 	allocSeriesIterator(PFRTSeries,itrNext);
 EXTERNC PFRTIterator    allocChannelIterator(PFRTIOChannel, itrNext);
 EXTERNC PFRTIterator    allocStringIterator(PFRTAny, itrNext);
+EXTERNC PFRTIterator    allocSortedIterator(PFRTSorted, itrNext);
+EXTERNC PFRTIterator    allocPrimIterator(PFRTPrimArray, itrNext);
 
 #endif
 
@@ -935,10 +1223,16 @@ EXTERNC PFRTAny 	allocECharWithValue(ft, ft);
 EXTERNC void        foidl_rtl_init_numbers();
 EXTERNC PFRTAny     foidl_reg_number(char *);
 EXTERNC PFRTAny     foidl_reg_intnum(ft);
+EXTERNC PFRTAny     foidl_reg_floatnum(double);
+EXTERNC void        release_number(PFRTAny);
+EXTERNC void        release_number_value(void *);
+EXTERNC void        foidl_number_thread_release();
+EXTERNC uint32_t    number_hash(PFRTAny);
 EXTERNC ft          number_tostring_buffersize(PFRTAny);
 EXTERNC char*       number_tostring(PFRTAny);
 EXTERNC long long   number_tolong(PFRTAny);
 EXTERNC ft          number_toft(PFRTAny);
+EXTERNC double      number_todouble(PFRTAny);
 EXTERNC PFRTAny     is_number_positive(PFRTAny);
 EXTERNC PFRTAny     is_number_negative(PFRTAny);
 EXTERNC PFRTAny     is_number_integer(PFRTAny);
@@ -961,6 +1255,8 @@ EXTERNC PFRTAny     foidl_num_mod(PFRTAny flhs, PFRTAny frhs);
 // String
 #ifndef STRING_IMPL
 EXTERNC 	void foildl_rtl_init_strings();
+EXTERNC 	void foidl_rtl_init_keywords();
+EXTERNC 	PFRTAny foidl_intern_keyword(char *, uint32_t);
 EXTERNC 	PFRTAny string_get(PFRTAny,PFRTAny);
 EXTERNC 	PFRTAny string_get_default(PFRTAny, PFRTAny,PFRTAny);
 EXTERNC  PFRTAny string_first(PFRTAny);
@@ -971,9 +1267,13 @@ EXTERNC 	PFRTAny string_update(PFRTAny, PFRTAny, PFRTAny);
 EXTERNC 	PFRTAny string_update_bang(PFRTAny, PFRTAny, PFRTAny);
 EXTERNC  PFRTAny string_extend(PFRTAny, PFRTAny);
 EXTERNC  PFRTAny string_extend_bang(PFRTAny, PFRTAny);
+EXTERNC  PFRTAny string_transient_bang(PFRTAny);
+EXTERNC  PFRTAny string_persistent_bang(PFRTAny);
 EXTERNC  PFRTAny string_droplast(PFRTAny);
 EXTERNC  PFRTAny string_droplast_bang(PFRTAny);
 EXTERNC  PFRTAny release_string(PFRTAny s);
+EXTERNC  void 	release_retired(PFRTAny s);
+EXTERNC  char 	*string_cstr(PFRTAny s);
 #endif
 
 #ifndef INVOKE_IMPL
@@ -1003,11 +1303,13 @@ EXTERNC PFRTAny     pool_exit;
 #ifndef ITERATORS_IMPL
 EXTERNC PFRTIterator   iteratorFor(PFRTAny);
 EXTERNC PFRTAny 	   iteratorNext(PFRTIterator);
+EXTERNC ft 			   iteratorChunk(PFRTIterator, PFRTAny *, PFRTAny **);
+EXTERNC void 		   iteratorRelease(PFRTIterator);
 #endif
 
 //	Node functions
 #ifndef NODE_IMPL
-EXTERNC const struct FRTBitmapNode _empty_champ_node;
+EXTERNC const struct FRTBitmapNodeG _empty_champ_node;
 EXTERNC PFRTBitmapNode   const empty_champ_node;
 EXTERNC uint32_t 		bit_count(uint32_t);
 EXTERNC uint32_t 		bit_pos(uint32_t);
@@ -1022,6 +1324,14 @@ EXTERNC uint32_t 		mask(uint32_t, ft);
 EXTERNC uint32_t 		sizePredicate(PFRTBitmapNode);
 EXTERNC PFRTBitmapNode 	getNode(PFRTBitmapNode, uint32_t);
 EXTERNC void 			arraycopy(PFRTAny *, PFRTAny *,uint32_t);
+EXTERNC void 			arrayset(PFRTAny *, uint32_t, PFRTAny, ft);
+EXTERNC void 			arrayrelease(PFRTAny *, uint32_t, ft);
+EXTERNC uint32_t 		foidl_edit_token();
+EXTERNC PFRTBitmapNode 	editableNode(PFRTBitmapNode, uint32_t, uint32_t);
+EXTERNC PChampEntry 	champ_entry_add(PChampEntry, ft *, ft *, PFRTAny, PFRTAny);
+EXTERNC PFRTBitmapNode 	champ_from_entries(PChampEntry, ft *, ft);
+EXTERNC PFRTBitmapNode 	champ_merge(PFRTBitmapNode, PFRTBitmapNode, ft, PChampJoin);
+EXTERNC PFRTBitmapNode 	champ_filter(PFRTBitmapNode, PFRTBitmapNode, ft, int, PChampJoin);
 #endif
 
 //  Vector functions
@@ -1029,8 +1339,13 @@ EXTERNC void 			arraycopy(PFRTAny *, PFRTAny *,uint32_t);
 EXTERNC  PFRTHamtNode const empty_node;
 EXTERNC 	PFRTVector 	 const empty_vector;
 EXTERNC 	PFRTAny foidl_vector_inst_bang();
+EXTERNC 	PFRTAny vector_transient_bang(PFRTAny);
 EXTERNC  PFRTAny foidl_vector_extend_bang(PFRTAny,PFRTAny);
 EXTERNC  PFRTAny vector_from_argv(int, char**);
+EXTERNC  PFRTAny vector_from_iterator(PFRTIterator);
+EXTERNC  void 	vector_builder_init(PVectorBuilder);
+EXTERNC  void 	vector_builder_add(PVectorBuilder, PFRTAny);
+EXTERNC  PFRTAny vector_builder_finish(PVectorBuilder);
 EXTERNC  PFRTAny vector_nth(PFRTVector, ft);
 EXTERNC 	PFRTAny vector_first(PFRTAny);
 EXTERNC 	PFRTAny vector_second(PFRTAny);
@@ -1046,6 +1361,11 @@ EXTERNC  PFRTAny	vector_drop_bang(PFRTAny,PFRTAny);
 EXTERNC  PFRTAny	vector_dropLast_bang(PFRTAny);
 EXTERNC  PFRTAny vector_droplast(PFRTAny);
 EXTERNC 	PFRTAny vectorGetDefault(PFRTAny v, uint32_t index);
+EXTERNC 	PFRTHamtNode vector_leaf(PFRTVector, ft, ft *, ft *);
+EXTERNC 	uint32_t vector_hash(PFRTAny);
+EXTERNC 	PFRTAny vector_slice(PFRTAny, ft, ft);
+EXTERNC 	PFRTAny vector_concat(PFRTAny, PFRTAny);
+EXTERNC 	PFRTAny vector_insert(PFRTAny, ft, PFRTAny);
 EXTERNC  PFRTAny    write_vector(PFRTAny, PFRTAny, channel_writer);
 #endif
 
@@ -1053,12 +1373,17 @@ EXTERNC  PFRTAny    write_vector(PFRTAny, PFRTAny, channel_writer);
 #ifndef SET_IMPL
 EXTERNC PFRTAny  const empty_set;
 EXTERNC PFRTAny 	foidl_set_inst_bang();
+EXTERNC PFRTAny 	set_transient_bang(PFRTAny);
+EXTERNC PFRTAny 	set_from_iterator(PFRTIterator);
 EXTERNC PFRTAny 	foidl_set_extend_bang(PFRTAny s, PFRTAny k);
 EXTERNC PFRTAny 	set_extend(PFRTAny,PFRTAny);
 EXTERNC PFRTAny 	set_remove(PFRTAny,PFRTAny);
 EXTERNC PFRTAny 	set_first(PFRTAny);
 EXTERNC PFRTAny 	set_second(PFRTAny);
 EXTERNC PFRTAny 	set_rest(PFRTAny);
+EXTERNC PFRTAny 	set_union(PFRTAny,PFRTAny);
+EXTERNC PFRTAny 	set_intersect(PFRTAny,PFRTAny);
+EXTERNC PFRTAny 	set_difference(PFRTAny,PFRTAny);
 EXTERNC PFRTAny 	set_get(PFRTAny,PFRTAny);
 EXTERNC PFRTBitmapNode set_getNode(PFRTBitmapNode, uint32_t);
 EXTERNC PFRTAny 	set_get_default(PFRTAny, PFRTAny,PFRTAny);
@@ -1070,6 +1395,9 @@ EXTERNC  PFRTAny    write_set(PFRTAny, PFRTAny, channel_writer);
 #ifndef MAP_IMPL
 EXTERNC PFRTAny const empty_map;
 EXTERNC PFRTAny  foidl_map_inst_bang();
+EXTERNC PFRTAny  map_transient_bang(PFRTAny);
+EXTERNC PFRTAny  map_from_pairs(PFRTIterator);
+EXTERNC PFRTAny  map_from_keys_values(PFRTIterator, PFRTIterator);
 EXTERNC PFRTAny  foidl_map_extend_bang(PFRTAny,PFRTAny,PFRTAny);
 EXTERNC PFRTAny  map_first(PFRTAny);
 EXTERNC PFRTAny  map_second(PFRTAny);
@@ -1079,11 +1407,59 @@ EXTERNC PFRTAny  map_get_default(PFRTAny, PFRTAny,PFRTAny);
 EXTERNC PFRTAny  map_extend(PFRTAny,PFRTAny,PFRTAny);
 EXTERNC PFRTAny  map_update(PFRTAny,PFRTAny,PFRTAny);
 EXTERNC PFRTAny  map_remove(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  map_merge(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  map_merge_with(PFRTAny, PFRTAny, PFRTAny, champ_combine);
 EXTERNC PFRTAny  map_contains_qmark(PFRTAny, PFRTAny);
 EXTERNC PFRTAny  mapGetDefault(PFRTAny node, uint32_t index);
 EXTERNC PFRTAny  write_map(PFRTAny, PFRTAny, channel_writer);
 #endif
 
+//	Sorted map and set functions
+#ifndef SORTED_IMPL
+EXTERNC PFRTAny  sorted_from_iterator(ft, PFRTIterator);
+EXTERNC PFRTAny  sorted_get(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_get_default(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_extend(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_assoc(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_remove(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_extend_bang(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_assoc_bang(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_first(PFRTAny);
+EXTERNC PFRTAny  sorted_second(PFRTAny);
+EXTERNC PFRTAny  sorted_last(PFRTAny);
+EXTERNC PFRTAny  sorted_rest(PFRTAny);
+EXTERNC PFRTAny  sorted_floor(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_ceiling(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sorted_subrange(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  sortediterator_next(PFRTSorted_Iterator);
+EXTERNC ft 		 sortediterator_chunk(PFRTSorted_Iterator, PFRTAny **);
+#endif
+
+//	Unboxed array functions
+#ifndef PRIMITIVE_IMPL
+EXTERNC PFRTAny  prim_from_iterator(ft, PFRTIterator);
+EXTERNC PFRTAny  prim_get(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_get_default(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_first(PFRTAny);
+EXTERNC PFRTAny  prim_second(PFRTAny);
+EXTERNC PFRTAny  prim_last(PFRTAny);
+EXTERNC PFRTAny  prim_extend(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_extend_bang(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_update(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_update_bang(PFRTAny, PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_index_of(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_sum(PFRTAny);
+EXTERNC PFRTAny  prim_min(PFRTAny);
+EXTERNC PFRTAny  prim_max(PFRTAny);
+EXTERNC PFRTAny  prim_dot(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_elem_add(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  prim_elem_mul(PFRTAny, PFRTAny);
+EXTERNC uint32_t prim_hash(PFRTAny);
+EXTERNC PFRTAny  prim_equal(PFRTAny, PFRTAny);
+EXTERNC PFRTAny  primiterator_next(PFRTPrim_Iterator);
+EXTERNC PFRTAny  write_prim(PFRTAny, PFRTAny, channel_writer);
+#endif
+
 // List
 #ifndef LIST_IMPL
 EXTERNC  PFRTAny  const empty_list;
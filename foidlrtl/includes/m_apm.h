@@ -170,6 +170,17 @@ extern "C" {
 
 typedef unsigned char UCHAR;
 
+/*
+ *	library state (constants, caches and scratch variables) is
+ *	kept per thread so numbers can be computed without a lock
+ */
+
+#ifdef _MSC_VER
+#define	M_APM_THREAD	__declspec(thread)
+#else
+#define	M_APM_THREAD	__thread
+#endif
+
 typedef struct  {
 	UCHAR	*m_apm_data;
 	long	m_apm_id;
@@ -192,23 +203,23 @@ typedef M_APM_struct *M_APM;
  *	convienient predefined constants
  */
 
-extern	M_APM	MM_Zero;
-extern	M_APM	MM_One;
-extern	M_APM	MM_Two;
-extern	M_APM	MM_Three;
-extern	M_APM	MM_Four;
-extern	M_APM	MM_Five;
-extern	M_APM	MM_Ten;
+extern	M_APM_THREAD M_APM	MM_Zero;
+extern	M_APM_THREAD M_APM	MM_One;
+extern	M_APM_THREAD M_APM	MM_Two;
+extern	M_APM_THREAD M_APM	MM_Three;
+extern	M_APM_THREAD M_APM	MM_Four;
+extern	M_APM_THREAD M_APM	MM_Five;
+extern	M_APM_THREAD M_APM	MM_Ten;
 
-extern	M_APM	MM_PI;
-extern	M_APM	MM_HALF_PI;
-extern	M_APM	MM_2_PI;
-extern	M_APM	MM_E;
+extern	M_APM_THREAD M_APM	MM_PI;
+extern	M_APM_THREAD M_APM	MM_HALF_PI;
+extern	M_APM_THREAD M_APM	MM_2_PI;
+extern	M_APM_THREAD M_APM	MM_E;
 
-extern	M_APM	MM_LOG_E_BASE_10;
-extern	M_APM	MM_LOG_10_BASE_E;
-extern	M_APM	MM_LOG_2_BASE_E;
-extern	M_APM	MM_LOG_3_BASE_E;
+extern	M_APM_THREAD M_APM	MM_LOG_E_BASE_10;
+extern	M_APM_THREAD M_APM	MM_LOG_10_BASE_E;
+extern	M_APM_THREAD M_APM	MM_LOG_2_BASE_E;
+extern	M_APM_THREAD M_APM	MM_LOG_3_BASE_E;
 
 
 /*
@@ -315,7 +326,7 @@ extern
 #ifdef APM_CONVERT_FROM_C
 "C" 
 #endif
-int MM_cpp_min_precision;
+M_APM_THREAD int MM_cpp_min_precision;
 
 
 class MAPM {
@@ -293,13 +293,13 @@ EXTERNC   void   memory_free(void *);
 #define  MAPM_FREE memory_free
 */
 
-void * foidl_xall(int sz);
+void * foidl_xall_root(int sz);
 void * foidl_xreall(void *p, int newsz);
 void foidl_xdel(void *v);
 
 /* default: use the standard C library memory functions ... */
 
-#define  MAPM_MALLOC foidl_xall
+#define  MAPM_MALLOC foidl_xall_root
 #define  MAPM_REALLOC foidl_xreall
 #define  MAPM_FREE foidl_xdel
 
@@ -319,27 +319,27 @@ void foidl_xdel(void *v);
 
 #define	VALID_DECIMAL_PLACES 128
 
-EXTERNC  int     MM_lc_PI_digits;
-EXTERNC  int     MM_lc_log_digits;
+EXTERNC  M_APM_THREAD int     MM_lc_PI_digits;
+EXTERNC  M_APM_THREAD int     MM_lc_log_digits;
 
 /*
  *   constants not in m_apm.h
  */
 
-EXTERNC	M_APM	MM_0_5;
-EXTERNC	M_APM	MM_0_85;
-EXTERNC	M_APM	MM_5x_125R;
-EXTERNC	M_APM	MM_5x_64R;
-EXTERNC	M_APM	MM_5x_256R;
-EXTERNC	M_APM	MM_5x_Eight;
-EXTERNC	M_APM	MM_5x_Sixteen;
-EXTERNC	M_APM	MM_5x_Twenty;
-EXTERNC	M_APM	MM_lc_PI;
-EXTERNC	M_APM	MM_lc_HALF_PI;
-EXTERNC	M_APM	MM_lc_2_PI;
-EXTERNC	M_APM	MM_lc_log2;
-EXTERNC	M_APM	MM_lc_log10;
-EXTERNC	M_APM	MM_lc_log10R;
+EXTERNC	M_APM_THREAD M_APM	MM_0_5;
+EXTERNC	M_APM_THREAD M_APM	MM_0_85;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_125R;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_64R;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_256R;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_Eight;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_Sixteen;
+EXTERNC	M_APM_THREAD M_APM	MM_5x_Twenty;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_PI;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_HALF_PI;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_2_PI;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_log2;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_log10;
+EXTERNC	M_APM_THREAD M_APM	MM_lc_log10R;
 
 /*
  *   prototypes for internal functions
@@ -84,8 +84,8 @@
 
 #include "m_apm_lc.h"
 
-static	char *M_buf  = NULL;
-static  int   M_lbuf = 0;
+static M_APM_THREAD	char *M_buf  = NULL;
+static M_APM_THREAD  int   M_lbuf = 0;
 static  char *M_set_string_error_msg = "\'m_apm_set_string\', Out of memory";
 
 /****************************************************************************/
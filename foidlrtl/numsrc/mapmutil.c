@@ -108,16 +108,16 @@
 
 #include "m_apm_lc.h"
 
-static  UCHAR	*M_mul_div = NULL;
-static  UCHAR   *M_mul_rem = NULL;
+static M_APM_THREAD  UCHAR	*M_mul_div = NULL;
+static M_APM_THREAD  UCHAR   *M_mul_rem = NULL;
 
-static  UCHAR   M_mul_div_10[100];
-static	UCHAR   M_mul_rem_10[100];
+static M_APM_THREAD  UCHAR   M_mul_div_10[100];
+static M_APM_THREAD	UCHAR   M_mul_rem_10[100];
 
-static	int	M_util_firsttime = TRUE;
-static	int     M_firsttime3 = TRUE;
+static M_APM_THREAD	int	M_util_firsttime = TRUE;
+static M_APM_THREAD	int     M_firsttime3 = TRUE;
 
-static	M_APM	M_work_0_5;
+static M_APM_THREAD	M_APM	M_work_0_5;
 
 static  char    *M_init_error_msg = "\'m_apm_init\', Out of memory";
 
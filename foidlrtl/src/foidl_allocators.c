@@ -23,62 +23,587 @@
 #include	<foidlrt.h>
 #include 	<stdio.h>
 
-static PFRTAny gc_initialized = (PFRTAny) &_false.fclass;
-
 const PFRTAny emtndarray[0];// = {end,end};
 
-static ft unknown_allocs = 0;
-static ft general_allocs = 0;
-static ft global_allocs = 0;
+/*
+	Size-class slab allocator
+
+	Blocks (fsig + structure) are carved from large slabs and
+	recycled through a free list per size class. The classes are
+	keyed by the fixed structure sizes with a few general classes
+	for strings and slot arrays. The class index is kept in the low
+	half-word (MEMSIG.bytes) of fsig, class 0 is a heap (calloc) block
+
+	Each runtime thread keeps a magazine (local free chain) per class
+	that is refilled from, and flushed to, the shared depot in batches
+	so the depot lock is only taken once per MAG_BATCH blocks. The
+	allocation statistics are kept per thread and merged on demand
+
+	Slabs are recorded in an address ordered extent table so the
+	collector can resolve interior pointers to blocks and walk every
+	block. A slab extent covers the whole blocks of its class. Heap
+	blocks carry a header linking them into one of LARGE_STRIPES
+	lists, each with its own lock, so taking and giving one back is
+	O(1) and does not go through the slab lock. The collector indexes
+	them by address when it starts (foidl_heap_index)
+*/
+
+#define	SLAB_BYTES		(64 * 1024)
+#define	SLAB_MAXBLOCK	512
+#define SLAB_GRAINS 	(SLAB_MAXBLOCK / sizeof(ft) + 1)
+#define MAG_BATCH		32
+#define MAG_ROUNDS		(2 * MAG_BATCH)
+#define LARGE_STRIPES 	16
+
+//	Free blocks are linked through the pointer sized word after fsig,
+//	copied in and out to stay clear of strict aliasing
+
+static inline void *free_link(PFRTTypeG g) {
+	void 	*next;
+	memcpy(&next, &g->fclass, sizeof(void *));
+	return next;
+}
+
+static inline void set_free_link(PFRTTypeG g, void *next) {
+	memcpy(&g->fclass, &next, sizeof(void *));
+}
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL 	__declspec(thread)
+#define LARGE_CAS(p,o,n) ((ft) InterlockedCompareExchange64((LONG64 *)(p),(LONG64)(n),(LONG64)(o)))
+#else
+#define THREAD_LOCAL 	__thread
+#define LARGE_CAS(p,o,n) __sync_val_compare_and_swap((p),(o),(n))
+#endif
+
+typedef struct SlabClass {
+	ft 		bsize;			// Block size, including fsig
+	void 	*free;			// Recycled blocks, see free_link
+	char 	*cursor;		// Next uncarved block in current slab
+	char 	*limit;			// End of current slab
+	ft 		slabs;			// Slabs taken from heap
+} SlabClass;
+
+static const ft slab_sizes[] = {
+	sizeof(struct FRTType),
+	sizeof(struct FRTRegEx),
+	sizeof(struct FRTHamtNode),
+	sizeof(struct FRTVector),
+	sizeof(struct FRTLinkNode),
+	sizeof(struct FRTList),
+	sizeof(struct FRTBitmapNode),
+	sizeof(struct FRTMap),
+	sizeof(struct FRTMapEntry),
+	sizeof(struct FRTSet),
+	sizeof(struct FRTFuncRef2),
+	sizeof(struct FRTSeries),
+	sizeof(struct FRTResponse),
+	sizeof(struct FRTString_Iterator),
+	sizeof(struct FRTVector_Iterator),
+	sizeof(struct FRTList_Iterator),
+	sizeof(struct FRTTrie_Iterator),
+	sizeof(struct FRTSeries_Iterator),
+	sizeof(struct FRTChannel_Iterator),
+	8, 16, 32, 64, 128, 256, 384, 504};
+
+#define SLAB_CLASSES (sizeof(slab_sizes) / sizeof(ft) + 1)
+
+typedef struct SlabCache {
+	void 	*mags[SLAB_CLASSES];	// Magazine chains, see free_link
+	ft 		rounds[SLAB_CLASSES];	// Blocks held in each magazine
+	lt 		inuse[SLAB_CLASSES];	// Net blocks handed out by this thread
+	ft 		unknown_allocs;
+	ft 		general_allocs;
+	ft 		global_allocs;
+	ft 		unknown_free;
+	ft 		general_free;
+	ft 		global_free;
+	ft 		arena_allocs;
+	struct Arena *arena;			// Innermost open arena scope
+	struct SlabCache *next;
+} SlabCache;
+
+static SlabClass 	slab_classes[SLAB_CLASSES];
+static SlabCache 	*slab_caches = NULL;	// Live thread caches
+static SlabCache 	slab_retired;			// Statistics of ended threads
+static THREAD_LOCAL SlabCache *slab_cache = NULL;
+static uint8_t 		slab_lookup[SLAB_GRAINS];
+static ft 			slab_count = 0;
+static PFRTAny 		slab_ready = (PFRTAny) &_false.fclass;
+
+typedef struct SlabExtent {
+	char 	*base;
+	char 	*limit;			// End of the last whole block
+	ft 		cls;			// Slab class or 0 for a heap block
+} SlabExtent;
+
+static SlabExtent 	*slab_extents = NULL;
+static ft 			extent_count = 0;
+static ft 			extent_size = 0;
+
+//	Heap (class 0) blocks, the header precedes fsig
+
+typedef struct LargeBlock {
+	struct LargeBlock *prev;
+	struct LargeBlock *next;
+	ft 		bytes;			// Block size, including fsig
+	ft 		spare;			// Keeps fsig 16 byte aligned
+} LargeBlock;
+
+#define LARGE_HDR(g) 	((LargeBlock *) (g) - 1)
+
+typedef struct LargeStripe {
+	volatile ft 		lock;			// Held only to link or unlink
+	LargeBlock 			*first;
+} LargeStripe;
+
+static LargeStripe 	large_stripes[LARGE_STRIPES];
+static SlabExtent 	*large_index = NULL;	// Built by foidl_heap_index
+static ft 			large_count = 0;
+static ft 			large_size = 0;
+
+#ifdef _MSC_VER
+static HANDLE 			slab_lock;
+#else
+static pthread_mutex_t 	slab_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lock_slab() {
+#ifdef _MSC_VER
+	WaitForSingleObject(slab_lock,INFINITE);
+#else
+	pthread_mutex_lock(&slab_lock);
+#endif
+}
+
+static void unlock_slab() {
+#ifdef _MSC_VER
+	ReleaseMutex(slab_lock);
+#else
+	pthread_mutex_unlock(&slab_lock);
+#endif
+}
+
+//	Index of the first extent of an ordered table starting above p
+
+static ft extent_after(SlabExtent *tab, ft cnt, char *p) {
+	ft lo = 0, hi = cnt;
+	while(lo < hi) {
+		ft mid = (lo + hi) / 2;
+		if(tab[mid].base <= p)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+//	Extent table changes are made holding the slab lock
+
+static void extent_insert(char *base, ft bytes, ft cls) {
+	if(extent_count == extent_size) {
+		ft 	nsize = extent_size ? extent_size * 2 : 256;
+		SlabExtent *ext = realloc(slab_extents, nsize * sizeof(SlabExtent));
+		if(ext == NULL)
+			unknown_handler();
+		slab_extents = ext;
+		extent_size = nsize;
+	}
+	ft 	at = extent_after(slab_extents, extent_count, base);
+	memmove(&slab_extents[at+1], &slab_extents[at],
+		(extent_count - at) * sizeof(SlabExtent));
+	slab_extents[at].base = base;
+	slab_extents[at].limit = base + bytes;
+	slab_extents[at].cls = cls;
+	++extent_count;
+}
+
+//	Heap blocks, the stripe is picked by address
+
+static LargeStripe *large_stripe(LargeBlock *b) {
+	return &large_stripes[((ft) b >> 6) % LARGE_STRIPES];
+}
+
+static void lock_large(LargeStripe *st) {
+	while(LARGE_CAS(&st->lock, 0, 1) != 0)
+		;
+}
+
+static void unlock_large(LargeStripe *st) {
+	LARGE_CAS(&st->lock, 1, 0);
+}
+
+static void large_link(LargeBlock *b, ft bytes) {
+	LargeStripe *st = large_stripe(b);
+	b->bytes = bytes;
+	b->prev = NULL;
+	lock_large(st);
+	b->next = st->first;
+	if(st->first)
+		st->first->prev = b;
+	st->first = b;
+	unlock_large(st);
+}
+
+static void large_unlink(LargeBlock *b) {
+	LargeStripe *st = large_stripe(b);
+	lock_large(st);
+	if(b->prev)
+		b->prev->next = b->next;
+	else
+		st->first = b->next;
+	if(b->next)
+		b->next->prev = b->prev;
+	unlock_large(st);
+}
+
+//	Builds the ordered class table and the grain to class lookup
+
+void foidl_rtl_init_allocators() {
+	if(slab_ready == true)
+		return;
+#ifdef _MSC_VER
+	slab_lock = CreateMutex(NULL, FALSE, NULL);
+#endif
+	for(ft i = 0; i < SLAB_CLASSES - 1; i++) {
+		ft bsize = slab_sizes[i] + sizeof(ft);
+		bsize = (bsize + sizeof(ft) - 1) & ~(sizeof(ft) - 1);
+		if(bsize > SLAB_MAXBLOCK)
+			continue;
+		ft j = slab_count;
+		while(j > 0 && slab_classes[j].bsize > bsize)
+			--j;
+		if(j > 0 && slab_classes[j].bsize == bsize)
+			continue;
+		for(ft k = slab_count; k > j; k--)
+			slab_classes[k+1] = slab_classes[k];
+		slab_classes[j+1].bsize = bsize;
+		++slab_count;
+	}
+	for(ft g = 0, c = 1; g < SLAB_GRAINS; g++) {
+		while(c <= slab_count && slab_classes[c].bsize < g * sizeof(ft))
+			++c;
+		slab_lookup[g] = c <= slab_count ? c : 0;
+	}
+	slab_ready = true;
+	foidl_profile_init();
+}
+
+//	Returns the calling threads cache, registering it on first use
+
+static SlabCache *thread_cache() {
+	SlabCache *tc = slab_cache;
+	if(tc == NULL) {
+		tc = calloc(1,sizeof(SlabCache));
+		lock_slab();
+		tc->next = slab_caches;
+		slab_caches = tc;
+		unlock_slab();
+		slab_cache = tc;
+	}
+	return tc;
+}
+
+//	Moves a batch of blocks from the depot into the magazine
+
+static void magazine_refill(SlabCache *tc, ft cls) {
+	SlabClass *sc = &slab_classes[cls];
+	foidl_gc_safepoint();
+	lock_slab();
+	for(ft i = 0; i < MAG_BATCH; i++) {
+		PFRTTypeG blk;
+		if(sc->free) {
+			blk = sc->free;
+			sc->free = free_link(blk);
+		}
+		else {
+			if(sc->cursor + sc->bsize > sc->limit) {
+				sc->cursor = calloc(SLAB_BYTES,1);
+				sc->limit = sc->cursor + SLAB_BYTES;
+				extent_insert(sc->cursor,
+					(SLAB_BYTES / sc->bsize) * sc->bsize, cls);
+				++sc->slabs;
+			}
+			blk = (PFRTTypeG) sc->cursor;
+			sc->cursor += sc->bsize;
+		}
+		set_free_link(blk, tc->mags[cls]);
+		tc->mags[cls] = blk;
+	}
+	unlock_slab();
+	tc->rounds[cls] += MAG_BATCH;
+}
+
+//	Returns cnt blocks from the magazine to the depot
+
+static void magazine_flush(SlabCache *tc, ft cls, ft cnt) {
+	SlabClass *sc = &slab_classes[cls];
+	lock_slab();
+	for(ft i = 0; i < cnt; i++) {
+		PFRTTypeG blk = tc->mags[cls];
+		tc->mags[cls] = free_link(blk);
+		set_free_link(blk, sc->free);
+		sc->free = blk;
+	}
+	unlock_slab();
+	tc->rounds[cls] -= cnt;
+}
+
+//	Returns zeroed block of at least bsize bytes with
+//	the size class recorded in fsig
+
+static PFRTTypeG slab_alloc(SlabCache *tc, ft bsize) {
+	ft 			cls = 0;
+	PFRTTypeG 	res;
+	if(slab_ready == true && bsize <= SLAB_MAXBLOCK)
+		cls = slab_lookup[(bsize + sizeof(ft) - 1) / sizeof(ft)];
+	if(cls == 0) {
+		foidl_gc_safepoint();
+		LargeBlock *b = calloc(sizeof(LargeBlock) + bsize,1);
+		large_link(b, bsize);
+		return (PFRTTypeG) (b + 1);
+	}
+	if(tc->rounds[cls] == 0)
+		magazine_refill(tc, cls);
+	res = tc->mags[cls];
+	tc->mags[cls] = free_link(res);
+	--tc->rounds[cls];
+	++tc->inuse[cls];
+	memset(res, 0, slab_classes[cls].bsize);
+	res->fsig = cls;
+	return res;
+}
+
+static void slab_free(SlabCache *tc, PFRTTypeG g) {
+	ft 	cls = g->fsig & slab_class_mask;
+	if(cls == 0) {
+		large_unlink(LARGE_HDR(g));
+		free(LARGE_HDR(g));
+		return;
+	}
+	g->fsig = 0;
+	set_free_link(g, tc->mags[cls]);
+	tc->mags[cls] = g;
+	--tc->inuse[cls];
+	if(++tc->rounds[cls] > MAG_ROUNDS)
+		magazine_flush(tc, cls, MAG_BATCH);
+}
+
+//	Called by a runtime thread before it exits. Empties the
+//	magazines back to the depot and retires the statistics.
+//	Arena scopes left open are abandoned, not freed, as the
+//	thread result may still live in them
+
+void foidl_thread_cache_release() {
+	foidl_ref_thread_release();
+	foidl_profile_thread_release();
+	foidl_number_thread_release();
+	SlabCache *tc = slab_cache;
+	if(tc == NULL)
+		return;
+	for(ft i = 1; i <= slab_count; i++)
+		if(tc->rounds[i])
+			magazine_flush(tc, i, tc->rounds[i]);
+	lock_slab();
+	SlabCache **link = &slab_caches;
+	while(*link != tc)
+		link = &(*link)->next;
+	*link = tc->next;
+	for(ft i = 1; i <= slab_count; i++)
+		slab_retired.inuse[i] += tc->inuse[i];
+	slab_retired.unknown_allocs += tc->unknown_allocs;
+	slab_retired.general_allocs += tc->general_allocs;
+	slab_retired.global_allocs += tc->global_allocs;
+	slab_retired.unknown_free += tc->unknown_free;
+	slab_retired.general_free += tc->general_free;
+	slab_retired.global_free += tc->global_free;
+	slab_retired.arena_allocs += tc->arena_allocs;
+	unlock_slab();
+	slab_cache = NULL;
+	free(tc);
+}
+
+//	Merges the retired and live thread statistics
+
+static void merge_stats(SlabCache *res) {
+	lock_slab();
+	*res = slab_retired;
+	res->arena = NULL;
+	for(SlabCache *tc = slab_caches; tc; tc = tc->next) {
+		for(ft i = 1; i <= slab_count; i++)
+			res->inuse[i] += tc->inuse[i];
+		res->unknown_allocs += tc->unknown_allocs;
+		res->general_allocs += tc->general_allocs;
+		res->global_allocs += tc->global_allocs;
+		res->unknown_free += tc->unknown_free;
+		res->general_free += tc->general_free;
+		res->global_free += tc->global_free;
+		res->arena_allocs += tc->arena_allocs;
+	}
+	unlock_slab();
+}
+
+/*
+	Arena scopes
+
+	Between foidl_arena_begin_bang and foidl_arena_end_bang all
+	foidl_alloc/foidl_xall calls on the thread bump allocate from
+	a chain of chunks that is freed in one shot when the scope ends.
+	Arena blocks carry the arena_signature with the payload size in
+	the low word and are ignored by foidl_xdel. Scopes nest; results
+	that must outlive a scope are copied out with
+	foidl_arena_promote_bang. Work queued to other threads must not
+	hold arena objects; updates to runtime globals (string table,
+	extension registrar) bracket with foidl_arena_suspend/resume so
+	they always allocate from the heap
+*/
+
+#define ARENA_CHUNK 	(64 * 1024)
+
+typedef struct Arena {
+	char 	*cursor;		// Next free byte in current chunk
+	char 	*limit;			// End of current chunk
+	void 	*chunks;		// Chunk chain, linked through first word,
+							// chunk size in the second
+	struct Arena *outer;	// Enclosing scope
+} Arena;
+
+static void *arena_alloc(SlabCache *tc, ft sz) {
+	Arena 	*ar = tc->arena;
+	ft 		bsize = (sz + sizeof(ft) + sizeof(ft) - 1) & ~(sizeof(ft) - 1);
+	if(ar->cursor + bsize > ar->limit) {
+		ft 	csize = bsize + 2 * sizeof(void *) > ARENA_CHUNK ?
+			bsize + 2 * sizeof(void *) : ARENA_CHUNK;
+		void **chunk = calloc(csize,1);
+		chunk[0] = ar->chunks;
+		chunk[1] = (void *) csize;
+		ar->chunks = chunk;
+		ar->cursor = (char *) &chunk[2];
+		ar->limit = (char *) chunk + csize;
+	}
+	PFRTTypeG res = (PFRTTypeG) ar->cursor;
+	ar->cursor += bsize;
+	res->fsig = arena_signature | (sz & arena_size_mask);
+	++tc->arena_allocs;
+	return (void *)&res->fclass;
+}
+
+//	Calls fn with the used range of every chunk of the open arena
+//	scopes of all threads. Used by the collector with the world stopped
 
-static ft unknown_free = 0;
-static ft general_free = 0;
-static ft global_free = 0;
+void foidl_arena_walk(void (*fn)(char *, char *)) {
+	for(SlabCache *tc = slab_caches; tc; tc = tc->next)
+		for(Arena *ar = tc->arena; ar; ar = ar->outer)
+			for(void **chunk = ar->chunks; chunk; chunk = chunk[0])
+				fn((char *) &chunk[2], chunk == ar->chunks ? ar->cursor :
+					(char *) chunk + (ft) chunk[1]);
+}
 
 void foidl_memstats() {
+	SlabCache 	st;
+	merge_stats(&st);
 	printf("--------------- Allc ----------------------\n");
-	printf("Unknown allocations %llu\n", unknown_allocs);
-	printf("General allocations %llu\n", general_allocs);
-	printf("Global allocations %llu\n", global_allocs);
+	printf("Unknown allocations %llu\n", st.unknown_allocs);
+	printf("General allocations %llu\n", st.general_allocs);
+	printf("Global allocations %llu\n", st.global_allocs);
+	printf("Arena allocations %llu\n", st.arena_allocs);
 	printf("--------------- Free ----------------------\n");
-	printf("Unknown frees %llu\n", unknown_free);
-	printf("General frees %llu\n", general_free);
-	printf("Global frees %llu\n", global_free);
+	printf("Unknown frees %llu\n", st.unknown_free);
+	printf("General frees %llu\n", st.general_free);
+	printf("Global frees %llu\n", st.global_free);
+	printf("--------------- Slab ----------------------\n");
+	for(ft i = 1; i <= slab_count; i++)
+		if(slab_classes[i].slabs)
+			printf("Block %4llu slabs %llu in use %lld\n",
+				slab_classes[i].bsize, slab_classes[i].slabs,
+				st.inuse[i]);
 	printf("-------------------------------------------\n");
 }
 
 void * foidl_xall(uint32_t sz) {
-	PFRTTypeG res = calloc(sz+sizeof(ft),1);
-	res->fsig = unkwn_signature;
-	++unknown_allocs;
+	SlabCache *tc = thread_cache();
+	if(tc->arena)
+		return arena_alloc(tc, sz);
+	PFRTTypeG res = slab_alloc(tc, sz+sizeof(ft));
+	res->fsig |= unkwn_signature;
+	++tc->unknown_allocs;
+	return (void *)&res->fclass;
+}
+
+//	Allocation that ignores arena scopes, for data such as the
+//	number library values and buffers that outlive the scope
+
+void * foidl_xall_shared(uint32_t sz) {
+	SlabCache *tc = thread_cache();
+	PFRTTypeG res = slab_alloc(tc, sz+sizeof(ft));
+	res->fsig |= unkwn_signature;
+	++tc->unknown_allocs;
+	return (void *)&res->fclass;
+}
+
+//	Raw allocation the collector treats as a root, never swept or
+//	scanned. For data held where the collector does not look: number
+//	library statics, C++ containers and the keyword table
+
+void * foidl_xall_root(uint32_t sz) {
+	SlabCache *tc = thread_cache();
+	PFRTTypeG res = slab_alloc(tc, sz+sizeof(ft));
+	res->fsig |= unkwn_signature | raw_root;
+	++tc->unknown_allocs;
 	return (void *)&res->fclass;
-//	return calloc(sz,1);
 }
 
 void * foidl_alloc(ft sz) {
-	void *res = foidl_xall(sz);
-	PFRTTypeG g = res - sizeof(ft);
-	g->fsig = alloc_signature;
-	--unknown_allocs;
-	++general_allocs;
-	return res;
+	SlabCache *tc = thread_cache();
+	if(tc->arena)
+		return arena_alloc(tc, sz);
+	PFRTTypeG g = slab_alloc(tc, sz+sizeof(ft));
+	g->fsig |= alloc_signature;
+	++tc->general_allocs;
+	return (void *)&g->fclass;
 }
 
 void * foidl_galloc(ft sz) {
-	void *res = foidl_xall(sz);
-	PFRTTypeG g = res - sizeof(ft);
-	g->fsig = global_signature;
-	--unknown_allocs;
-	++global_allocs;
-	return res;
+	SlabCache *tc = thread_cache();
+	PFRTTypeG g = slab_alloc(tc, sz+sizeof(ft));
+	g->fsig |= global_signature;
+	++tc->global_allocs;
+	return (void *)&g->fclass;
 }
 
 void * foidl_xreall(void *p, uint32_t newsz) {
 	PFRTTypeG g = p - sizeof(ft);
-	if(g->fsig == alloc_signature || g->fsig == unkwn_signature) {
-		PFRTTypeG newg = realloc((void *) g, newsz);
+	ft 	sig = SIGOF(g);
+	ft 	cls = g->fsig & slab_class_mask;
+	if(sig == alloc_signature || sig == unkwn_signature) {
+		if(cls == 0) {
+			large_unlink(LARGE_HDR(g));
+			LargeBlock *b = realloc(LARGE_HDR(g),
+				sizeof(LargeBlock) + newsz + sizeof(ft));
+			if(b == NULL)
+				unknown_handler();
+			large_link(b, newsz + sizeof(ft));
+			return (void *)&((PFRTTypeG) (b + 1))->fclass;
+		}
+		ft 	bsize = slab_classes[cls].bsize;
+		if(newsz + sizeof(ft) <= bsize)
+			return p;
+		SlabCache *tc = thread_cache();
+		PFRTTypeG newg = slab_alloc(tc, newsz+sizeof(ft));
+		memcpy(&newg->fclass, p, bsize - sizeof(ft));
+		newg->fsig |= sig | (g->fsig & raw_root);
+		slab_free(tc, g);
 		return (void *)&newg->fclass;
 	}
+
+	else if(sig == arena_signature) {
+		ft 	oldsz = g->fsig & arena_size_mask;
+		if(newsz <= oldsz)
+			return p;
+		void *res = arena_alloc(thread_cache(), newsz);
+		memcpy(res, p, oldsz);
+		return res;
+	}
 	else {
 		unknown_handler();
 		return p;
@@ -88,16 +613,21 @@ void * foidl_xreall(void *p, uint32_t newsz) {
 
 void foidl_xdel(void *v) {
 	PFRTTypeG g = v - sizeof(ft);
-	if(g->fsig == alloc_signature) {
-		++general_free;
-		free(g);
+	SlabCache *tc = thread_cache();
+	ft 	sig = SIGOF(g);
+	if(sig == alloc_signature) {
+		++tc->general_free;
+		slab_free(tc, g);
+	}
+	else if(sig == global_signature){
+		++tc->global_free;
 	}
-	else if(g->fsig == global_signature){
-		++global_free;
+	else if(sig == unkwn_signature) {
+		++tc->unknown_free;
+		slab_free(tc, g);
 	}
-	else if(g->fsig == unkwn_signature) {
-		++unknown_free;
-		free(g);
+	else if(sig == arena_signature) {
+		;	// Reclaimed when the arena scope ends
 	}
 	else {
 		unknown_handler();
@@ -108,15 +638,354 @@ void foidl_delete(void *v) {
 	foidl_xdel(v);
 }
 
-void foidl_gc_init() {
-	if(gc_initialized == false) {
-		gc_initialized = true;
+//	Orders the heap blocks by address for foidl_heap_block and
+//	foidl_heap_walk. Called by the collector with the world stopped,
+//	the index is stale once blocks are freed
+
+static int large_order(const void *a, const void *b) {
+	char 	*x = ((const SlabExtent *) a)->base;
+	char 	*y = ((const SlabExtent *) b)->base;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+void foidl_heap_index() {
+	large_count = 0;
+	for(ft i = 0; i < LARGE_STRIPES; i++)
+		for(LargeBlock *b = large_stripes[i].first; b; b = b->next) {
+			if(large_count == large_size) {
+				ft 	nsize = large_size ? large_size * 2 : 256;
+				SlabExtent *ext = realloc(large_index, nsize * sizeof(SlabExtent));
+				if(ext == NULL)
+					unknown_handler();
+				large_index = ext;
+				large_size = nsize;
+			}
+			large_index[large_count].base = (char *) (b + 1);
+			large_index[large_count].limit = (char *) (b + 1) + b->bytes;
+			large_index[large_count].cls = 0;
+			++large_count;
+		}
+	qsort(large_index, large_count, sizeof(SlabExtent), large_order);
+}
+
+static SlabExtent *extent_holding(SlabExtent *tab, ft cnt, char *p) {
+	ft 	at = extent_after(tab, cnt, p);
+	if(at == 0 || p >= tab[at-1].limit)
+		return NULL;
+	return &tab[at-1];
+}
+
+//	Resolves a, possibly interior, pointer to the live block
+//	holding it. Used by the collector with the world stopped
+
+PFRTTypeG foidl_heap_block(void *p, ft *bytes) {
+	SlabExtent 	*ext = extent_holding(slab_extents, extent_count, (char *) p);
+	if(ext == NULL)
+		ext = extent_holding(large_index, large_count, (char *) p);
+	if(ext == NULL)
+		return NULL;
+	ft 	bsize = ext->cls ? slab_classes[ext->cls].bsize :
+		(ft) (ext->limit - ext->base);
+	PFRTTypeG g = (PFRTTypeG)
+		(ext->base + (((char *) p - ext->base) / bsize) * bsize);
+	ft 	sig = SIGOF(g);
+	if(sig != alloc_signature && sig != unkwn_signature
+		&& sig != global_signature)
+		return NULL;
+	*bytes = bsize;
+	return g;
+}
+
+//	Calls fn for every live block, free blocks have a zero fsig
+
+static void walk_extents(SlabExtent *tab, ft cnt, void (*fn)(PFRTTypeG, ft)) {
+	for(ft i = 0; i < cnt; i++) {
+		SlabExtent 	*ext = &tab[i];
+		ft 	bsize = ext->cls ? slab_classes[ext->cls].bsize :
+			(ft) (ext->limit - ext->base);
+		for(char *b = ext->base; b < ext->limit; b += bsize) {
+			ft 	sig = SIGOF((PFRTTypeG) b);
+			if(sig == alloc_signature || sig == unkwn_signature
+				|| sig == global_signature)
+				fn((PFRTTypeG) b, bsize);
+		}
+	}
+}
+
+void foidl_heap_walk(void (*fn)(PFRTTypeG, ft)) {
+	walk_extents(slab_extents, extent_count, fn);
+	walk_extents(large_index, large_count, fn);
+}
+
+PFRTAny 	*allocRawAnyArray(ft);
+
+//	Copies made by one promotion, keyed by the arena object, so a
+//	value shared inside the graph is copied once
+
+typedef struct ArenaCopies {
+	ft 		count;
+	ft 		size;			// Power of two
+	PFRTAny *from;
+	PFRTAny *to;
+} ArenaCopies;
+
+static ft copies_at(ArenaCopies *cp, PFRTAny s) {
+	ft 	i = ((ft) s >> 4) & (cp->size - 1);
+	while(cp->from[i] != NULL && cp->from[i] != s)
+		i = (i + 1) & (cp->size - 1);
+	return i;
+}
+
+static PFRTAny copies_get(ArenaCopies *cp, PFRTAny s) {
+	return cp->size ? cp->to[copies_at(cp, s)] : NULL;
+}
+
+static void copies_put(ArenaCopies *cp, PFRTAny s, PFRTAny res) {
+	if((cp->count + 1) * 2 > cp->size) {
+		ArenaCopies old = *cp;
+		cp->size = old.size ? old.size * 2 : 64;
+		cp->from = calloc(cp->size, sizeof(PFRTAny));
+		cp->to = calloc(cp->size, sizeof(PFRTAny));
+		if(cp->from == NULL || cp->to == NULL)
+			unknown_handler();
+		for(ft i = 0; i < old.size; i++)
+			if(old.from[i] != NULL) {
+				ft 	at = copies_at(cp, old.from[i]);
+				cp->from[at] = old.from[i];
+				cp->to[at] = old.to[i];
+			}
+		free(old.from);
+		free(old.to);
+	}
+	ft 	at = copies_at(cp, s);
+	cp->from[at] = s;
+	cp->to[at] = res;
+	++cp->count;
+}
+
+//	Copies an arena object graph to the enclosing allocator
+//	Non arena objects are returned as is. Every store of a copy
+//	is counted like the allocators count it
+
+static PFRTAny arena_copy(ArenaCopies *cp, PFRTAny s) {
+	PFRTTypeG g = ANYTOG(s);
+	if(SIGOF(g) != arena_signature)
+		return s;
+	PFRTAny res = copies_get(cp, s);
+	if(res != NULL)
+		return res;
+	ft 		sz = g->fsig & arena_size_mask;
+	res = foidl_alloc(sz);
+	memcpy(res, s, sz);
+	copies_put(cp, s, res);
+	switch(res->fclass) {
+		case 	scalar_class:
+			if(res->ftype == string_type || res->ftype == keyword_type) {
+				res->value = foidl_xall(res->count+1);
+				memcpy(res->value, s->value, res->count);
+			}
+			else if(res->ftype == regex_type)
+				res->value = arena_copy(cp, res->value);
+			break;
+		case 	collection_class:
+			switch(res->ftype) {
+				case 	list2_type:
+					{
+						PFRTList l = (PFRTList) res;
+						l->root = (PFRTLinkNode) foidl_retain(arena_copy(cp, (PFRTAny) l->root));
+						l->rest = l->count > 1 ? l->root->next : empty_link;
+						l->last = l->root;
+						for(ft i = 1; i < l->count; i++)
+							l->last = l->last->next;
+						l->skips = NULL;
+					}
+					break;
+				case 	linknode_type:
+					{
+						PFRTLinkNode ln = (PFRTLinkNode) res;
+						ln->data = foidl_retain(arena_copy(cp, ln->data));
+						while(SIGOF(ANYTOG(ln->next)) == arena_signature) {
+							PFRTLinkNode src = ln->next;
+							PFRTLinkNode done = (PFRTLinkNode) copies_get(cp, (PFRTAny) src);
+							if(done != NULL) {
+								ln->next = done;
+								break;
+							}
+							ln->next = foidl_alloc(sizeof(struct FRTLinkNode));
+							*ln->next = *src;
+							copies_put(cp, (PFRTAny) src, (PFRTAny) ln->next);
+							foidl_retain((PFRTAny) ln->next);
+							ln = ln->next;
+							ln->data = foidl_retain(arena_copy(cp, ln->data));
+						}
+						foidl_retain((PFRTAny) ln->next);
+					}
+					break;
+				case 	vector2_type:
+					{
+						PFRTVector v = (PFRTVector) res;
+						v->root = (PFRTHamtNode) foidl_retain(arena_copy(cp, (PFRTAny) v->root));
+						v->tail = (PFRTHamtNode) foidl_retain(arena_copy(cp, (PFRTAny) v->tail));
+					}
+					break;
+				case 	map2_type:
+				case 	set2_type:
+					((PFRTAssocType) res)->root = (PFRTBitmapNode)
+						foidl_retain(arena_copy(cp, (PFRTAny)((PFRTAssocType) res)->root));
+					break;
+				case 	sortedmap_type:
+				case 	sortedset_type:
+					((PFRTSorted) res)->root = (PFRTSortNode)
+						foidl_retain(arena_copy(cp, (PFRTAny)((PFRTSorted) res)->root));
+					break;
+				case 	bytearray_type:
+				case 	intarray_type:
+				case 	floatarray_type:
+					((PFRTPrimArray) res)->data = (PFRTPrimData)
+						foidl_retain(arena_copy(cp, (PFRTAny)((PFRTPrimArray) res)->data));
+					break;
+				case 	mapentry_type:
+					((PFRTMapEntry) res)->key =
+						foidl_retain(arena_copy(cp, ((PFRTMapEntry) res)->key));
+					((PFRTMapEntry) res)->value =
+						foidl_retain(arena_copy(cp, ((PFRTMapEntry) res)->value));
+					break;
+				case 	series_type:
+					((PFRTSeries) res)->start =
+						foidl_retain(arena_copy(cp, ((PFRTSeries) res)->start));
+					((PFRTSeries) res)->stop =
+						foidl_retain(arena_copy(cp, ((PFRTSeries) res)->stop));
+					((PFRTSeries) res)->step =
+						foidl_retain(arena_copy(cp, ((PFRTSeries) res)->step));
+					break;
+				default:
+					unknown_handler();
+			}
+			break;
+		case 	hamptnode_class:
+		case 	rrbnode_class:
+			for(ft i = 0; i < WCNT; i++)
+				((PFRTHamtNode) res)->slots[i] =
+					foidl_retain(arena_copy(cp, ((PFRTHamtNode) res)->slots[i]));
+			break;
+		case 	primdata_class:
+			break;
+		case 	function_class:
+			if(res->ftype == funcinst_type)
+				((PFRTFuncRef2) res)->args =
+					foidl_retain(arena_copy(cp, ((PFRTFuncRef2) res)->args));
+			else if(res->ftype == lambref_type)
+				((PFRTLambdaRef) res)->ffuncref = (PFRTFuncRef)
+					arena_copy(cp, (PFRTAny) ((PFRTLambdaRef) res)->ffuncref);
+			else if(res->ftype != funcref_type)
+				unknown_handler();
+			break;
+		case 	sortnode_class:
+			for(ft i = 0; i < WCNT; i++) {
+				((PFRTSortNode) res)->keys[i] =
+					foidl_retain(arena_copy(cp, ((PFRTSortNode) res)->keys[i]));
+				((PFRTSortNode) res)->slots[i] =
+					foidl_retain(arena_copy(cp, ((PFRTSortNode) res)->slots[i]));
+			}
+			break;
+		case 	bitmapnode_class:
+			{
+				PFRTBitmapNode 	bn = (PFRTBitmapNode) res;
+				PFRTTypeG 		sg = ANYTOG(bn->slots);
+				if(bn->slots != emtndarray && SIGOF(sg) == arena_signature) {
+					ft 	slen = (sg->fsig & arena_size_mask) / sizeof(PFRTAny);
+					PFRTAny *slots = allocRawAnyArray(slen);
+					for(ft i = 0; i < slen; i++)
+						slots[i] = foidl_retain(arena_copy(cp, bn->slots[i]));
+					bn->slots = slots;
+				}
+			}
+			break;
+		case 	iterator_class:
+		case 	io_class:
+		case 	worker_class:
+		case 	response_class:
+			printf("Arena promote: iterators, channels and workers can not leave an arena scope\n");
+			unknown_handler();
+			break;
+		default:
+			unknown_handler();
 	}
+	return res;
+}
+
+//	Opens a new (nested) arena scope on the calling thread
+
+PFRTAny foidl_arena_begin_bang() {
+	SlabCache *tc = thread_cache();
+	Arena *ar = calloc(1,sizeof(Arena));
+	ar->outer = tc->arena;
+	tc->arena = ar;
+	return true;
+}
+
+//	Closes the innermost arena scope, freeing everything
+//	allocated in it
+
+PFRTAny foidl_arena_end_bang() {
+	SlabCache *tc = thread_cache();
+	Arena *ar = tc->arena;
+	if(ar == NULL)
+		return nil;
+	tc->arena = ar->outer;
+	void **chunk = ar->chunks;
+	while(chunk) {
+		void **next = chunk[0];
+		free(chunk);
+		chunk = next;
+	}
+	free(ar);
+	return true;
+}
+
+//	Copies s out of the innermost arena scope to the enclosing
+//	scope (or the general heap)
+
+PFRTAny foidl_arena_promote_bang(PFRTAny s) {
+	SlabCache *tc = thread_cache();
+	Arena *ar = tc->arena;
+	if(ar == NULL)
+		return s;
+	ArenaCopies cp = {0, 0, NULL, NULL};
+	tc->arena = ar->outer;
+	PFRTAny res = arena_copy(&cp, s);
+	tc->arena = ar;
+	free(cp.from);
+	free(cp.to);
+	return res;
+}
+
+//	Steps out of all arena scopes of the calling thread so
+//	allocations go to the heap until foidl_arena_resume is
+//	called with the returned state
+
+void *foidl_arena_suspend() {
+	SlabCache *tc = thread_cache();
+	void *ar = tc->arena;
+	tc->arena = NULL;
+	return ar;
+}
 
+void foidl_arena_resume(void *ar) {
+	thread_cache()->arena = ar;
 }
 
-void foidl_release(void *v) {
+//	Copies s out of every arena scope to the heap, for values
+//	stored in runtime globals
 
+PFRTAny foidl_arena_detach(PFRTAny s) {
+	ArenaCopies cp = {0, 0, NULL, NULL};
+	void 	*ar = foidl_arena_suspend();
+	PFRTAny res = arena_copy(&cp, s);
+	foidl_arena_resume(ar);
+	free(cp.from);
+	free(cp.to);
+	return res;
 }
 
 //	Object Types
@@ -127,6 +996,7 @@ PFRTAny    allocAny(ft fclass, ft ftype, void *value) {
 	s->ftype  = ftype;
 	s->value  = value;
 	s->count  = 1;
+	profile_alloc(ftype, sizeof (struct FRTType));
 	return s;
 }
 
@@ -138,6 +1008,7 @@ PFRTAny allocStringWithBufferSize (uint32_t cnt) {
 	s->ftype  = string_type;
 	s->value  = (void *)newp;
 	s->count  = cnt;
+	profile_alloc(string_type, sizeof (struct FRTType) + cnt + 1);
 	return s;
 }
 
@@ -153,11 +1024,14 @@ PFRTAny allocGlobalStringCopy(char *v) {
 	return c;
 }
 
-PFRTAny allocGlobalKeywordCopy(char *v) {
+//	Keywords live as long as the runtime, even when first seen in
+//	an arena scope
+
+PFRTAny allocGlobalKeywordCopy(char *v, uint32_t plen) {
 	PFRTAny 	c = (PFRTAny) foidl_galloc(sizeof (struct FRTType));
-	uint32_t plen = strlen(v);
-	char 	*newp = foidl_xall(plen+1);
-	strcpy(newp,v);
+	char 	*newp = foidl_xall_shared(plen+1);
+	memcpy(newp,v,plen);
+	newp[plen] = 0;
 	c->fclass = scalar_class;
 	c->ftype  = keyword_type;
 	c->count  = plen;
@@ -165,6 +1039,16 @@ PFRTAny allocGlobalKeywordCopy(char *v) {
 	return c;
 }
 
+//	Frees a keyword copy that lost the race to be interned, nothing
+//	else can refer to it
+
+void releaseGlobalKeywordCopy(PFRTAny kw) {
+	SlabCache *tc = thread_cache();
+	foidl_xdel(kw->value);
+	++tc->global_free;
+	slab_free(tc, ANYTOG(kw));
+}
+
 PFRTAny allocGlobalString(char *v) {
 	PFRTAny 	c = (PFRTAny) foidl_galloc(sizeof (struct FRTType));
 	c->fclass = scalar_class;
@@ -182,6 +1066,48 @@ PFRTAny allocStringWithCopyCnt(uint32_t cnt, char *p) {
 	s->ftype  = string_type;
 	s->value  = (void *)newp;
 	s->count  = cnt;
+	profile_alloc(string_type, sizeof (struct FRTType) + cnt + 1);
+	return s;
+}
+
+//	A slice of cnt characters at p that keeps owner alive. Slices of
+//	slices share the original owner. Inside an arena scope the
+//	characters are copied
+
+PFRTAny allocStringSlice(PFRTAny owner, char *p, uint32_t cnt) {
+	SlabCache *tc = thread_cache();
+	if(tc->arena)
+		return allocStringWithCopyCnt(cnt, p);
+	if(STR_SLICE(owner))
+		owner = ((PFRTStrSlice) owner)->owner;
+	//	A builder with slices cut from it stops growing in place
+	if(STR_BUILDER(owner))
+		((PFRTStrBuffer) owner)->capacity = ((PFRTStrBuffer) owner)->fill;
+	else if(SIGOF(ANYTOG(owner)) == alloc_signature)
+		foidl_sig_flags(owner, str_shared, 0);
+	PFRTStrSlice s = (PFRTStrSlice) foidl_alloc(sizeof (struct FRTStrSlice));
+	(ANYTOG(s))->fsig |= str_slice;
+	s->fclass = scalar_class;
+	s->ftype  = string_type;
+	s->value  = (void *)p;
+	s->count  = cnt;
+	s->owner  = foidl_retain(owner);
+	profile_alloc(string_type, sizeof (struct FRTStrSlice));
+	return (PFRTAny) s;
+}
+
+//	Heap string that ignores arena scopes, used as the hidden owner
+//	of slices
+
+PFRTAny allocStringShared(uint32_t cnt) {
+	PFRTTypeG 	g = slab_alloc(thread_cache(), sizeof (struct FRTType) + sizeof(ft));
+	g->fsig |= alloc_signature;
+	PFRTAny 	s = (PFRTAny) &g->fclass;
+	s->fclass = scalar_class;
+	s->ftype  = string_type;
+	s->value  = foidl_xall_shared(cnt+1);
+	s->count  = cnt;
+	profile_alloc(string_type, sizeof (struct FRTType) + cnt + 1);
 	return s;
 }
 
@@ -191,6 +1117,7 @@ PFRTAny allocStringWithCptr(char *p, long int cnt) {
 	s->ftype  = string_type;
 	s->value  = (void *)p;
 	s->count  = (ft) cnt;
+	profile_alloc(string_type, sizeof (struct FRTType));
 	return s;
 }
 
@@ -203,22 +1130,54 @@ PFRTAny allocStringWithCopy(char *p) {
 	s->ftype  = string_type;
 	s->value  = (void *)newp;
 	s->count  = plen;
+	profile_alloc(string_type, sizeof (struct FRTType) + plen + 1);
 	return s;
 }
 
 PFRTAny allocAndConcatString(uint32_t tlen,
 		char *base, uint32_t bcnt, char *p1, uint32_t p1cnt) {
 	char 	*newp = foidl_xall(tlen+1);
-	strcpy(newp,base);
-	strncpy(&newp[bcnt],p1,p1cnt);
+	memcpy(newp,base,bcnt);
+	memcpy(&newp[bcnt],p1,p1cnt);
 	PFRTAny 	s = (PFRTAny) foidl_alloc(sizeof (struct FRTType));
 	s->fclass = scalar_class;
 	s->ftype  = string_type;
 	s->value  = (void *)newp;
 	s->count  = tlen;
+	profile_alloc(string_type, sizeof (struct FRTType) + tlen + 1);
 	return s;
 }
 
+//	Concatenation with room to grow, returned as the tip slice of a
+//	new builder. Both ignore arena scopes, the tip is grown in place
+//	by string_extend_bang
+
+#define BUILDER_MIN 	64
+
+PFRTAny allocStringBuilder(uint32_t tlen,
+		char *base, uint32_t bcnt, char *p1, uint32_t p1cnt) {
+	uint32_t 		cap = tlen < BUILDER_MIN / 2 ? BUILDER_MIN : tlen * 2;
+	PFRTStrBuffer 	b = (PFRTStrBuffer) allocStringShared(cap);
+	char 			*newp = (char *) b->value;
+	(ANYTOG(b))->fsig |= str_builder;
+	b->capacity = cap;
+	b->fill = tlen;
+	memcpy(newp,base,bcnt);
+	memcpy(&newp[bcnt],p1,p1cnt);
+	newp[tlen] = 0;
+	PFRTTypeG 		g = slab_alloc(thread_cache(), sizeof (struct FRTStrSlice) + sizeof(ft));
+	g->fsig |= alloc_signature | str_slice;
+	PFRTStrSlice 	s = (PFRTStrSlice) &g->fclass;
+	s->fclass = scalar_class;
+	s->ftype  = string_type;
+	s->value  = (void *)newp;
+	s->count  = tlen;
+	s->owner  = foidl_retain((PFRTAny) b);
+	foidl_release_temp((PFRTAny) b);
+	profile_alloc(string_type, sizeof (struct FRTStrSlice));
+	return (PFRTAny) s;
+}
+
 PFRTAny allocRegex(PFRTAny sbase, void* regex) {
 	PFRTRegEx 	s = (PFRTRegEx) foidl_alloc(sizeof (struct FRTRegEx));
 	s->fclass = scalar_class;
@@ -227,6 +1186,7 @@ PFRTAny allocRegex(PFRTAny sbase, void* regex) {
 	s->count  = sbase->count;
 	s->hash   = sbase->hash;
 	s->regex  = regex;
+	profile_alloc(regex_type, sizeof (struct FRTRegEx));
 	return (PFRTAny) s;
 
 }
@@ -250,6 +1210,9 @@ PFRTIOChannel allocFileChannel(PFRTAny name, PFRTAny mode, PFRTAny args) {
 	fc->name   = name;
 	fc->mode   = mode;
 	fc->settings = args;
+	fc->lines  = nil;
+	fc->lpos   = 0;
+	profile_alloc(file_type, sizeof(struct FRTIOFileChannel));
 	return (PFRTIOChannel) fc;
 }
 
@@ -259,6 +1222,7 @@ PFRTResponse allocResponse(ft ftype, PFRTAny resp) {
 	fc->ftype  = ftype;
 	fc->count  = 1;
 	fc->value  = (void *)resp;
+	profile_alloc(ftype, sizeof(struct FRTResponse));
 	return fc;
 }
 
@@ -270,8 +1234,9 @@ PFRTFuncRef2 allocFuncRef2(void *fn, ft maxarg, invoke_funcptr ifn) {
 	fr->ftype  = funcinst_type;
 	fr->mcount = maxarg;
 	fr->fnptr  = fn;
-	fr->args   = foidl_vector_inst_bang();
+	fr->args   = foidl_retain(foidl_vector_inst_bang());
 	fr->invokefnptr = ifn;
+	profile_alloc(funcinst_type, sizeof (struct FRTFuncRef2));
 	return fr;
 }
 
@@ -282,6 +1247,7 @@ PFRTWorker  allocWorker(PFRTFuncRef2 ref) {
 	wrk->count = 0;
 	wrk->fnptr = ref;
 	wrk->work_state = wrk_alloc;
+	profile_alloc(worker_type, sizeof(struct FRTWorker));
 	return wrk;
 }
 
@@ -292,6 +1258,7 @@ EXTERNC PFRTThread      allocThread(PFRTThreadPool poolref, int id) {
 	pthrd->count = 0;
 	pthrd->pool_parent = (void *)poolref;
 	pthrd->thid = id;
+	profile_alloc(thread_type, sizeof(struct FRTThread));
 	return pthrd;
 }
 
@@ -309,12 +1276,16 @@ PFRTThreadPool allocThreadPool() {
 	tp->pause_work = false;
 	tp->block_queue = false;
 	tp->stop_work = false;
+	profile_alloc(thrdpool_type, sizeof(struct FRTThreadPool));
 	return  tp;
 }
 
 //	Collection related
 
-PFRTLinkNode   allocLinkNode() {
+//	The unprofiled node and slot array builders let the constructors
+//	below record the allocation against themselves
+
+static PFRTLinkNode link_node() {
 	PFRTLinkNode l = (PFRTLinkNode) foidl_alloc(sizeof(struct FRTLinkNode));
 	l->fclass = collection_class;
 	l->ftype  = linknode_type;
@@ -323,12 +1294,35 @@ PFRTLinkNode   allocLinkNode() {
 	return l;
 }
 
+static PFRTAny *raw_any_array(ft cnt) {
+	PFRTAny *res = (PFRTAny *) foidl_alloc(cnt * sizeof(PFRTAny));
+	for(ft i = 0; i < cnt;i++) res[i] = end;
+	return res;
+}
+
+static PFRTBitmapNode bitmap_node() {
+	PFRTBitmapNode a = (PFRTBitmapNode)
+		foidl_alloc(sizeof(struct FRTBitmapNode));
+	a->fclass = bitmapnode_class;
+	a->datamap = 0;
+	a->nodemap = 0;
+	a->edit = 0;
+	a->slots = (PFRTAny *) emtndarray;
+	return a;
+}
+
+PFRTLinkNode   allocLinkNode() {
+	profile_alloc(linknode_type, sizeof(struct FRTLinkNode));
+	return link_node();
+}
+
 PFRTLinkNode   allocLinkNodeWith(PFRTAny data, PFRTLinkNode nextNode) {
-	PFRTLinkNode l = allocLinkNode();
+	PFRTLinkNode l = link_node();
+	profile_alloc(linknode_type, sizeof(struct FRTLinkNode));
 	l->fclass = collection_class;
 	l->ftype  = linknode_type;
-	l->data   = data;
-	l->next   = nextNode;
+	l->data   = foidl_retain(data);
+	l->next   = (PFRTLinkNode) foidl_retain((PFRTAny) nextNode);
 	return l;
 }
 
@@ -338,8 +1332,11 @@ PFRTList   allocList(ft cnt, PFRTLinkNode root) {
 	l->ftype  = list2_type;
 	l->count  = cnt;
 	l->hash   = 0;
-	l->root   = root;
+	l->root   = (PFRTLinkNode) foidl_retain((PFRTAny) root);
 	l->rest   = empty_link;
+	l->last   = root;
+	l->skips  = NULL;
+	profile_alloc(list2_type, sizeof(struct FRTList));
 	return l;
 }
 
@@ -350,10 +1347,13 @@ PFRTVector allocVector(ft cnt, ft shift, PFRTHamtNode root,
 	a->ftype  = vector2_type;
 	a->count  = cnt;
 	a->hash   = 0;
-	a->root   = root;
-	a->tail   = tail;
+	a->root   = (PFRTHamtNode) foidl_retain((PFRTAny) root);
+	a->tail   = (PFRTHamtNode) foidl_retain((PFRTAny) tail);
 	a->shift  = shift;
 	a->hash   = (ft) 0;
+	a->edit   = 0;
+	a->unhashed = 0;
+	profile_alloc(vector2_type, sizeof(struct FRTVector));
 	return a;
 }
 
@@ -362,9 +1362,11 @@ PFRTSet allocSet(ft cnt, ft shift, PFRTBitmapNode root) {
 	a->fclass = collection_class;
 	a->ftype  = set2_type;
 	a->count  = cnt;
-	a->root   = root;
+	a->root   = (PFRTBitmapNode) foidl_retain((PFRTAny) root);
 	a->shift  = shift;
 	a->hash   = 0;
+	a->edit   = 0;
+	profile_alloc(set2_type, sizeof(struct FRTSet));
 	return a;
 }
 
@@ -373,9 +1375,44 @@ PFRTMap allocMap(ft cnt, ft shift, PFRTBitmapNode root) {
 	a->fclass = collection_class;
 	a->ftype  = map2_type;
 	a->count  = cnt;
-	a->root   = root;
+	a->root   = (PFRTBitmapNode) foidl_retain((PFRTAny) root);
 	a->shift  = shift;
 	a->hash   = 0;
+	a->edit   = 0;
+	profile_alloc(map2_type, sizeof(struct FRTMap));
+	return a;
+}
+
+PFRTSorted allocSorted(ft ftype, PFRTSortNode root) {
+	PFRTSorted a = (PFRTSorted) foidl_alloc(sizeof(struct FRTSorted));
+	a->fclass = collection_class;
+	a->ftype  = ftype;
+	a->count  = 0;
+	a->hash   = 0;
+	a->root   = (PFRTSortNode) foidl_retain((PFRTAny) root);
+	profile_alloc(ftype, sizeof(struct FRTSorted));
+	return a;
+}
+
+PFRTPrimData allocPrimData(uint32_t width, ft capacity) {
+	ft 	sz = sizeof(struct FRTPrimData) + width * capacity;
+	PFRTPrimData d = (PFRTPrimData) foidl_alloc(sz);
+	d->fclass   = primdata_class;
+	d->width    = width;
+	d->fill     = 0;
+	d->capacity = capacity;
+	profile_alloc(primdata_class, sz);
+	return d;
+}
+
+PFRTPrimArray allocPrimArray(ft ftype, ft cnt, PFRTPrimData data) {
+	PFRTPrimArray a = (PFRTPrimArray) foidl_alloc(sizeof(struct FRTPrimArray));
+	a->fclass = collection_class;
+	a->ftype  = ftype;
+	a->count  = cnt;
+	a->hash   = 0;
+	a->data   = (PFRTPrimData) foidl_retain((PFRTAny) data);
+	profile_alloc(ftype, sizeof(struct FRTPrimArray));
 	return a;
 }
 
@@ -383,8 +1420,9 @@ PFRTMapEntry allocMapEntryWith(PFRTAny key, PFRTAny value) {
 	PFRTMapEntry me = (PFRTMapEntry) foidl_alloc(sizeof(struct FRTMapEntry));
 	me->fclass = collection_class;
 	me->ftype  = mapentry_type;
-	me->key    = key;
-	me->value  = value;
+	me->key    = foidl_retain(key);
+	me->value  = foidl_retain(value);
+	profile_alloc(mapentry_type, sizeof(struct FRTMapEntry));
 	return me;
 }
 
@@ -392,58 +1430,87 @@ PFRTSeries 	allocSeries() {
 	PFRTSeries s = (PFRTSeries) foidl_alloc(sizeof(struct FRTSeries));
 	s->fclass = collection_class;
 	s->ftype  = series_type;
+	profile_alloc(series_type, sizeof(struct FRTSeries));
 	return s;
 }
 
 //	Generic array allocator
 
 PFRTAny 	*allocRawAnyArray(ft cnt) {
-	PFRTAny *res = (PFRTAny *) foidl_alloc(cnt * sizeof(PFRTAny));
-	for(ft i = 0; i < cnt;i++) res[i] = end;
-	return res;
+	profile_alloc(profile_slots, cnt * sizeof(PFRTAny));
+	return raw_any_array(cnt);
 }
 
 PFRTBitmapNode allocNode() {
-	PFRTBitmapNode a = (PFRTBitmapNode)
-		foidl_alloc(sizeof(struct FRTBitmapNode));
-	a->fclass = bitmapnode_class;
-	a->datamap = 0;
-	a->nodemap = 0;
-	a->slots = (PFRTAny *) emtndarray;
-	return a;
+	profile_alloc(bitmapnode_class, sizeof(struct FRTBitmapNode));
+	return bitmap_node();
 }
 
 PFRTHamtNode allocHamtNode() {
 	PFRTHamtNode a = (PFRTHamtNode) foidl_alloc(sizeof(struct FRTHamtNode));
 	a->fclass = hamptnode_class;
+	a->edit = 0;
 	for(ft i=0; i < WCNT; i++) a->slots[i] = end;
+	profile_alloc(hamptnode_class, sizeof(struct FRTHamtNode));
+	return a;
+}
+
+PFRTRrbNode allocRrbNode() {
+	PFRTRrbNode a = (PFRTRrbNode) foidl_alloc(sizeof(struct FRTRrbNode));
+	a->fclass = rrbnode_class;
+	a->edit = 0;
+	for(ft i=0; i < WCNT; i++) {
+		a->slots[i] = end;
+		a->sizes[i] = 0;
+	}
+	profile_alloc(rrbnode_class, sizeof(struct FRTRrbNode));
+	return a;
+}
+
+PFRTSortNode allocSortNode(uint32_t leaf) {
+	PFRTSortNode a = (PFRTSortNode) foidl_alloc(sizeof(struct FRTSortNode));
+	a->fclass = sortnode_class;
+	a->count = 0;
+	a->leaf = leaf;
+	a->size = 0;
+	a->hash = 0;
+	for(ft i=0; i < WCNT; i++) {
+		a->keys[i] = end;
+		a->slots[i] = end;
+	}
+	profile_alloc(sortnode_class, sizeof(struct FRTSortNode));
 	return a;
 }
 
 PFRTBitmapNode allocNodeWith(uint32_t datamap,
 	uint32_t nodemap, ft slen) {
-	PFRTBitmapNode res = allocNode();
+	PFRTBitmapNode res = bitmap_node();
 	res->datamap = datamap;
 	res->nodemap = nodemap;
-	res->slots   = (PFRTAny*) allocRawAnyArray(slen);
+	res->slots   = raw_any_array(slen);
+	profile_alloc(bitmapnode_class,
+		sizeof(struct FRTBitmapNode) + slen * sizeof(PFRTAny));
 	return res;
 }
 
 PFRTBitmapNode allocNodeClone(PFRTBitmapNode src, ft slen) {
-	PFRTBitmapNode res = allocNode();
+	PFRTBitmapNode res = bitmap_node();
 	res->datamap = src->datamap;
 	res->nodemap = src->nodemap;
-	res->slots   = allocRawAnyArray(slen);
-	for(ft i = 0; i < slen;i++) res->slots[i] = src->slots[i];
+	res->slots   = raw_any_array(slen);
+	for(ft i = 0; i < slen;i++) res->slots[i] = foidl_retain(src->slots[i]);
+	profile_alloc(bitmapnode_class,
+		sizeof(struct FRTBitmapNode) + slen * sizeof(PFRTAny));
 	return res;
 }
 
 PFRTBitmapNode allocNodeWithAll(uint32_t datamap,
 	uint32_t nodemap,PFRTAny *slots) {
-	PFRTBitmapNode res = allocNode();
+	PFRTBitmapNode res = bitmap_node();
 	res->datamap = datamap;
 	res->nodemap = nodemap;
 	res->slots   = slots;
+	profile_alloc(bitmapnode_class, sizeof(struct FRTBitmapNode));
 	return res;
 }
 
@@ -457,6 +1524,8 @@ PFRTIterator allocStringIterator(PFRTAny str, itrNext next) {
     i->str = (char *) str->value;   //  Base string
     i->slen = str->count;
     i->index = -1;      			//  Last fetched element
+    i->string = foidl_retain(str);
+	profile_alloc(string_iterator_type, sizeof(struct FRTString_Iterator));
 	return (PFRTIterator) i;
 }
 
@@ -470,6 +1539,8 @@ PFRTIterator allocTrieIterator(PFRTAssocType base,itrNext next) {
 	i->next   = next;
 	i->get 	  = base->ftype == map2_type ? mapGetDefault : setGetDefault;
 	i->currentStackLevel = -1;
+	i->root = base->root;
+	foidl_retain((PFRTAny) base->root);
 	if(node_arity != 0) {
 		i->currentStackLevel = 0;
 		i->nodes[0] = base->root;
@@ -481,32 +1552,69 @@ PFRTIterator allocTrieIterator(PFRTAssocType base,itrNext next) {
 		i->currentValueCursor = 0;
 		i->currentValueLength = payload_arity;
 	}
+	profile_alloc(i->ftype, sizeof(struct FRTTrie_Iterator));
 	return (PFRTIterator) i;
 }
 
 PFRTIterator allocVectorIterator(PFRTVector v,itrNext next) {
 	PFRTVector_Iterator	vi = (PFRTVector_Iterator)
 		foidl_alloc(sizeof(struct FRTVector_Iterator));
-	PFRTHamtNode vn = (PFRTHamtNode)vectorGetDefault((PFRTAny)  v,0);
 	vi->fclass = iterator_class;
 	vi->ftype  = vector_iterator_type;
 	vi->next   = next;
 	vi->get    = vectorGetDefault;
-	vi->vector = v;
+	vi->vector = (PFRTVector) foidl_retain((PFRTAny) v);
 	vi->index  = 0;
-	vi->base   = vi->index - (vi->index % 32);
-	vi->node   = (vi->index < v->count) ? vn : (PFRTHamtNode) end;
+	vi->base   = 0;
+	vi->limit  = 0;
+	vi->node   = (PFRTHamtNode) end;
+	profile_alloc(vector_iterator_type, sizeof(struct FRTVector_Iterator));
 	return (PFRTIterator) vi;
 }
 
+PFRTIterator allocSortedIterator(PFRTSorted s, itrNext next) {
+	PFRTSorted_Iterator si = (PFRTSorted_Iterator)
+		foidl_alloc(sizeof(struct FRTSorted_Iterator));
+	PFRTSortNode 	n = s->root;
+	si->fclass = iterator_class;
+	si->ftype  = sorted_iterator_type;
+	si->next   = next;
+	si->get    = NULL;
+	si->sorted = (PFRTSorted) foidl_retain((PFRTAny) s);
+	si->depth  = 0;
+	si->nodes[0] = n;
+	si->index[0] = 0;
+	while(n->leaf == 0) {
+		n = (PFRTSortNode) n->slots[0];
+		si->nodes[++si->depth] = n;
+		si->index[si->depth] = 0;
+	}
+	profile_alloc(sorted_iterator_type, sizeof(struct FRTSorted_Iterator));
+	return (PFRTIterator) si;
+}
+
+PFRTIterator allocPrimIterator(PFRTPrimArray a, itrNext next) {
+	PFRTPrim_Iterator pi = (PFRTPrim_Iterator)
+		foidl_alloc(sizeof(struct FRTPrim_Iterator));
+	pi->fclass = iterator_class;
+	pi->ftype  = prim_iterator_type;
+	pi->next   = next;
+	pi->get    = NULL;
+	pi->array  = (PFRTPrimArray) foidl_retain((PFRTAny) a);
+	pi->index  = 0;
+	profile_alloc(prim_iterator_type, sizeof(struct FRTPrim_Iterator));
+	return (PFRTIterator) pi;
+}
+
 PFRTIterator allocListIterator(PFRTList l, itrNext next) {
 	PFRTList_Iterator li = (PFRTList_Iterator)
 		foidl_alloc(sizeof(struct FRTList_Iterator));
 	li->fclass = iterator_class;
-	li->ftype  = vector_iterator_type;
+	li->ftype  = list_iterator_type;
 	li->next   = next;
-	li->list   = l;
+	li->list   = (PFRTList) foidl_retain((PFRTAny) l);
 	li->node   = l->root;
+	profile_alloc(list_iterator_type, sizeof(struct FRTList_Iterator));
 	return (PFRTIterator) li;
 }
 
@@ -519,7 +1627,8 @@ PFRTIterator allocSeriesIterator(PFRTSeries s, itrNext next) {
 	li->counter = -1;
 	li->initialValue = nil;
 	li->lastValue = nil;
-	li->series = s;
+	li->series = (PFRTSeries) foidl_retain((PFRTAny) s);
+	profile_alloc(series_iterator_type, sizeof(struct FRTSeries_Iterator));
 	return (PFRTIterator) li;
 }
 
@@ -530,8 +1639,9 @@ PFRTIterator allocChannelIterator(PFRTIOChannel cb, itrNext next) {
 	ci->fclass = iterator_class;
 	ci->ftype  = channel_iterator_type;
 	ci->next   = next;
-	ci->channel = cb;
+	ci->channel = (PFRTIOChannel) foidl_retain((PFRTAny) cb);
 	ci->currRef = 0;
+	profile_alloc(channel_iterator_type, sizeof(struct FRTChannel_Iterator));
 	return (PFRTIterator) ci;
 }
 
@@ -540,19 +1650,12 @@ PFRTIterator allocChannelIterator(PFRTIOChannel cb, itrNext next) {
 //	Deallocators
 //
 
-/*
-	FuncRef2 args (vector) should only have to release
-	level 0 root node and the tail node
-*/
+//	The args vector goes back through the counts so the arguments
+//	it holds are decremented
 
 void deallocFuncRef2(PFRTFuncRef2 fref) {
-	PFRTVector pv = (PFRTVector) fref->args;
+	PFRTAny args = fref->args;
 	foidl_delete(fref);
-	if(pv != empty_vector) {
-		if(pv->tail != empty_node)
-			foidl_delete(pv->tail);
-		if(pv->root != empty_node)
-			foidl_delete(pv->root);
-		foidl_delete(pv);
-	}
+	foidl_unref(args);
+	foidl_release_temp(args);
 }
@@ -56,6 +56,9 @@ PFRTAny 	foidl_rtl_init() {
 	if(foidl_rtl_initialized == false) {
 		//foidl_heap_setup();
 		//foidl_gc_init();
+		foidl_rtl_init_allocators();
+		foidl_rtl_init_hash();
+		foidl_rtl_init_keywords();
 		foidl_rtl_init_chars();
 		foidl_rtl_init_globals();
 		foidl_rtl_init_file_channel();
@@ -75,6 +78,8 @@ PFRTAny 	foidl_rtl_init() {
 //	Application entry point
 
 PFRTAny 	foidl_convert_mainargs(int argc, char **as, char **es) {
+	foidl_gc_register_root(&foidl_env);
+	foidl_gc_register_root(&foidl_argv);
 	foidl_gc_init();
 	genEnvMap(es);
 	foidl_argv = vector_from_argv(argc,as);
@@ -134,8 +139,16 @@ PFRTAny 	foidl_get(PFRTAny coll, PFRTAny el) {
 				return map_get(coll,el);
 			case 	set2_type:
 				return set_get(coll,el);
+			case 	sortedmap_type:
+			case 	sortedset_type:
+				return sorted_get(coll,el);
+			case 	bytearray_type:
+			case 	intarray_type:
+			case 	floatarray_type:
+				return prim_get(coll,el);
 			case 	list2_type:
 				return list_get(coll,el);
+			case 	keyword_type:
 			case 	string_type:
 				return string_get(coll,el);
 			default:
@@ -163,9 +176,19 @@ PFRTAny 	foidl_getd(PFRTAny coll, PFRTAny el, PFRTAny def) {
 			case 	set2_type:
 				result = set_get_default(coll,el,def);
 				break;
+			case 	sortedmap_type:
+			case 	sortedset_type:
+				result = sorted_get_default(coll,el,def);
+				break;
+			case 	bytearray_type:
+			case 	intarray_type:
+			case 	floatarray_type:
+				result = prim_get_default(coll,el,def);
+				break;
 			case 	list2_type:
 				result = list_get_default(coll,el,def);
 				break;
+			case 	keyword_type:
 			case 	string_type:
 				result = string_get_default(coll,el,def);
 				break;
@@ -194,6 +217,12 @@ PFRTAny foidl_indexof(PFRTAny coll, PFRTAny arg) {
 		case 	list2_type:
 			result = list_index_of(coll, arg);
 			break;
+		case 	bytearray_type:
+		case 	intarray_type:
+		case 	floatarray_type:
+			result = prim_index_of(coll, arg);
+			break;
+		case 	keyword_type:
 		case 	string_type:
 			// result = string_first(a);
 			break;
@@ -218,9 +247,19 @@ PFRTAny 	foidl_first(PFRTAny a) {
 		case 	map2_type:
 			result = map_first(a);
 			break;
+		case 	sortedmap_type:
+		case 	sortedset_type:
+			result = sorted_first(a);
+			break;
+		case 	bytearray_type:
+		case 	intarray_type:
+		case 	floatarray_type:
+			result = prim_first(a);
+			break;
 		case 	list2_type:
 			result = list_first(a);
 			break;
+		case 	keyword_type:
 		case 	string_type:
 			result = string_first(a);
 			break;
@@ -245,9 +284,19 @@ PFRTAny foidl_second(PFRTAny a) {
 		case 	map2_type:
 			result = map_second(a);
 			break;
+		case 	sortedmap_type:
+		case 	sortedset_type:
+			result = sorted_second(a);
+			break;
+		case 	bytearray_type:
+		case 	intarray_type:
+		case 	floatarray_type:
+			result = prim_second(a);
+			break;
 		case 	list2_type:
 			result = list_second(a);
 			break;
+		case 	keyword_type:
 		case 	string_type:
 			result =  string_second(a);
 			break;
@@ -263,7 +312,7 @@ PFRTAny 	foidl_rest(PFRTAny a) {
 	if(foidl_extendable_qmark(a) == false)
 		return result;
 
-	if((foidl_collection_qmark(a) || a->ftype == string_type) &&
+	if((foidl_collection_qmark(a) || string_type_qmark(a) == true) &&
 		a->count > 0) {
 		switch(a->ftype) {
 			case 	vector2_type:
@@ -275,9 +324,14 @@ PFRTAny 	foidl_rest(PFRTAny a) {
 			case 	map2_type:
 				result = map_rest(a);
 				break;
+			case 	sortedmap_type:
+			case 	sortedset_type:
+				result = sorted_rest(a);
+				break;
 			case 	list2_type:
 				result = list_rest(a);
 				break;
+			case 	keyword_type:
 			case 	string_type:
 				result =  string_rest(a);
 				break;
@@ -290,7 +344,7 @@ PFRTAny 	foidl_rest(PFRTAny a) {
 
 PFRTAny 	foidl_last(PFRTAny a) {
 	PFRTAny result = a;
-	if((foidl_collection_qmark(a) || a->ftype == string_type) &&
+	if((foidl_collection_qmark(a) || string_type_qmark(a) == true) &&
 		a->count > 0) {
 		switch(a->ftype) {
 			case 	vector2_type:
@@ -302,9 +356,19 @@ PFRTAny 	foidl_last(PFRTAny a) {
 			case 	map2_type:
 				unknown_handler();
 				break;
+			case 	sortedmap_type:
+			case 	sortedset_type:
+				result = sorted_last(a);
+				break;
+			case 	bytearray_type:
+			case 	intarray_type:
+			case 	floatarray_type:
+				result = prim_last(a);
+				break;
 			case 	list2_type:
 				result =  list_last(a);
 				break;
+			case 	keyword_type:
 			case 	string_type:
 				result =  string_last(a);
 				break;
@@ -321,6 +385,8 @@ PFRTAny 	foidl_extendKV(PFRTAny coll, PFRTAny key, PFRTAny value) {
 	PFRTAny res = nil;
 	if(coll->ftype == map2_type)
 		res = map_extend(coll,key,value);
+	else if(coll->ftype == sortedmap_type)
+		res = sorted_assoc(coll,key,value);
 	else
 		unknown_handler();
 	return res;
@@ -330,6 +396,8 @@ PFRTAny 	foidl_extendKV_bang(PFRTAny coll, PFRTAny key, PFRTAny value) {
 	PFRTAny res = nil;
 	if(coll->ftype == map2_type)
 		res = foidl_map_extend_bang(coll,key,value);
+	else if(coll->ftype == sortedmap_type)
+		res = sorted_assoc_bang(coll,key,value);
 	else
 		unknown_handler();
 	return res;
@@ -341,6 +409,24 @@ PFRTAny 	foidl_extend(PFRTAny coll, PFRTAny element) {
 		case 	set2_type:
 			result = set_extend(coll,element);
 			break;
+		case 	sortedset_type:
+			result = sorted_extend(coll,element);
+			break;
+		case 	bytearray_type:
+		case 	intarray_type:
+		case 	floatarray_type:
+			result = prim_extend(coll,element);
+			break;
+		case 	sortedmap_type:
+			if(element->fclass == collection_class && element->count == 2) {
+				result = sorted_assoc(coll,
+						foidl_first(element),
+						foidl_second(element));
+			}
+			else {
+				foidl_ep_excp(extend_map_two_arg);
+			}
+			break;
 		case 	vector2_type:
 			result = vector_extend(coll,element);
 			break;
@@ -372,6 +458,22 @@ PFRTAny 	foidl_extend_bang(PFRTAny coll, PFRTAny element) {
 		case 	set2_type:
 			result = foidl_set_extend_bang(coll,element);
 			break;
+		case 	sortedset_type:
+			result = sorted_extend_bang(coll,element);
+			break;
+		case 	bytearray_type:
+		case 	intarray_type:
+		case 	floatarray_type:
+			result = prim_extend_bang(coll,element);
+			break;
+		case 	sortedmap_type:
+			if(element->fclass == collection_class && element->count == 2)
+				result = sorted_assoc_bang(coll,
+					foidl_first(element),
+					foidl_second(element));
+			else
+				unknown_handler();
+			break;
 		case 	vector2_type:
 			result = foidl_vector_extend_bang(coll,element);
 			break;
@@ -395,7 +497,7 @@ PFRTAny 	foidl_extend_bang(PFRTAny coll, PFRTAny element) {
 			result = list_push_bang(coll,element);
 			break;
 		case 	string_type:
-			string_extend_bang(coll,element);
+			result = string_extend_bang(coll,element);
 			break;
 	}
 
@@ -418,7 +520,7 @@ PFRTAny 	drop_fn(ft cnt, PFRTAny lbang, PFRTIterator rI) {
 	while((iNext = iteratorNext(rI)) != end) {
 		foidl_list_extend_bang(lbang, iNext);
 	}
-	foidl_xdel(rI);
+	iteratorRelease(rI);
 	return result;
 
 }
@@ -428,6 +530,8 @@ PFRTAny 	foidl_drop(PFRTAny arg, PFRTAny coll) {
 	if( foidl_number_qmark(arg) == true) {
 		val = number_toft(arg);
 		if( foidl_collection_qmark(coll) == true && (val <= (ft)coll->count)) {
+			if(coll->ftype == vector2_type)
+				return vector_slice(coll, val, coll->count);
 			PFRTAny lbang = foidl_list_inst_bang();
 			if(val == (ft)coll->count)
 				return lbang;
@@ -456,7 +560,7 @@ PFRTAny 	foidl_drop_bang(PFRTAny coll, PFRTAny arg) {
 }
 
 PFRTAny 	foidl_drop_last(PFRTAny coll) {
-	if(coll->ftype == string_type)
+	if(string_type_qmark(coll) == true)
 		return string_droplast(coll);
 	else if(coll->ftype == vector2_type)
 		return vector_droplast(coll);
@@ -469,7 +573,7 @@ PFRTAny 	foidl_drop_last(PFRTAny coll) {
 }
 
 PFRTAny 	foidl_droplast_bang(PFRTAny coll) {
-	if(coll->ftype == string_type)
+	if(string_type_qmark(coll) == true)
 		return string_droplast_bang(coll);
 	else if(coll->ftype == vector2_type)
 		return vector_dropLast_bang(coll);
@@ -499,6 +603,8 @@ PFRTAny 	foidl_take(PFRTAny arg, PFRTAny coll) {
 		val = number_toft(arg);
 
 		if( foidl_collection_qmark(coll) && val < (ft)coll->count) {
+			if(coll->ftype == vector2_type)
+				return vector_slice(coll, 0, val);
 			PFRTAny lbang = foidl_list_inst_bang();
 			if(val == 0)
 				return lbang;
@@ -514,6 +620,166 @@ PFRTAny 	foidl_take(PFRTAny arg, PFRTAny coll) {
 }
 
 
+// split_at: cnt coll
+// vector of the first cnt elements and the rest
+
+PFRTAny 	foidl_split_at(PFRTAny arg, PFRTAny coll) {
+	PFRTAny 	res = foidl_vector_inst_bang();
+	foidl_vector_extend_bang(res, foidl_take(arg, coll));
+	foidl_vector_extend_bang(res, foidl_drop(arg, coll));
+	return res;
+}
+
+// Vector slicing and joining, these share structure with their
+// arguments
+
+PFRTAny 	foidl_subvec(PFRTAny coll, PFRTAny start, PFRTAny stop) {
+	if(coll->ftype != vector2_type || start->ftype != number_type
+		|| stop->ftype != number_type)
+		unknown_handler();
+	return vector_slice(coll, number_toft(start), number_toft(stop));
+}
+
+PFRTAny 	foidl_concat(PFRTAny lhs, PFRTAny rhs) {
+	if(lhs->ftype != vector2_type || rhs->ftype != vector2_type)
+		unknown_handler();
+	return vector_concat(lhs, rhs);
+}
+
+PFRTAny 	foidl_insert(PFRTAny coll, PFRTAny index, PFRTAny v) {
+	if(coll->ftype != vector2_type || index->ftype != number_type)
+		unknown_handler();
+	return vector_insert(coll, number_toft(index), v);
+}
+
+PFRTAny 	foidl_union(PFRTAny lhs, PFRTAny rhs) {
+	if(lhs->ftype != set2_type || rhs->ftype != set2_type)
+		unknown_handler();
+	return set_union(lhs, rhs);
+}
+
+PFRTAny 	foidl_intersect(PFRTAny lhs, PFRTAny rhs) {
+	if(lhs->ftype != set2_type || rhs->ftype != set2_type)
+		unknown_handler();
+	return set_intersect(lhs, rhs);
+}
+
+PFRTAny 	foidl_difference(PFRTAny lhs, PFRTAny rhs) {
+	if(lhs->ftype != set2_type || rhs->ftype != set2_type)
+		unknown_handler();
+	return set_difference(lhs, rhs);
+}
+
+PFRTAny 	foidl_merge(PFRTAny lhs, PFRTAny rhs) {
+	if(lhs->ftype != map2_type || rhs->ftype != map2_type)
+		unknown_handler();
+	return map_merge(lhs, rhs);
+}
+
+//	Sorted map and set from any collection's elements, for maps each
+//	is a map entry or two element collection
+
+PFRTAny 	foidl_sorted_map(PFRTAny coll) {
+	if(foidl_collection_qmark(coll) != true)
+		unknown_handler();
+	PFRTIterator 	itr = iteratorFor(coll);
+	PFRTAny 		res = sorted_from_iterator(sortedmap_type, itr);
+	iteratorRelease(itr);
+	return res;
+}
+
+PFRTAny 	foidl_sorted_set(PFRTAny coll) {
+	if(foidl_collection_qmark(coll) != true)
+		unknown_handler();
+	PFRTIterator 	itr = iteratorFor(coll);
+	PFRTAny 		res = sorted_from_iterator(sortedset_type, itr);
+	iteratorRelease(itr);
+	return res;
+}
+
+static void validateSorted(PFRTAny coll) {
+	if(coll->ftype != sortedmap_type && coll->ftype != sortedset_type)
+		unknown_handler();
+}
+
+//	Keys from lo up to, not including, hi. nil leaves an end open
+
+PFRTAny 	foidl_subrange(PFRTAny coll, PFRTAny lo, PFRTAny hi) {
+	validateSorted(coll);
+	return sorted_subrange(coll, lo, hi);
+}
+
+PFRTAny 	foidl_floor_of(PFRTAny coll, PFRTAny k) {
+	validateSorted(coll);
+	return sorted_floor(coll, k);
+}
+
+PFRTAny 	foidl_ceiling_of(PFRTAny coll, PFRTAny k) {
+	validateSorted(coll);
+	return sorted_ceiling(coll, k);
+}
+
+//	Unboxed arrays from any collection's elements
+
+static PFRTAny primArray(ft ftype, PFRTAny coll) {
+	if(coll->ftype == ftype)
+		return coll;
+	if(foidl_collection_qmark(coll) != true)
+		unknown_handler();
+	PFRTIterator 	itr = iteratorFor(coll);
+	PFRTAny 		res = prim_from_iterator(ftype, itr);
+	iteratorRelease(itr);
+	return res;
+}
+
+PFRTAny 	foidl_byte_array(PFRTAny coll) {
+	return primArray(bytearray_type, coll);
+}
+
+PFRTAny 	foidl_int_array(PFRTAny coll) {
+	return primArray(intarray_type, coll);
+}
+
+PFRTAny 	foidl_float_array(PFRTAny coll) {
+	return primArray(floatarray_type, coll);
+}
+
+static void validatePrim(PFRTAny coll) {
+	if(coll->fclass != collection_class || (coll->ftype != bytearray_type
+		&& coll->ftype != intarray_type && coll->ftype != floatarray_type))
+		unknown_handler();
+}
+
+PFRTAny 	foidl_sum_of(PFRTAny coll) {
+	validatePrim(coll);
+	return prim_sum(coll);
+}
+
+PFRTAny 	foidl_min_of(PFRTAny coll) {
+	validatePrim(coll);
+	return prim_min(coll);
+}
+
+PFRTAny 	foidl_max_of(PFRTAny coll) {
+	validatePrim(coll);
+	return prim_max(coll);
+}
+
+PFRTAny 	foidl_dot(PFRTAny lhs, PFRTAny rhs) {
+	validatePrim(lhs);
+	return prim_dot(lhs, rhs);
+}
+
+PFRTAny 	foidl_elem_add(PFRTAny lhs, PFRTAny rhs) {
+	validatePrim(lhs);
+	return prim_elem_add(lhs, rhs);
+}
+
+PFRTAny 	foidl_elem_mul(PFRTAny lhs, PFRTAny rhs) {
+	validatePrim(lhs);
+	return prim_elem_mul(lhs, rhs);
+}
+
 //	Update takes three args: Collection location and value
 //	For all, value may be a function otherwise a new value
 //	For vectors: location is a numeric index
@@ -525,7 +791,9 @@ PFRTAny 	foidl_take(PFRTAny arg, PFRTAny coll) {
 static PFRTAny validateIndexable(PFRTAny coll,PFRTAny indx) {
 	PFRTAny 	isIndex = indx->ftype == number_type ? true : false;
 	if(coll->ftype == list2_type || coll->ftype == vector2_type
-		|| coll->ftype == string_type || coll->ftype == keyword_type) {
+		|| coll->ftype == string_type || coll->ftype == keyword_type
+		|| coll->ftype == bytearray_type || coll->ftype == intarray_type
+		|| coll->ftype == floatarray_type) {
 		if(isIndex == false)
 			foidl_ep_excp(update_not_integral);
 		else if(number_toft(indx) >= coll->count)
@@ -552,9 +820,17 @@ PFRTAny 	foidl_update(PFRTAny coll, PFRTAny k, PFRTAny v) {
 					case 	map2_type:
 						result = map_update(coll,k,finalValue);
 						break;
+					case 	sortedmap_type:
+						result = sorted_assoc(coll,k,finalValue);
+						break;
 					case 	vector2_type:
 						result = vector_update(coll,k,finalValue);
 						break;
+					case 	bytearray_type:
+					case 	intarray_type:
+					case 	floatarray_type:
+						result = prim_update(coll,k,finalValue);
+						break;
 					case 	set2_type:
 						unknown_handler();
 						break;
@@ -562,6 +838,7 @@ PFRTAny 	foidl_update(PFRTAny coll, PFRTAny k, PFRTAny v) {
 				break;
 			case 	scalar_class:
 				switch(coll->ftype) {
+					case 	keyword_type:
 					case 	string_type:
 						result = string_update(coll,k,finalValue);
 						break;
@@ -586,11 +863,19 @@ PFRTAny 	foidl_update_bang(PFRTAny coll, PFRTAny k, PFRTAny v) {
 						result = list_update_bang(coll,k,finalValue);
 						break;
 					case 	map2_type:
-						unknown_handler();
+						result = foidl_map_extend_bang(coll,k,finalValue);
+						break;
+					case 	sortedmap_type:
+						result = sorted_assoc_bang(coll,k,finalValue);
 						break;
 					case 	vector2_type:
 						result = vector_update_bang(coll,k,finalValue);
 						break;
+					case 	bytearray_type:
+					case 	intarray_type:
+					case 	floatarray_type:
+						result = prim_update_bang(coll,k,finalValue);
+						break;
 					case 	set2_type:
 						unknown_handler();
 						break;
@@ -598,6 +883,7 @@ PFRTAny 	foidl_update_bang(PFRTAny coll, PFRTAny k, PFRTAny v) {
 				break;
 			case 	scalar_class:
 				switch(coll->ftype) {
+					case 	keyword_type:
 					case 	string_type:
 						result = string_update_bang(coll,k,finalValue);
 						break;
@@ -683,6 +969,46 @@ PFRTAny foidl_push_bang(PFRTAny coll,PFRTAny value) {
 	return coll;
 }
 
+//	Transients are valid for vectors, maps, sets and strings. The bang
+//	functions change a transient's own nodes in place and copy the
+//	ones still shared with the source. persistent! ends the edit
+
+PFRTAny foidl_transient_bang(PFRTAny coll) {
+	switch(coll->ftype) {
+		case 	vector2_type:
+			return vector_transient_bang(coll);
+		case 	map2_type:
+			return map_transient_bang(coll);
+		case 	set2_type:
+			return set_transient_bang(coll);
+		case 	string_type:
+			return string_transient_bang(coll);
+		default:
+			unknown_handler();
+	}
+	return coll;
+}
+
+PFRTAny foidl_persistent_bang(PFRTAny coll) {
+	switch(coll->ftype) {
+		case 	vector2_type:
+			((PFRTVector) coll)->edit = 0;
+			break;
+		case 	map2_type:
+			((PFRTMap) coll)->edit = 0;
+			break;
+		case 	set2_type:
+			((PFRTSet) coll)->edit = 0;
+			break;
+		case 	string_type:
+			string_persistent_bang(coll);
+			break;
+		default:
+			unknown_handler();
+	}
+	return coll;
+}
+
 // Reduced gens object to hopefully halt a reduction
 
 PFRTAny 	foidl_reduced(PFRTAny el) {
@@ -703,7 +1029,7 @@ PFRTAny 	foidl_apply(PFRTAny fn, PFRTAny coll) {
 
 static void verifyFold(PFRTAny fn, PFRTAny fnerr, PFRTAny coll, PFRTAny collerr) {
 	if(foidl_function_qmark(fn) == true) {
-		if(foidl_collection_qmark(coll) == true || coll->ftype == string_type)
+		if(foidl_collection_qmark(coll) == true || string_type_qmark(coll) == true)
 			return;
 		else {
 			foidl_ep_excp(collerr);
@@ -714,46 +1040,56 @@ static void verifyFold(PFRTAny fn, PFRTAny fnerr, PFRTAny coll, PFRTAny collerr)
 	}
 }
 
+PFRTAny 	foidl_merge_with(PFRTAny fn, PFRTAny lhs, PFRTAny rhs) {
+	if(foidl_function_qmark(fn) != true
+		|| lhs->ftype != map2_type || rhs->ftype != map2_type)
+		unknown_handler();
+	return map_merge_with(lhs, rhs, fn, dispatch2);
+}
+
+//	The loops below take the collection a chunk at a time, for vectors
+//	that is a leaf's slots
+
 static PFRTAny 	reduction(PFRTAny fn, PFRTAny accum, PFRTIterator rI) {
 	PFRTAny result = accum;
-	PFRTAny iNext;
-	while((iNext = iteratorNext(rI)) != end) {
-		PFRTFuncRef2 fref = (PFRTFuncRef2) foidl_fref_instance(fn);
-		foidl_imbue((PFRTAny) fref,result);
-		result = foidl_imbue((PFRTAny) fref,iNext);
-		deallocFuncRef2(fref);
-		if(result->ftype == reduced_type) {
-			PFRTAny redVal = result;
-			result = (PFRTAny) redVal->value;
-			foidl_xdel(redVal);
-			break;
+	PFRTAny one;
+	PFRTAny *elems;
+	ft 		n;
+	while((n = iteratorChunk(rI, &one, &elems)) > 0) {
+		for(ft i = 0; i < n; i++) {
+			result = dispatch2(fn, result, elems[i]);
+			if(result->ftype == reduced_type) {
+				PFRTAny redVal = result;
+				result = (PFRTAny) redVal->value;
+				foidl_xdel(redVal);
+				iteratorRelease(rI);
+				return result;
+			}
 		}
 	}
-	foidl_xdel(rI);
+	iteratorRelease(rI);
 	return result;
 }
 
 static PFRTAny 	reduction_bang(PFRTAny fn, PFRTAny accum, PFRTIterator rI) {
 	PFRTAny result = accum;
-	PFRTAny iNext;
-	while((iNext = iteratorNext(rI)) != end) {
-		PFRTFuncRef2 fref = (PFRTFuncRef2) foidl_fref_instance(fn);
-		foidl_imbue((PFRTAny) fref,result);
-		PFRTAny result2 = foidl_imbue((PFRTAny) fref,iNext);
-		deallocFuncRef2(fref);
-		if(result2->ftype == reduced_type) {
-			PFRTAny redVal = result2;
-			foidl_xdel(result);
-			result = (PFRTAny) redVal->value;
-			foidl_xdel(redVal);
-			break;
-		}
-		else {
+	PFRTAny one;
+	PFRTAny *elems;
+	ft 		n;
+	while((n = iteratorChunk(rI, &one, &elems)) > 0) {
+		for(ft i = 0; i < n; i++) {
+			PFRTAny result2 = dispatch2(fn, result, elems[i]);
 			foidl_xdel(result);
+			if(result2->ftype == reduced_type) {
+				result = (PFRTAny) result2->value;
+				foidl_xdel(result2);
+				iteratorRelease(rI);
+				return result;
+			}
 			result = result2;
 		}
 	}
-	foidl_xdel(rI);
+	iteratorRelease(rI);
 	return result;
 }
 
@@ -779,22 +1115,23 @@ PFRTAny 	foidl_reduce(PFRTAny fn, PFRTAny coll) {
 
 static PFRTAny 	map_fn(PFRTAny fn, PFRTIterator rI) {
 	PFRTAny result = foidl_list_inst_bang();
-	PFRTAny iNext;
-	while((iNext = iteratorNext(rI)) != end) {
-		PFRTFuncRef2 fref = (PFRTFuncRef2) foidl_fref_instance(fn);
-		PFRTAny result2 = foidl_imbue((PFRTAny) fref, iNext);
-		deallocFuncRef2(fref);
-		if(result2->ftype == reduced_type) {
-			PFRTAny redVal = (PFRTAny) result2->value;
-			foidl_list_extend_bang(result, redVal);
-			foidl_xdel(result2);
-			break;
-		}
-		else {
+	PFRTAny one;
+	PFRTAny *elems;
+	ft 		n;
+	while((n = iteratorChunk(rI, &one, &elems)) > 0) {
+		for(ft i = 0; i < n; i++) {
+			PFRTAny result2 = dispatch1(fn, elems[i]);
+			if(result2->ftype == reduced_type) {
+				PFRTAny redVal = (PFRTAny) result2->value;
+				foidl_list_extend_bang(result, redVal);
+				foidl_xdel(result2);
+				iteratorRelease(rI);
+				return result;
+			}
 			foidl_list_extend_bang(result, result2);
 		}
 	}
-	foidl_xdel(rI);
+	iteratorRelease(rI);
 	return result;
 }
 
@@ -814,24 +1151,22 @@ PFRTAny 	foidl_map(PFRTAny fn, PFRTAny coll) {
 
 static PFRTAny remove_fn(PFRTAny fn, PFRTIterator rI) {
 	PFRTAny result = foidl_list_inst_bang();
-	PFRTAny iNext;
-	while((iNext = iteratorNext(rI)) != end) {
-		PFRTFuncRef2 fref = (PFRTFuncRef2) foidl_fref_instance(fn);
-		PFRTAny result2 = foidl_imbue((PFRTAny) fref, iNext);
-		deallocFuncRef2(fref);
-		if(result2->ftype == reduced_type) {
-			foidl_xdel(result2);
-			break;
-		}
-		else {
-			if( foidl_falsey_qmark(result2) == true) {
-				foidl_list_extend_bang(result, iNext);
-			}
-			else {
+	PFRTAny one;
+	PFRTAny *elems;
+	ft 		n;
+	while((n = iteratorChunk(rI, &one, &elems)) > 0) {
+		for(ft i = 0; i < n; i++) {
+			PFRTAny result2 = dispatch1(fn, elems[i]);
+			if(result2->ftype == reduced_type) {
+				foidl_xdel(result2);
+				iteratorRelease(rI);
+				return result;
 			}
+			if( foidl_falsey_qmark(result2) == true)
+				foidl_list_extend_bang(result, elems[i]);
 		}
 	}
-	foidl_xdel(rI);
+	iteratorRelease(rI);
 	return result;
 }
 
@@ -847,23 +1182,29 @@ PFRTAny 	foidl_remove(PFRTAny pred, PFRTAny coll) {
 //	Flatten takes any nested combinations of collections and
 //	returns a vector of their contents
 
-static PFRTAny 	internal_fold_flatten(PFRTAny accum, PFRTAny v);
-localFunc(i_flat,2,internal_fold_flatten);
-
-static PFRTAny 	internal_fold_flatten(PFRTAny accum, PFRTAny v) {
-	if(foidl_collection_qmark(v) == true)
-		return reduction((PFRTAny) i_flat,accum,iteratorFor(v));
-	else if(v->ftype == mapentry_type)
-		return internal_fold_flatten(
-			internal_fold_flatten(accum,((PFRTMapEntry)v)->key),
-			((PFRTMapEntry)v)->value);
+static void 	internal_flatten(PVectorBuilder b, PFRTAny v) {
+	if(foidl_collection_qmark(v) == true) {
+		PFRTIterator 	itr = iteratorFor(v);
+		PFRTAny 		e;
+		while((e = iteratorNext(itr)) != end)
+			internal_flatten(b, e);
+		iteratorRelease(itr);
+	}
+	else if(v->ftype == mapentry_type) {
+		internal_flatten(b, ((PFRTMapEntry)v)->key);
+		internal_flatten(b, ((PFRTMapEntry)v)->value);
+	}
 	else
-		return foidl_extend_bang(accum,v);
+		vector_builder_add(b, v);
 }
 
 PFRTAny 	foidl_flatten(PFRTAny coll) {
-	if(foidl_collection_qmark(coll) == true && coll->count != 0)
-		return foidl_fold((PFRTAny) i_flat,foidl_vector_inst_bang(),coll);
+	struct VectorBuilder 	b;
+	if(foidl_collection_qmark(coll) == true && coll->count != 0) {
+		vector_builder_init(&b);
+		internal_flatten(&b, coll);
+		return vector_builder_finish(&b);
+	}
 	else
 		return (PFRTAny) empty_vector;
 }
@@ -909,15 +1250,8 @@ PFRTAny 	foidl_zip(PFRTAny coll1, PFRTAny coll2) {
 // are the 'n' element from either collection
 // if unequal lengths, the shorter collection controls
 
-static PFRTAny internal_zipmap(ft maxcnt, PFRTIterator cntrlI, PFRTIterator slvI) {
-	PFRTAny coll = foidl_map_inst_bang();
-	ft 	cnt = 0;
-	while(cnt < maxcnt) {
-		foidl_map_extend_bang(
-			coll,
-			iteratorNext(cntrlI), iteratorNext(slvI));
-		++cnt;
-	}
+static PFRTAny internal_zipmap(PFRTIterator cntrlI, PFRTIterator slvI) {
+	PFRTAny coll = map_from_keys_values(cntrlI, slvI);
 	foidl_xdel(cntrlI);
 	foidl_xdel(slvI);
 	return coll;
@@ -926,14 +1260,8 @@ static PFRTAny internal_zipmap(ft maxcnt, PFRTIterator cntrlI, PFRTIterator slvI
 PFRTAny 	foidl_zipmap(PFRTAny coll1, PFRTAny coll2) {
 	if(foidl_collection_qmark(coll1) == true
 		&& foidl_collection_qmark(coll2) == true) {
-		if(coll1->count != 0 && coll2->count != 0) {
-			ft maxcnt = coll1->count;
-			maxcnt = (maxcnt == coll2->count) ?
-							maxcnt
-							: (maxcnt < coll2->count) ?
-								maxcnt : coll2->count;
-			return internal_zipmap(maxcnt, iteratorFor(coll1), iteratorFor(coll2));
-		}
+		if(coll1->count != 0 && coll2->count != 0)
+			return internal_zipmap(iteratorFor(coll1), iteratorFor(coll2));
 	}
 	return empty_map;
 }
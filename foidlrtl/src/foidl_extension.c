@@ -63,8 +63,10 @@ static PFRTAny subtype_map_for_type(PFRTAny type_extension) {
     PFRTAny result = nil;
     result = map_get(registrar, type_extension);
     if(result == nil) {
+        void *ar = foidl_arena_suspend();
         result = foidl_map_inst_bang();
         foidl_map_extend_bang(registrar,type_extension,result);
+        foidl_arena_resume(ar);
     }
     return result;
 }
@@ -96,6 +98,7 @@ PFRTAny register_extension(PFRTAny descriptor) {
         unknown_handler();
     }
     else {
+        void *ar = foidl_arena_suspend();
         PFRTAny etype_map = map_get(registrar, base_type);
         if( etype_map == nil ) {
             etype_map = foidl_map_inst_bang();
@@ -103,12 +106,14 @@ PFRTAny register_extension(PFRTAny descriptor) {
         }
         PFRTAny subtype_map = map_get(etype_map, sub_type);
         if( subtype_map == nil ) {
+            descriptor = foidl_arena_detach(descriptor);
             foidl_map_extend_bang(etype_map,sub_type,descriptor);
         }
         else {
             printf("Extension subtype %s already exists\n", sub_type->value);
             unknown_handler();
         }
+        foidl_arena_resume(ar);
     }
     //writeCoutNl(registrar);
     return descriptor;
@@ -117,6 +122,7 @@ PFRTAny register_extension(PFRTAny descriptor) {
 // Pre-main initializer
 
 void foidl_rtl_init_extensions() {
+    foidl_gc_register_root(&registrar);
     registrar = foidl_map_inst_bang();
 }
 
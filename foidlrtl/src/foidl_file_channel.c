@@ -141,46 +141,6 @@ PFRTAny is_file_text(PFRTIOFileChannel channel) {
     return false;
 }
 
-// Line reader to nl information structure
-typedef struct _ffile_st {
-    long int spos;
-    long int epos;
-    int      skip;
-    int      ahead;
-    int      eof;
-} FileStat;
-
-// Counts characters to nl or EOF
-
-static FileStat count_to_nl(FILE *fptr) {
-    int ch;
-    FileStat ffs = {ftell(fptr),0,0,0,0};
-    while((ch = fgetc(fptr)) != EOF) {
-        if(ch == 0x0d || ch == 0x0a) {
-#ifdef _MSC_VER
-            ffs.skip = ffs.ahead=2;
-#else
-            ffs.skip = ffs.ahead=1;
-            if((ch=fgetc(fptr)) != EOF) {
-                if(ch == 0x0a || ch == 0x0d) {
-                    ffs.skip = ffs.ahead=2;
-                }
-                else {
-                    ffs.ahead = 2;
-                }
-            }
-#endif
-            break;
-        }
-        else {
-            ++ffs.epos;
-        }
-    }
-    ffs.eof = feof(fptr);
-
-    return ffs;
-}
-
 // Get size of file from file/stream descriptor
 
 static size_t file_size_desc(FILE *fptr) {
@@ -237,18 +197,113 @@ PFRTAny foidl_fexists_qmark(PFRTAny s) {
 }
 
 
-// Read a line into a string
+// Reads that may wait on a terminal, pipe or device run through
+// foidl_gc_blocking so a collection does not wait on them. They
+// must not allocate
 
-static PFRTAny read_txt_line(FILE *fptr) {
-    PFRTAny reof = file_eof;
-    FileStat ffs = count_to_nl(fptr);
-    if(ffs.epos) {
-        fseek(fptr, 0 - (ffs.epos + ffs.ahead), SEEK_CUR);
-        char *s = foidl_xall(ffs.epos+1);
-        int x = fread(s,ffs.epos,1,fptr);
-        fseek(fptr, ffs.skip, SEEK_CUR);
-        reof = allocStringWithCptr(s,ffs.epos);
+typedef struct ReadRequest {
+    FILE    *fptr;
+    char    *buffer;
+    size_t  size;
+    size_t  res;
+    int     ch;
+} ReadRequest;
+
+static void blocked_fread(void *arg) {
+    ReadRequest *rq = (ReadRequest *) arg;
+    rq->res = fread(rq->buffer, 1, rq->size, rq->fptr);
+}
+
+static void blocked_fgets(void *arg) {
+    ReadRequest *rq = (ReadRequest *) arg;
+    rq->res = fgets(rq->buffer, (int) rq->size, rq->fptr) != NULL;
+}
+
+static void blocked_fgetc(void *arg) {
+    ReadRequest *rq = (ReadRequest *) arg;
+    rq->ch = fgetc(rq->fptr);
+}
+
+static size_t blocking_fread(char *buffer, size_t size, FILE *fptr) {
+    ReadRequest rq = {fptr, buffer, size, 0, 0};
+    foidl_gc_blocking(blocked_fread, &rq);
+    return rq.res;
+}
+
+static int blocking_fgetc(FILE *fptr) {
+    ReadRequest rq = {fptr, NULL, 0, 0, 0};
+    foidl_gc_blocking(blocked_fgetc, &rq);
+    return rq.ch;
+}
+
+// Line reads go through a chunk of the file held by the channel.
+// Long lines are slices of the chunk with the terminator overwritten
+// by a NUL, a chunk is freed when its last line is. Short lines are
+// copied so one kept line does not hold a whole chunk
+
+#define LINE_CHUNK  (64 * 1024)
+#define LINE_COPY   (LINE_CHUNK / 64)   // Lines shorter than this are copied
+
+static int is_nl(char ch) {
+    return ch == 0x0d || ch == 0x0a;
+}
+
+// Replace the chunk, carrying the unread characters over
+
+static void refill_lines(PFRTIOFileChannel chan) {
+    PFRTAny     old = chan->lines;
+    uint32_t    left = old == nil ? 0 : old->count - chan->lpos;
+    uint32_t    size = left * 2 > LINE_CHUNK ? left * 2 : LINE_CHUNK;
+    PFRTAny     chunk = allocStringShared(size);
+    char        *v = (char *) chunk->value;
+    if(left)
+        memcpy(v, (char *) old->value + chan->lpos, left);
+    chunk->count = left + blocking_fread(v + left, size - left, (FILE *) chan->value);
+    v[chunk->count] = 0;
+    chan->lines = foidl_retain(chunk);
+    chan->lpos = 0;
+    foidl_release_temp(chunk);
+    if(old != nil)
+        foidl_unref(old);
+}
+
+static void drop_lines(PFRTIOFileChannel chan) {
+    if(chan->lines != nil)
+        foidl_unref(chan->lines);
+    chan->lines = nil;
+    chan->lpos = 0;
+}
+
+// Read a line into a string. A terminator is CR or LF, together with
+// a CR or LF that directly follows it. Empty lines read as file_eof
+
+static PFRTAny read_txt_line(PFRTIOFileChannel chan) {
+    FILE        *fptr = (FILE *) chan->value;
+    PFRTAny     reof = file_eof;
+    uint32_t    len = 0;
+    uint32_t    skip = 0;
+    char        *v;
+    uint32_t    avail;
+    if(chan->lines == nil)
+        refill_lines(chan);
+    for(;;) {
+        v = (char *) chan->lines->value + chan->lpos;
+        avail = chan->lines->count - chan->lpos;
+        while(len < avail && !is_nl(v[len]))
+            ++len;
+        // The terminator and the character after it must be in the chunk
+        if(len + 1 < avail || feof(fptr) || ferror(fptr))
+            break;
+        refill_lines(chan);
     }
+    if(len < avail)
+        skip = len + 1 < avail && is_nl(v[len + 1]) ? 2 : 1;
+    if(len) {
+        v[len] = 0;
+        reof = len < LINE_COPY ? allocStringWithCopyCnt(len, v) :
+            allocStringSlice(chan->lines, v, len);
+    }
+    chan->lpos += len + skip;
     return reof;
 }
 
@@ -261,7 +316,7 @@ static PFRTAny read_bin_line(FILE *fptr) {
 static PFRTAny read_txt_char(FILE *fptr) {
     int ch;
     PFRTAny reof = file_eof;
-    if((ch=fgetc(fptr)) != EOF) {
+    if((ch=blocking_fgetc(fptr)) != EOF) {
         reof = allocCharWithValue((ft) ch);
     }
     return reof;
@@ -276,7 +331,7 @@ static PFRTAny read_bin_char(FILE *fptr) {
 static PFRTAny read_txt_byte(FILE *fptr) {
     int ch;
     PFRTAny reof = file_eof;
-    if((ch=fgetc(fptr)) != EOF) {
+    if((ch=blocking_fgetc(fptr)) != EOF) {
         reof = allocAny(scalar_class,byte_type,(void *)(ft)ch);
     }
     return reof;
@@ -298,7 +353,7 @@ static PFRTAny render_txt_read(PFRTIOFileChannel channel) {
             feof = read_txt_char(fp);
             break;
         case    2:
-            feof = read_txt_line(fp);
+            feof = read_txt_line(channel);
             break;
         case    3:
             unknown_handler();
@@ -350,7 +405,9 @@ static PFRTAny foidl_channel_readfile(PFRTIOFileChannel channel) {
 static PFRTAny foidl_channel_read_cin(PFRTIOFileChannel channel) {
     char    buffer[1024];
     PFRTAny res = empty_string;
-    if(fgets(buffer, sizeof(buffer), (FILE *) channel->value) != NULL) {
+    ReadRequest rq = {(FILE *) channel->value, buffer, sizeof(buffer), 0, 0};
+    foidl_gc_blocking(blocked_fgets, &rq);
+    if(rq.res) {
         res = allocStringWithCopy(buffer);
     }
     else {
@@ -390,9 +447,10 @@ PFRTAny foidl_channel_quaf_bang(PFRTAny channel) {
     PFRTAny res = empty_string;
     PFRTIOFileChannel chan = (PFRTIOFileChannel) channel;
     if(chan->ftype == file_type) {
+        drop_lines(chan);
         size_t  buffsize = file_size_desc((FILE *)chan->value);
         char *s = foidl_xall(buffsize+1);
-        int x = fread(s,buffsize,1,(FILE *)chan->value);
+        blocking_fread(s,buffsize,(FILE *)chan->value);
         res = allocStringWithCptr(s,buffsize);
     }
     else {
@@ -407,7 +465,7 @@ static void io_file_scalar_txt_writer(FILE *chn, PFRTAny el) {
     switch(el->ftype) {
         case    keyword_type:
         case    string_type:
-            fprintf(chn,"%s", el->value);
+            fwrite(el->value, 1, el->count, chn);
             break;
         case    regex_type:
             {
@@ -465,11 +523,18 @@ static PFRTAny io_file_compound_txt_writer(PFRTAny channel, PFRTAny el) {
             write_list(channel, el, foidl_channel_file_write_bang);
             break;
         case    set2_type:
+        case    sortedset_type:
             write_set(channel, el, foidl_channel_file_write_bang);
             break;
         case    map2_type:
+        case    sortedmap_type:
             write_map(channel, el, foidl_channel_file_write_bang);
             break;
+        case    bytearray_type:
+        case    intarray_type:
+        case    floatarray_type:
+            write_prim(channel, el, foidl_channel_file_write_bang);
+            break;
         case    series_type:
             if((PFRTSeries) el == infinite)
                 io_file_scalar_txt_writer(channel->value, infserstr);
@@ -586,6 +651,7 @@ PFRTAny foidl_open_file_bang(PFRTAny args) {
 
 static PFRTAny close_file(PFRTIOFileChannel fc) {
     PFRTAny res = true;
+    drop_lines(fc);
     if( fclose((FILE *)fc->value) == EOF) {
         res = false;
     }
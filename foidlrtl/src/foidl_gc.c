@@ -0,0 +1,581 @@
+/*
+	foidl_gc.c
+	Library support for tracing garbage collection
+
+	Copyright Frank V. Castellucci
+	All Rights Reserved
+*/
+
+/*
+	Non moving mark and sweep collector
+
+	Roots are the module root tables emitted by the compiler (every
+	literal and variable global), runtime statics registered with
+	foidl_gc_register_root, the stacks of registered threads (main
+	and the worker/pool threads), pending reference count decrements,
+	open arena chunks, global blocks and raw blocks allocated with
+	foidl_xall_root. Stacks and the other raw blocks, once reached,
+	are scanned conservatively, heap and global objects are traced
+	using their class layouts. String and number values are marked
+	without being scanned.
+
+	A collection stops the world: mutators park at the allocation
+	safepoint (magazine refill) or the iteration poll, or are already
+	in a blocking wait (channel reads, naps, joins) entered through
+	foidl_gc_blocking. Collections run when the blocks handed out
+	since the last one exceed the live block count or on request
+	(foidl_gc_collect_bang).
+
+	Unreachable strings, keywords, numbers, collections, nodes,
+	functions, iterators and raw blocks are freed. Channels, workers
+	and regular expressions own system resources and are kept as
+	roots. The collector coexists with reference counting, objects it
+	frees are unreachable and so no longer counted by anything live.
+*/
+
+#define GC_IMPL
+
+#if !defined(_MSC_VER) && !defined(__APPLE__)
+#define _GNU_SOURCE
+#endif
+
+#include <foidlrt.h>
+#include <setjmp.h>
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL 	__declspec(thread)
+#define GC_NOINLINE 	__declspec(noinline)
+#define GC_NOSANITIZE
+#define GC_ADD(p,n) 	InterlockedExchangeAdd64((LONG64 *)(p),(LONG64)(n))
+#define GC_STACK_TOP(jb) ((char *) &(jb))
+#else
+#define THREAD_LOCAL 	__thread
+#define GC_NOINLINE 	__attribute__((noinline))
+#define GC_NOSANITIZE 	__attribute__((no_sanitize_address))
+#define GC_ADD(p,n) 	__sync_fetch_and_add((p),(n))
+#define GC_STACK_TOP(jb) ((char *) &(jb) < (char *) __builtin_frame_address(0) ? \
+	(char *) &(jb) : (char *) __builtin_frame_address(0))
+#endif
+
+#define GC_RUNNING 		0
+#define GC_STOPPED 		1		// Parked or in a blocking wait
+#define GC_MIN_TRIGGER 	(64 * 1024)	// Blocks between collections
+#define GC_REFILL 		32			// Blocks per allocator refill
+
+typedef struct GCThread {
+	char 	*base;			// Stack high end
+	char 	*top;			// Stack low end while stopped
+	ft 		*pending;		// Reference count decrements while stopped
+	ft 		pcount;
+	ft 		state;
+	struct GCThread *next;
+} GCThread;
+
+typedef struct GCStack {
+	ft 		count;
+	ft 		size;
+	void 	**items;
+} GCStack;
+
+static ft gc_collect();
+
+static GCThread 	*gc_threads = NULL;
+static THREAD_LOCAL GCThread *gc_self = NULL;
+static PFRTAny 		**gc_roots = NULL;
+static ft 			root_count = 0;
+static ft 			root_size = 0;
+static volatile ft 	gc_requested = 0;
+static ft 			gc_enabled = 0;
+static ft 			gc_allocated = 0;	// Blocks since the last collection
+static ft 			gc_trigger = GC_MIN_TRIGGER;
+static GCStack 		mark_stack = {0, 0, NULL};
+static GCStack 		root_marked = {0, 0, NULL};	// Marked raw root blocks
+static GCStack 		dead_blocks = {0, 0, NULL};
+
+#ifdef _MSC_VER
+static SRWLOCK 				gc_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE 	gc_stopped = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE 	gc_resume = CONDITION_VARIABLE_INIT;
+#else
+static pthread_mutex_t 		gc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t 		gc_stopped = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t 		gc_resume = PTHREAD_COND_INITIALIZER;
+#endif
+
+static void lock_gc() {
+#ifdef _MSC_VER
+	AcquireSRWLockExclusive(&gc_lock);
+#else
+	pthread_mutex_lock(&gc_lock);
+#endif
+}
+
+static void unlock_gc() {
+#ifdef _MSC_VER
+	ReleaseSRWLockExclusive(&gc_lock);
+#else
+	pthread_mutex_unlock(&gc_lock);
+#endif
+}
+
+static void wait_gc(void *cond) {
+#ifdef _MSC_VER
+	SleepConditionVariableSRW(cond, &gc_lock, INFINITE, 0);
+#else
+	pthread_cond_wait(cond, &gc_lock);
+#endif
+}
+
+static void signal_gc(void *cond) {
+#ifdef _MSC_VER
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
+
+static void gc_push(GCStack *st, void *item) {
+	if(st->count == st->size) {
+		ft 		nsize = st->size ? st->size * 2 : 1024;
+		void 	**items = realloc(st->items, nsize * sizeof(void *));
+		if(items == NULL)
+			unknown_handler();
+		st->items = items;
+		st->size = nsize;
+	}
+	st->items[st->count++] = item;
+}
+
+//	High end of the calling threads stack
+
+static char *stack_base() {
+#ifdef _MSC_VER
+	ULONG_PTR 	lo, hi;
+	GetCurrentThreadStackLimits(&lo, &hi);
+	return (char *) hi;
+#elif __APPLE__
+	return (char *) pthread_get_stackaddr_np(pthread_self());
+#else
+	pthread_attr_t 	attr;
+	void 			*addr;
+	size_t 			size;
+	pthread_getattr_np(pthread_self(), &attr);
+	pthread_attr_getstack(&attr, &addr, &size);
+	pthread_attr_destroy(&attr);
+	return (char *) addr + size;
+#endif
+}
+
+//	Roots
+
+void foidl_gc_register_roots(PFRTAny **tab, ft cnt) {
+	lock_gc();
+	for(ft i = 0; i < cnt; i++) {
+		if(root_count == root_size) {
+			ft 	nsize = root_size ? root_size * 2 : 256;
+			PFRTAny **roots = realloc(gc_roots, nsize * sizeof(PFRTAny *));
+			if(roots == NULL)
+				unknown_handler();
+			gc_roots = roots;
+			root_size = nsize;
+		}
+		gc_roots[root_count++] = tab[i];
+	}
+	unlock_gc();
+}
+
+void foidl_gc_register_root(PFRTAny *root) {
+	foidl_gc_register_roots(&root, 1);
+}
+
+//	Whether a root holds the value directly
+
+ft foidl_gc_rooted(PFRTAny s) {
+	ft 	found = 0;
+	lock_gc();
+	for(ft i = 0; i < root_count && found == 0; i++)
+		found = *gc_roots[i] == s;
+	unlock_gc();
+	return found;
+}
+
+//	Threads
+
+void foidl_gc_register_thread() {
+	if(gc_self != NULL)
+		return;
+	GCThread *t = calloc(1,sizeof(GCThread));
+	t->base = stack_base();
+	lock_gc();
+	while(gc_requested)
+		wait_gc(&gc_resume);
+	t->state = GC_RUNNING;
+	t->next = gc_threads;
+	gc_threads = t;
+	unlock_gc();
+	gc_self = t;
+}
+
+void foidl_gc_release_thread() {
+	GCThread *t = gc_self;
+	if(t == NULL)
+		return;
+	lock_gc();
+	GCThread **link = &gc_threads;
+	while(*link != t)
+		link = &(*link)->next;
+	*link = t->next;
+	signal_gc(&gc_stopped);
+	unlock_gc();
+	gc_self = NULL;
+	free(t);
+}
+
+//	Records where the stopped threads roots are. The jmp_buf holds
+//	the callee saved registers and lives in the caller frame so all
+//	of it is inside the scanned range
+
+static void gc_stop(GCThread *self, char *top) {
+	self->top = top;
+	self->pcount = foidl_ref_pending(&self->pending);
+	self->state = GC_STOPPED;
+	signal_gc(&gc_stopped);
+}
+
+static GC_NOINLINE void gc_park(GCThread *self) {
+	jmp_buf 	jb;
+	setjmp(jb);
+	lock_gc();
+	gc_stop(self, GC_STACK_TOP(jb));
+	while(gc_requested)
+		wait_gc(&gc_resume);
+	self->state = GC_RUNNING;
+	unlock_gc();
+}
+
+//	Runs fn as a blocking wait, a collection may proceed while the
+//	thread waits and the thread resumes after it completes
+
+GC_NOINLINE void foidl_gc_blocking(void (*fn)(void *), void *arg) {
+	GCThread 	*self = gc_self;
+	jmp_buf 	jb;
+	if(self == NULL) {
+		fn(arg);
+		return;
+	}
+	setjmp(jb);
+	lock_gc();
+	gc_stop(self, GC_STACK_TOP(jb));
+	unlock_gc();
+	fn(arg);
+	lock_gc();
+	while(gc_requested)
+		wait_gc(&gc_resume);
+	self->state = GC_RUNNING;
+	unlock_gc();
+}
+
+//	Called from the allocation slow path
+
+void foidl_gc_safepoint() {
+	GCThread 	*self = gc_self;
+	if(self == NULL || self->state != GC_RUNNING)
+		return;
+	if(gc_requested)
+		gc_park(self);
+	else if(gc_enabled && GC_ADD(&gc_allocated, GC_REFILL) > gc_trigger)
+		gc_collect();
+}
+
+//	Polled by iteration, which may run without allocating, so a
+//	waiting collection is not held up
+
+void foidl_gc_poll() {
+	GCThread 	*self = gc_self;
+	if(gc_requested && self != NULL && self->state == GC_RUNNING)
+		gc_park(self);
+}
+
+//	Mark
+
+//	Marks a block whose content holds no references
+
+static void mark_value(void *p) {
+	ft 			bytes;
+	PFRTTypeG 	g = foidl_heap_block(p, &bytes);
+	if(g == NULL || (g->fsig & gc_mark))
+		return;
+	g->fsig |= gc_mark;
+	if(g->fsig & raw_root)
+		gc_push(&root_marked, g);
+}
+
+static void mark_ptr(void *p) {
+	ft 			bytes;
+	PFRTTypeG 	g = foidl_heap_block(p, &bytes);
+	if(g == NULL || (g->fsig & gc_mark))
+		return;
+	if(g->fsig & raw_root)
+		mark_value(p);
+	else {
+		g->fsig |= gc_mark;
+		gc_push(&mark_stack, g);
+	}
+}
+
+static GC_NOSANITIZE void scan_range(char *lo, char *hi) {
+	void 	**p = (void **) (((ft) lo + sizeof(void *) - 1) & ~(sizeof(void *) - 1));
+	for(; (char *) (p + 1) <= hi; p++)
+		mark_ptr(*p);
+}
+
+static void scan_block(PFRTTypeG g, ft bytes) {
+	scan_range((char *) &g->fclass, (char *) g + bytes);
+}
+
+//	Objects owning system resources are never collected
+
+static int collectable(PFRTAny s) {
+	if(s->fclass == io_class || s->fclass == worker_class)
+		return 0;
+	if(s->fclass == scalar_class && s->ftype == regex_type)
+		return 0;
+	return 1;
+}
+
+//	Traces the children of a marked block using the class layouts,
+//	anything else (slot arrays, iterators) is scanned
+
+static void trace_block(PFRTTypeG g, ft bytes) {
+	PFRTAny s = (PFRTAny) &g->fclass;
+	if(s->fclass == scalar_class) {
+		switch(s->ftype) {
+			case 	string_type:
+			case 	keyword_type:
+				mark_value(s->value);
+				if(STR_SLICE(s))
+					mark_ptr(((PFRTStrSlice) s)->owner);
+				break;
+			case 	number_type:
+				if(s->count == number_mapm)
+					mark_value(s->value);
+				break;
+			case 	character_type:
+				break;
+			default:
+				scan_block(g, bytes);
+				break;
+		}
+	}
+	else if(s->fclass == collection_class) {
+		switch(s->ftype) {
+			case 	list2_type:
+				mark_ptr(((PFRTList) s)->root);
+				mark_ptr(((PFRTList) s)->rest);
+				mark_ptr(((PFRTList) s)->skips);
+				break;
+			case 	linknode_type:
+				mark_ptr(((PFRTLinkNode) s)->data);
+				mark_ptr(((PFRTLinkNode) s)->next);
+				break;
+			case 	vector2_type:
+				mark_ptr(((PFRTVector) s)->root);
+				mark_ptr(((PFRTVector) s)->tail);
+				break;
+			case 	set2_type:
+			case 	map2_type:
+				mark_ptr(((PFRTAssocType) s)->root);
+				break;
+			case 	sortedset_type:
+			case 	sortedmap_type:
+				mark_ptr(((PFRTSorted) s)->root);
+				break;
+			case 	bytearray_type:
+			case 	intarray_type:
+			case 	floatarray_type:
+				mark_ptr(((PFRTPrimArray) s)->data);
+				break;
+			case 	mapentry_type:
+				mark_ptr(((PFRTMapEntry) s)->key);
+				mark_ptr(((PFRTMapEntry) s)->value);
+				break;
+			case 	series_type:
+				mark_ptr(((PFRTSeries) s)->start);
+				mark_ptr(((PFRTSeries) s)->stop);
+				mark_ptr(((PFRTSeries) s)->step);
+				break;
+			default:
+				scan_block(g, bytes);
+				break;
+		}
+	}
+	else if(s->fclass == hamptnode_class || s->fclass == rrbnode_class) {
+		for(ft i = 0; i < WCNT; i++)
+			mark_ptr(((PFRTHamtNode) s)->slots[i]);
+	}
+	else if(s->fclass == bitmapnode_class) {
+		mark_ptr(((PFRTBitmapNode) s)->slots);
+	}
+	else if(s->fclass == primdata_class)
+		;	//	Elements are unboxed
+	else if(s->fclass == sortnode_class) {
+		for(ft i = 0; i < ((PFRTSortNode) s)->count; i++) {
+			mark_ptr(((PFRTSortNode) s)->keys[i]);
+			mark_ptr(((PFRTSortNode) s)->slots[i]);
+		}
+	}
+	else
+		scan_block(g, bytes);
+}
+
+//	Global blocks are scalars that live as long as the runtime. Raw
+//	blocks are not roots, they are scanned once something reaches
+//	them
+
+static void mark_roots_block(PFRTTypeG g, ft bytes) {
+	if(SIGOF(g) == global_signature)
+		trace_block(g, bytes);
+	else if(SIGOF(g) == alloc_signature
+		&& collectable((PFRTAny) &g->fclass) == 0)
+		mark_ptr(&g->fclass);
+}
+
+static void mark() {
+	foidl_heap_index();
+	for(ft i = 0; i < root_count; i++)
+		mark_ptr(*gc_roots[i]);
+	for(GCThread *t = gc_threads; t; t = t->next) {
+		scan_range(t->top, t->base);
+		for(ft i = 0; i < t->pcount; i++)
+			mark_ptr((void *) t->pending[i]);
+	}
+	foidl_arena_walk(scan_range);
+	foidl_heap_walk(mark_roots_block);
+	while(mark_stack.count) {
+		PFRTTypeG 	g = mark_stack.items[--mark_stack.count];
+		ft 			bytes;
+		foidl_heap_block(g, &bytes);
+		if(SIGOF(g) == unkwn_signature)
+			scan_block(g, bytes);
+		else
+			trace_block(g, bytes);
+	}
+}
+
+//	Sweep
+
+static ft live_blocks;
+
+static void sweep_block(PFRTTypeG g, ft bytes) {
+	if(g->fsig & raw_root)
+		return;
+	if(g->fsig & gc_mark) {
+		g->fsig &= ~gc_mark;
+		++live_blocks;
+	}
+	else if(SIGOF(g) != global_signature)
+		gc_push(&dead_blocks, g);
+}
+
+//	M_APM number values are root blocks, they go with their owner
+//	unless something live still refers to them. String buffers are
+//	raw blocks and swept on their own
+
+static int owns_value(PFRTAny s) {
+	return s->fclass == scalar_class && s->ftype == number_type
+		&& s->count == number_mapm;
+}
+
+static int unreferenced_raw(void *p) {
+	ft 			bytes;
+	PFRTTypeG 	g = foidl_heap_block(p, &bytes);
+	return g != NULL && SIGOF(g) == unkwn_signature && (g->fsig & gc_mark) == 0;
+}
+
+//	Blocks are resolved before any is freed, freeing leaves the heap
+//	block index stale. A dead block that takes its number value along
+//	is tagged in the low bit
+
+static ft sweep() {
+	ft 	freed;
+	live_blocks = 0;
+	foidl_heap_walk(sweep_block);
+	freed = dead_blocks.count;
+	for(ft i = 0; i < dead_blocks.count; i++) {
+		PFRTTypeG 	g = dead_blocks.items[i];
+		PFRTAny 	s = (PFRTAny) &g->fclass;
+		if(SIGOF(g) == alloc_signature && owns_value(s)
+			&& unreferenced_raw(s->value))
+			dead_blocks.items[i] = (void *) ((ft) g | 1);
+	}
+	for(ft i = 0; i < dead_blocks.count; i++) {
+		PFRTTypeG 	g = (PFRTTypeG) ((ft) dead_blocks.items[i] & ~((ft) 1));
+		PFRTAny 	s = (PFRTAny) &g->fclass;
+		if((ft) dead_blocks.items[i] & 1)
+			release_number_value(s->value);
+		else if(STR_RETIRED(s))
+			release_retired(s);
+		foidl_xdel(s);
+	}
+	dead_blocks.count = 0;
+	for(ft i = 0; i < root_marked.count; i++)
+		((PFRTTypeG) root_marked.items[i])->fsig &= ~gc_mark;
+	root_marked.count = 0;
+	return freed;
+}
+
+//	Stops the world, collects and resumes. If another thread is
+//	already collecting the caller parks for it instead. Returns
+//	the number of blocks freed
+
+static GC_NOINLINE ft gc_collect() {
+	GCThread 	*self = gc_self;
+	jmp_buf 	jb;
+	if(self == NULL)
+		return 0;
+	setjmp(jb);
+	lock_gc();
+	if(gc_requested) {
+		unlock_gc();
+		gc_park(self);
+		return 0;
+	}
+	gc_requested = 1;
+	gc_stop(self, GC_STACK_TOP(jb));
+	for(;;) {
+		ft 	running = 0;
+		for(GCThread *t = gc_threads; t; t = t->next)
+			running += t->state == GC_RUNNING;
+		if(running == 0)
+			break;
+		wait_gc(&gc_stopped);
+	}
+	unlock_gc();
+
+	mark();
+	ft 	freed = sweep();
+	gc_allocated = 0;
+	gc_trigger = live_blocks > GC_MIN_TRIGGER ? live_blocks : GC_MIN_TRIGGER;
+
+	lock_gc();
+	gc_requested = 0;
+	self->state = GC_RUNNING;
+	signal_gc(&gc_resume);
+	unlock_gc();
+	return freed;
+}
+
+PFRTAny foidl_gc_collect_bang() {
+	return foidl_reg_intnum(gc_collect());
+}
+
+//	Called once the program entry is reached, registers the main
+//	thread and enables collections
+
+void foidl_gc_init() {
+	if(gc_enabled)
+		return;
+	foidl_gc_register_thread();
+	gc_enabled = 1;
+}
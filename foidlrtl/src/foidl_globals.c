@@ -101,6 +101,9 @@ void foidl_rtl_init_globals() {
 
 	//	Setup some character sets
 
+	foidl_gc_register_root(&whitespace);
+	foidl_gc_register_root(&boundarySet);
+	foidl_gc_register_root(&boundarySetLite);
 	whitespace = foidl_set_inst_bang();
 	boundarySet = foidl_set_inst_bang();
 	boundarySetLite = foidl_set_inst_bang();
@@ -10,6 +10,8 @@
 
 #include <foidlrt.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 
 uint32_t murmur3_32(const uint8_t* key, size_t len, uint32_t seed) {
   uint32_t h = seed;
@@ -49,6 +51,118 @@ uint32_t murmur3_32(const uint8_t* key, size_t len, uint32_t seed) {
   return h;
 }
 
+//	Wide block 64 bit hash in the wyhash family. Keys are consumed
+//	8 bytes at a time in 48 byte blocks over three independent lanes,
+//	each folded with a 64x64->128 multiply
+
+static const uint64_t wide_secret[4] = {
+	0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+	0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+static inline void wide_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t) *a * *b;
+	*a = (uint64_t) r;
+	*b = (uint64_t) (r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32;
+	uint64_t la = (uint32_t) *a, lb = (uint32_t) *b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wide_mix(uint64_t a, uint64_t b) {
+	wide_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t wide_r8(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static inline uint64_t wide_r4(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+uint64_t foidl_hash64(const uint8_t* key, size_t len, uint64_t seed) {
+	const uint8_t 	*p = key;
+	const uint64_t 	*s = wide_secret;
+	uint64_t 		a, b;
+	seed ^= wide_mix(seed ^ s[0], s[1]);
+	if(len <= 16) {
+		if(len >= 4) {
+			size_t 	off = (len >> 3) << 2;
+			a = (wide_r4(p) << 32) | wide_r4(p + off);
+			b = (wide_r4(p + len - 4) << 32) | wide_r4(p + len - 4 - off);
+		}
+		else if(len > 0) {
+			a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		}
+		else
+			a = b = 0;
+	}
+	else {
+		size_t 	i = len;
+		if(i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = wide_mix(wide_r8(p) ^ s[1], wide_r8(p + 8) ^ seed);
+				see1 = wide_mix(wide_r8(p + 16) ^ s[2], wide_r8(p + 24) ^ see1);
+				see2 = wide_mix(wide_r8(p + 32) ^ s[3], wide_r8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while(i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while(i > 16) {
+			seed = wide_mix(wide_r8(p) ^ s[1], wide_r8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wide_r8(p + i - 16);
+		b = wide_r8(p + i - 8);
+	}
+	a ^= s[1];
+	b ^= seed;
+	wide_mum(&a, &b);
+	return wide_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+//	Hash policy for string and keyword keys in the CHAMP map and set.
+//	Set once at start up, FOIDL_HASH=murmur3 restores the 32 bit
+//	murmur3 hash
+
+typedef uint32_t (*hash_policy)(const uint8_t*, size_t);
+
+static uint32_t wide_policy(const uint8_t* key, size_t len) {
+	uint64_t h = foidl_hash64(key, len, 0);
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+static uint32_t murmur3_policy(const uint8_t* key, size_t len) {
+	return murmur3_32(key, len, 0);
+}
+
+static hash_policy string_policy = wide_policy;
+
+void foidl_rtl_init_hash() {
+	const char *p = getenv("FOIDL_HASH");
+	if(p != NULL && strcmp(p, "murmur3") == 0)
+		string_policy = murmur3_policy;
+	else
+		string_policy = wide_policy;
+}
+
 uint32_t hash(PFRTAny);
 
 static uint32_t nodeHashCode(PFRTBitmapNode node) {
@@ -64,34 +178,67 @@ static uint32_t nodeHashCode(PFRTBitmapNode node) {
 	return result;
 }
 
+//	Identity hash for objects only equal to themselves
+
+static uint32_t identity_hash(PFRTAny p) {
+	return murmur3_32((uint8_t *) &p, sizeof(PFRTAny), 0);
+}
+
+//	String and keyword hashes are computed on first use and kept
+//	in the object, 0 meaning not yet known. Globals may be read only
+//	(constString) and are hashed each time, interned keywords are
+//	hashed when interned
+
+static uint32_t string_hash(PFRTAny p) {
+	if(p->hash == 0) {
+		uint32_t h = string_policy((uint8_t *) p->value, p->count);
+		h = h ? h : 1;
+		if(SIGOF(ANYTOG(p)) == global_signature)
+			return h;
+		p->hash = h;
+	}
+	return p->hash;
+}
+
+//	Maps, sets, lists and vectors keep a structural hash up to date
+//	as they are built, so equal collections hash alike. Sliced and
+//	concatenated vectors compute theirs on first use
+
+static int structural_type(ft ftype) {
+	return ftype == map2_type || ftype == set2_type
+		|| ftype == list2_type || ftype == vector2_type
+		|| ftype == sortedmap_type || ftype == sortedset_type;
+}
+
 uint32_t hash(PFRTAny p) {
 	if(p->fclass == scalar_class) {
 		if(p->ftype == string_type || p->ftype == keyword_type)
-			return murmur3_32((uint8_t *)p->value,p->count,0);
-		else if (p->ftype == number_type) {
-      ft val = number_toft(p);
-			return murmur3_32((uint8_t*)&p,8,0);
-    }
-    else if (p->ftype == character_type)
-      return murmur3_32((uint8_t*)&p->value,8,0);
+			return string_hash(p);
+		else if (p->ftype == number_type)
+			return number_hash(p);
+		else if (p->ftype == character_type)
+			return murmur3_32((uint8_t*)&p->value,8,0);
 	}
 	else if(p->fclass == bitmapnode_class) {
 		return nodeHashCode((PFRTBitmapNode) p);
 	}
-  else if(p->fclass == collection_class) {
-    return murmur3_32((uint8_t*)p,8,0);//p->hash;
-  }
-  else if(p->fclass == function_class) {
-    return murmur3_32((uint8_t*)p,8,0);
-  }
-  else if(p->fclass == io_class) {
-    return murmur3_32((uint8_t*)p,8,0);
-  }
-  else if(p->fclass == worker_class) {
-    return murmur3_32((uint8_t*)p,8,0);
-  }
+	else if(p->fclass == collection_class) {
+		if(p->ftype == vector2_type && ((PFRTVector) p)->unhashed)
+			return vector_hash(p);
+		if(p->ftype == bytearray_type || p->ftype == intarray_type
+			|| p->ftype == floatarray_type)
+			return prim_hash(p);
+		if(structural_type(p->ftype))
+			return p->hash;
+		return identity_hash(p);
+	}
+	else if(p->fclass == function_class || p->fclass == io_class
+		|| p->fclass == worker_class || p->fclass == response_class
+		|| p->fclass == iterator_class) {
+		return identity_hash(p);
+	}
 	else {
-		printf("HASH: Can't handle class of 0x%08llX\n",p->fclass);
+		printf("HASH: Can't handle class of 0x%08X\n",p->fclass);
 		//exit(-1);
 		unknown_handler();
 	}
@@ -424,7 +424,7 @@ PFRTAny 	foidl_tofuncref(void *fref, PFRTAny acnt) {
 	else if (acnt->ftype == number_type)
 		cnt = number_toft(acnt);
 	else {
-		printf("%llx\n", acnt->ftype);
+		printf("%x\n", acnt->ftype);
 		unknown_handler();
 	}
 	return (PFRTAny) allocFuncRef2(fref,(ft) cnt,iptrs[cnt]);
@@ -67,11 +67,12 @@ static PFRTAny trieiterator_nextKey(PFRTTrie_Iterator itr) {
 PFRTAny vectoriterator_next(PFRTVector_Iterator itr) {
 	PFRTAny res = end;
 	if(itr->index < itr->vector->count) {
-		if(itr->index - itr->base == WCNT) {
-			itr->node = (PFRTHamtNode) itr->get((PFRTAny) itr->vector, itr->index);
-			itr->base += WCNT;
+		if(itr->index == itr->limit) {
+			ft 	len;
+			itr->node = vector_leaf(itr->vector, itr->index, &itr->base, &len);
+			itr->limit = itr->base + len;
 		}
-		res = itr->node->slots[itr->index & MASK];
+		res = itr->node->slots[itr->index - itr->base];
 		itr->index += 1;
 	}
 	return res;
@@ -187,6 +188,7 @@ PFRTIterator iteratorFor(PFRTAny t) {
 	switch(t->fclass) {
 		case 	scalar_class:
 			switch(t->ftype) {
+				case 	keyword_type:
 				case 	string_type:
 					i = allocStringIterator(
 						t,
@@ -215,6 +217,19 @@ PFRTIterator iteratorFor(PFRTAny t) {
 							(PFRTAssocType)t,
 							(itrNext) trieiterator_nextKey);
 					break;
+				case 	sortedmap_type:
+				case 	sortedset_type:
+					i = allocSortedIterator(
+							(PFRTSorted) t,
+							(itrNext) sortediterator_next);
+					break;
+				case 	bytearray_type:
+				case 	intarray_type:
+				case 	floatarray_type:
+					i = allocPrimIterator(
+							(PFRTPrimArray) t,
+							(itrNext) primiterator_next);
+					break;
 				case 	series_type:
 					i = seriesiterator_initiate(
 							allocSeriesIterator(
@@ -236,6 +251,94 @@ PFRTIterator iteratorFor(PFRTAny t) {
 	return i;
 }
 
+//	An iterator holds a count on what it walks until it is exhausted,
+//	or released before that, then it only returns end
+
+static PFRTAny iterator_ended(PFRTIterator i) {
+	return end;
+}
+
+static void iteratorDrop(PFRTIterator i) {
+	if(i->next == (itrNext) iterator_ended)
+		return;
+	switch(i->ftype) {
+		case 	string_iterator_type:
+			foidl_unref(((PFRTString_Iterator) i)->string);
+			break;
+		case 	vector_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTVector_Iterator) i)->vector);
+			break;
+		case 	list_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTList_Iterator) i)->list);
+			break;
+		case 	map_iterator_type:
+			foidl_unref_node(((PFRTTrie_Iterator) i)->root, TUPLELEN);
+			break;
+		case 	set_iterator_type:
+			foidl_unref_node(((PFRTTrie_Iterator) i)->root, TUPLELENSFT);
+			break;
+		case 	sorted_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTSorted_Iterator) i)->sorted);
+			break;
+		case 	prim_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTPrim_Iterator) i)->array);
+			break;
+		case 	series_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTSeries_Iterator) i)->series);
+			break;
+		case 	channel_iterator_type:
+			foidl_unref((PFRTAny) ((PFRTChannel_Iterator) i)->channel);
+			break;
+	}
+	i->next = (itrNext) iterator_ended;
+}
+
+void iteratorRelease(PFRTIterator i) {
+	iteratorDrop(i);
+	foidl_xdel(i);
+}
+
 PFRTAny iteratorNext(PFRTIterator i) {
-	return i->next(i);
+	foidl_gc_poll();
+	PFRTAny res = i->next(i);
+	if(res == end)
+		iteratorDrop(i);
+	return res;
+}
+
+//	Chunked iteration. A vector hands out the rest of the current leaf,
+//	other iterators one element at a time through one. Returns the
+//	count of elements, 0 at the end. A sorted set hands out leaves
+//	like a vector
+
+ft iteratorChunk(PFRTIterator i, PFRTAny *one, PFRTAny **elems) {
+	foidl_gc_poll();
+	if(i->next == (itrNext) vectoriterator_next) {
+		PFRTVector_Iterator vi = (PFRTVector_Iterator) i;
+		ft 	n;
+		if(vi->index >= vi->vector->count) {
+			iteratorDrop(i);
+			return 0;
+		}
+		if(vi->index == vi->limit) {
+			vi->node = vector_leaf(vi->vector, vi->index, &vi->base, &n);
+			vi->limit = vi->base + n;
+		}
+		*elems = &vi->node->slots[vi->index - vi->base];
+		n = vi->limit - vi->index;
+		vi->index = vi->limit;
+		return n;
+	}
+	if(i->next == (itrNext) sortediterator_next
+		&& ((PFRTSorted_Iterator) i)->sorted->ftype == sortedset_type) {
+		ft 	n = sortediterator_chunk((PFRTSorted_Iterator) i, elems);
+		if(n == 0)
+			iteratorDrop(i);
+		return n;
+	}
+	*one = i->next(i);
+	*elems = one;
+	if(*one == end)
+		iteratorDrop(i);
+	return *one != end;
 }
@@ -24,6 +24,14 @@
 
 #include <foidlrt.h>
 
+#ifdef _MSC_VER
+#define SKIPS_CAS(p,o,n) 	(InterlockedCompareExchangePointer((PVOID *)(p),(n),(o)) == (o))
+#else
+#define SKIPS_CAS(p,o,n) 	__sync_bool_compare_and_swap((p),(o),(n))
+#endif
+
+#define LIST_SKIP 	32 		//	Nodes between positional index entries
+
 const struct FRTLinkNodeG _empty_link = {
 	global_signature,
 	collection_class,
@@ -41,9 +49,64 @@ const struct FRTListG _empty_list = {
 	0,
 	0,
 	empty_link,
-	empty_link
+	empty_link,
+	empty_link,
+	NULL
 };
 
+//	Positional index. Readers of a shared list may race to build it,
+//	the first published wins. Only owners of a list (the bang forms)
+//	drop it. It is heap memory even inside an arena scope, as the list
+//	may outlive the scope. It is freed with the list, or swept with it
+//	by the collector
+
+static void dropSkips(PFRTList list) {
+	if(list->skips != NULL) {
+		foidl_xdel(list->skips);
+		list->skips = NULL;
+	}
+}
+
+static PFRTListSkips buildSkips(PFRTList list) {
+	ft 				cnt = (list->count + LIST_SKIP - 1) / LIST_SKIP;
+	PFRTListSkips 	res = (PFRTListSkips) foidl_xall_shared(sizeof(struct FRTListSkips)
+		+ (cnt - 1) * sizeof(PFRTLinkNode));
+	PFRTLinkNode 	p = list->root;
+	res->count = cnt;
+	for(ft i = 0; i < list->count; i++, p = p->next)
+		if(i % LIST_SKIP == 0)
+			res->nodes[i / LIST_SKIP] = p;
+	if(!SKIPS_CAS(&list->skips, NULL, res)) {
+		foidl_xdel(res);
+		res = list->skips;
+	}
+	return res;
+}
+
+//	Node at index, empty_link when out of range
+
+static PFRTLinkNode getListLinkNode(PFRTList list, ft indx) {
+	PFRTLinkNode 	p = list->root;
+	ft 				i = 0;
+	if(indx >= list->count)
+		return empty_link;
+	if(indx == list->count - 1)
+		return list->last;
+	if(indx >= LIST_SKIP) {
+		PFRTListSkips 	sk = list->skips;
+		if(sk == NULL)
+			sk = buildSkips(list);
+		i = indx / LIST_SKIP;
+		if(i >= sk->count)
+			i = sk->count - 1;
+		p = sk->nodes[i];
+		i *= LIST_SKIP;
+	}
+	for(; i < indx; i++)
+		p = p->next;
+	return p;
+}
+
 PFRTList const empty_list = (PFRTList) &_empty_list.fclass;
 
 PFRTAny 	list_pop_bang(PFRTAny l) {
@@ -53,8 +116,9 @@ PFRTAny 	list_pop_bang(PFRTAny l) {
 		uint32_t 	keyhash = hash(oldNode->data);
 		list->hash -= keyhash;
 		--list->count;
+		dropSkips(list);
 		if( list->count == 0 ) {
-			list->root = list->rest = empty_link;
+			list->root = list->rest = list->last = empty_link;
 		}
 		else if( list->count == 1 )
 			list->root = list->rest;
@@ -63,7 +127,8 @@ PFRTAny 	list_pop_bang(PFRTAny l) {
 			list->rest = list->root->next;
 		}
 
-		if(oldNode != empty_link) foidl_xdel(oldNode);
+		foidl_retain((PFRTAny) list->root);
+		foidl_unref((PFRTAny) oldNode);
 	}
 	return l;
 }
@@ -79,8 +144,10 @@ PFRTAny 	list_pop(PFRTAny l) {
 		newList->hash = oldList->hash;
 		newList->hash -= hash(oldList->root->data);
 		--newList->count;
-		if(newList->count)
+		if(newList->count) {
 			newList->rest = newList->root->next;
+			newList->last = oldList->last;
+		}
 	}
 	return (PFRTAny) newList;
 }
@@ -107,9 +174,14 @@ static PFRTAny 	list_prepend_bang(PFRTAny l, PFRTAny v) {
 
 	// If count == 0, make newNode root
 	if(list->count > 0) {
-		newNode->next = list->rest = list->root;
+		newNode->next = list->rest =
+			(PFRTLinkNode) foidl_retain((PFRTAny) list->root);
 	}
-	list->root = newNode;
+	else
+		list->last = newNode;
+	dropSkips(list);
+	foidl_unref((PFRTAny) list->root);
+	list->root = (PFRTLinkNode) foidl_retain((PFRTAny) newNode);
 	list->hash += keyhash;
 	++list->count;
 	return (PFRTAny) list;
@@ -126,7 +198,9 @@ PFRTAny 	list_extend(PFRTAny l, PFRTAny v) {
 	PFRTLinkNode 	newNode = allocLinkNodeWith(v,empty_link);
 	PFRTList 		newList = allocList(oldList->count,newNode);
 
-	newList->root->next = newList->rest = oldList->root;
+	newList->root->next = newList->rest =
+		(PFRTLinkNode) foidl_retain((PFRTAny) oldList->root);
+	newList->last = oldList->count ? oldList->last : newNode;
 	newList->hash = oldList->hash + keyhash;
 	++newList->count;
 
@@ -154,18 +228,18 @@ PFRTAny 	foidl_list_extend_bang(PFRTAny l, PFRTAny v) {
 
 	// If count == 0, make newNode root
 	if(list->count == 0) {
-		list->root = newNode;
-	}
-	else if(list->count == 1) {
-		list->root->next = list->rest = newNode;
+		list->root = (PFRTLinkNode) foidl_retain((PFRTAny) newNode);
 	}
 	//	Otherwise, the new node is 'appended' to end
 	else {
-		PFRTLinkNode lnode = list->rest;
-		while(lnode->next != empty_link)
-			lnode = lnode->next;
-		lnode->next = newNode;
+		list->last->next = (PFRTLinkNode) foidl_retain((PFRTAny) newNode);
+		list->rest = list->root->next;
 	}
+	list->last = newNode;
+
+	//	Appends leave the index valid, it is rebuilt once mostly stale
+	if(list->skips != NULL && list->count > 2 * LIST_SKIP * list->skips->count)
+		dropSkips(list);
 
 	list->hash += keyhash;
 	++list->count;
@@ -191,50 +265,39 @@ PFRTAny 	list_update(PFRTAny l, PFRTAny i, PFRTAny v) {
 		//	0 (head) location
 
 		if(index == 0) {
-			newList->root = newNode;
-		 	newList->root->next = newList->rest = oldList->rest;
+			newList->root = (PFRTLinkNode) foidl_retain((PFRTAny) newNode);
+		 	newList->root->next = newList->rest =
+		 		(PFRTLinkNode) foidl_retain((PFRTAny) oldList->rest);
 		 	newList->hash = (oldList->hash - hash(oldList->root->data))+vhash;
 		 }
 		 else {
 		 	PFRTLinkNode rnode =
 		 		allocLinkNodeWith(oldList->root->data,empty_link);
 		 	PFRTLinkNode node = oldList->root->next;
-		 	newList->root = rnode;
+		 	newList->root = (PFRTLinkNode) foidl_retain((PFRTAny) rnode);
 		 	for(uint32_t i=1; i<index;i++) {
-		 		rnode->next = allocLinkNodeWith(node->data,empty_link);
+		 		rnode->next = (PFRTLinkNode) foidl_retain(
+		 			(PFRTAny) allocLinkNodeWith(node->data,empty_link));
 		 		rnode = rnode->next;
 		 		node = node->next;
 		 	}
 		 	//	Node should be one after replaced
-		 	rnode->next = newNode;
-		 	newNode->next = node->next;
+		 	rnode->next = (PFRTLinkNode) foidl_retain((PFRTAny) newNode);
+		 	newNode->next = (PFRTLinkNode) foidl_retain((PFRTAny) node->next);
 		 	newList->rest = newList->root->next;
 		 	newList->hash = (oldList->hash - hash(node->data))+vhash;
 		 }
+		 newList->last = index == l->count - 1 ? newNode : oldList->last;
 	}
 	else
 		unknown_handler();
 	return (PFRTAny) newList;
 }
 
-static PFRTLinkNode getListLinkNode(PFRTList list, ft indx) {
-	PFRTLinkNode p  = empty_link;
-	if(indx == 0)
-		p = list->root;
-	else {
-		p = list->root->next;
-		ft i=1;
-		while(i<indx) {
-			p = p->next;
-			i++;
-		}
-	}
-	return p;
-}
-
 PFRTAny list_get(PFRTAny l, PFRTAny index) {
 	if(index->ftype == number_type) {
-		return getListLinkNode((PFRTList) l, number_toft(index))->data;
+		PFRTLinkNode p = getListLinkNode((PFRTList) l, number_toft(index));
+		return p == empty_link ? nil : p->data;
 	}
 	else {
 		unknown_handler();
@@ -257,8 +320,8 @@ PFRTAny list_index_of(PFRTAny list, PFRTAny el) {
 			}
 			++count;
 		}
-		foidl_xdel(li);
 	}
+	iteratorRelease(li);
 	return result;
 }
 
@@ -267,19 +330,8 @@ PFRTAny list_get_default(PFRTAny l, PFRTAny index, PFRTAny def) {
 	PFRTList list = (PFRTList) l;
 	if(index->ftype == number_type) {
 		ft val = number_toft(index);
-		if(list->count > val) {
-			if(val == 0)
-				result = list->root->data;
-			else {
-				PFRTLinkNode p = list->root->next;
-				ft i=1;
-				while(i<val) {
-					p = p->next;
-					i++;
-				}
-				result = p->data;
-			}
-		}
+		if(list->count > val)
+			result = getListLinkNode(list, val)->data;
 		else {
 			if(foidl_function_qmark(def) == true)
 				result = dispatch2(def,l,index);
@@ -300,7 +352,13 @@ PFRTAny 	list_update_bang(PFRTAny l, PFRTAny i, PFRTAny v) {
 	if(i->ftype != number_type)
 		unknown_handler();
 
-	getListLinkNode(list, number_toft(i))->data = v;
+	PFRTLinkNode node = getListLinkNode(list, number_toft(i));
+	if(node == empty_link)
+		unknown_handler();
+	PFRTAny 	 old = node->data;
+	list->hash = (list->hash - hash(old)) + hash(v);
+	node->data = foidl_retain(v);
+	foidl_unref(old);
 	return l;
 }
 
@@ -322,29 +380,23 @@ PFRTAny	list_second(PFRTAny l) {
 
 PFRTAny 	list_last(PFRTAny l) {
 	PFRTList list = (PFRTList) l;
-	ft 		 lcnt = list->count;
-	if(lcnt == 0)
+	if(list->count == 0)
 		return nil;
-	--lcnt;
-	return getListLinkNode(list, lcnt)->data;
+	return list->last->data;
 }
 
 // Takes all but the last element in the
-// list
+// list, copying them in one pass
 
 PFRTAny list_droplast(PFRTAny src) {
 	if( src == (PFRTAny) empty_list)
 		return src;
 	else {
-		PFRTList l1 = (PFRTList) foidl_list_inst_bang();
-		PFRTList list = (PFRTList) src;
-		ft 		 lcnt = list->count - 1;
-		ft 		 count = 0;
-		while(count < lcnt) {
-			foidl_list_extend_bang((PFRTAny) l1,
-				getListLinkNode(list, count)->data);
-			++count;
-		}
+		PFRTList 		l1 = (PFRTList) foidl_list_inst_bang();
+		PFRTList 		list = (PFRTList) src;
+		PFRTLinkNode 	p = list->root;
+		for(ft count = 1; count < list->count; ++count, p = p->next)
+			foidl_list_extend_bang((PFRTAny) l1, p->data);
 		return (PFRTAny) l1;
 	}
 }
@@ -354,8 +406,9 @@ PFRTAny list_rest(PFRTAny src) {
 	if(src->count > 1) {
 		PFRTList l1 = (PFRTList) foidl_list_inst_bang();
 		result = (PFRTAny) l1;
-		l1->root = ((PFRTList) src)->rest;
+		l1->root = (PFRTLinkNode) foidl_retain((PFRTAny) ((PFRTList) src)->rest);
 		l1->rest = l1->root->next;
+		l1->last = ((PFRTList) src)->last;
 
 		uint32_t s1hsh = hash(list_first(src));
 		l1->hash = src->hash - s1hsh;
@@ -376,8 +429,8 @@ PFRTAny write_list(PFRTAny channel, PFRTAny list, channel_writer writer) {
 			writer(channel,entry);
 			if(mcount > count++) writer(channel,comma);
 		}
-		foidl_xdel(li);
 	}
+	iteratorRelease(li);
 
 	writer(channel,rbracket);
 	return nil;
@@ -401,6 +454,6 @@ PFRTAny empty_list_bang(PFRTAny s) {
 }
 
 PFRTAny release_list_bang(PFRTAny s) {
-	foidl_xdel(empty_list_bang(s));
+	foidl_release(empty_list_bang(s));
 	return nil;
 }
\ No newline at end of file
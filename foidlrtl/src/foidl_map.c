@@ -11,6 +11,7 @@
 
 #include <foidlrt.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 //	Global constructs
 
@@ -72,8 +73,8 @@ static PFRTAny *insertKV(PFRTAny *src,uint32_t olen,uint32_t idx, uint32_t pos,
 		arraycopy(src,dst,idx);
 		arraycopy(&src[idx],&dst[idx+TUPLELEN],olen-idx);
 	}
-	dst[idx+KEYPOS] = k;
-	dst[idx+VALPOS] = v;
+	dst[idx+KEYPOS] = foidl_retain(k);
+	dst[idx+VALPOS] = foidl_retain(v);
 	return dst;
 }
 
@@ -88,7 +89,7 @@ static PFRTAny *entryToNode(PFRTAny *src,uint32_t olen,uint32_t idx, uint32_t id
 	arraycopy(src,dst,idx);
 	//debugArray("New array 1",dst,newlen);
 	arraycopy(&src[idx + TUPLELEN],&dst[idx],idxNew - idx);
-	dst[idxNew] = node;
+	dst[idxNew] = foidl_retain(node);
 	//debugArray("New array 2",dst,newlen);
 	arraycopy(&src[idxNew+TUPLELEN],&dst[idxNew+TUPLELENSFT],olen - idxNew - 2);
 
@@ -102,8 +103,8 @@ static PFRTAny  *nodeToEntry(PFRTAny *src,uint32_t oldlen,uint32_t idxOld,uint32
 
  	PFRTAny  *dst = allocRawAnyArray(oldlen - TUPLELENSFT + TUPLELEN);
  	arraycopy(src,dst,idxNew);
- 	dst[idxNew+KEYPOS] = k;
- 	dst[idxNew+VALPOS] = v;
+ 	dst[idxNew+KEYPOS] = foidl_retain(k);
+ 	dst[idxNew+VALPOS] = foidl_retain(v);
     arraycopy(&src[idxNew],&dst[idxNew+2],idxOld - idxNew);
 	arraycopy(&src[idxOld+1],&dst[idxOld+2],oldlen - idxOld - 1);
 	return dst;
@@ -121,7 +122,7 @@ static PFRTBitmapNode copyAndSetValue (PFRTBitmapNode src,uint32_t pos, PFRTAny
 	else {
 		ft idx = TUPLELEN * dataIndex(src->datamap,pos) + 1;
 		dst = allocNodeClone(src,nodelength(src));
-		dst->slots[idx+0] = value;
+		arrayset(dst->slots,idx,value,TUPLELEN);
 	}
 	return dst;
 }
@@ -137,7 +138,7 @@ static PFRTBitmapNode copyAndSetValue_m (PFRTBitmapNode src,uint32_t pos, PFRTAn
 	}
 	else {
 		ft idx = TUPLELEN * dataIndex(src->datamap,pos) + 1;
-		dst->slots[idx] = value;
+		arrayset(dst->slots,idx,value,TUPLELEN);
 	}
 	return dst;
 }
@@ -170,7 +171,7 @@ static PFRTBitmapNode copyAndRemoveValue_m(PFRTBitmapNode node, uint32_t bitpos,
 	arraycopy(&node->slots[idx+2],&dst[idx],(oldlen - idx) - 2);
 	node->datamap = node->datamap ^ bitpos;
 	node->slots = dst;
-	foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELEN);
 	return node;
 }
 
@@ -189,7 +190,7 @@ static PFRTBitmapNode copyAndSetNode (PFRTBitmapNode src,
 		ft slen = nodelength(src);
 		uint32_t idx = slen - 1 - nodeIndex(src->nodemap,pos);
 		dst = allocNodeClone(src,slen);
-		dst->slots[idx+0] = (PFRTAny) node;
+		arrayset(dst->slots,idx,(PFRTAny) node,TUPLELEN);
 	}
 	return dst;
 }
@@ -206,7 +207,7 @@ static PFRTBitmapNode copyAndSetNode_m (PFRTBitmapNode src,
 	else {
 		ft slen = nodelength(src);
 		uint32_t idx = slen - 1 - nodeIndex(src->nodemap,pos);
-		src->slots[idx] = (PFRTAny) node;
+		arrayset(src->slots,idx,(PFRTAny) node,TUPLELEN);
 	}
 	return src;
 }
@@ -231,8 +232,9 @@ static PFRTBitmapNode copyAndInsertValue_m (PFRTBitmapNode src,uint32_t pos,
 	PFRTAny key, PFRTAny value) {
 	//printf("	Insert/Adjust value %s at index %u of node 0x%08llX\n",(char *)key->value,idx,(ft) src);
 	PFRTAny *old = src->slots;
+	uint32_t oldlen = nodelength(src);
 	src->slots = insertKV(old,
-		nodelength(src),
+		oldlen,
 		TUPLELEN * dataIndex(src->datamap,pos),
 		pos,
 		key,
@@ -240,7 +242,7 @@ static PFRTBitmapNode copyAndInsertValue_m (PFRTBitmapNode src,uint32_t pos,
 
 	src->datamap = src->datamap | pos;
 
-	if(old != emtndarray) foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELEN);
 	return src;
 }
 
@@ -269,22 +271,22 @@ static PFRTBitmapNode mergeTwoKeyValPairs(PFRTAny cKey, PFRTAny cValue,
 		//printf("	Simple shot\n");
 		node = allocNodeWith(bit_pos(mask0) | bit_pos(mask1),0,4);
 		if(mask0 < mask1) {
-			node->slots[0] = cKey;
-			node->slots[1] = cValue;
-			node->slots[2] = key;
-			node->slots[3] = value;
+			node->slots[0] = foidl_retain(cKey);
+			node->slots[1] = foidl_retain(cValue);
+			node->slots[2] = foidl_retain(key);
+			node->slots[3] = foidl_retain(value);
 		}
 		else {
-			node->slots[0] = key;
-			node->slots[1] = value;
-			node->slots[2] = cKey;
-			node->slots[3] = cValue;
+			node->slots[0] = foidl_retain(key);
+			node->slots[1] = foidl_retain(value);
+			node->slots[2] = foidl_retain(cKey);
+			node->slots[3] = foidl_retain(cValue);
 		}
 	}
 	else {
 		//printf("	Recursive shot\n");
 		node = allocNodeWith(0,bit_pos(mask0),1);
-		node->slots[0] = (PFRTAny) mergeTwoKeyValPairs(cKey,cValue,key,value,shift+SHIFT);
+		node->slots[0] = foidl_retain((PFRTAny) mergeTwoKeyValPairs(cKey,cValue,key,value,shift+SHIFT));
 	}
 	return node;
 }
@@ -310,7 +312,7 @@ static PFRTBitmapNode migrateFromEntryToNode_m(PFRTBitmapNode o, uint32_t pos, P
 	o->nodemap = o->nodemap | pos;
 	PFRTAny *old = o->slots;
 	o->slots   = entryToNode(old,oldlen,idxOld, idxNew, (PFRTAny) node);
-	foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELEN);
 
 	return o;
 }
@@ -335,7 +337,7 @@ static PFRTBitmapNode migrateFromNodeToEntry_m(PFRTBitmapNode o, uint32_t pos,
 	o->slots = nodeToEntry(old,oldlen,idxOld,idxNew,getKey(node,0),getValue(node,0));
 	o->datamap = o->datamap | pos;
 	o->nodemap = o->nodemap ^ pos;
-	foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELEN);
 	return o;
 }
 
@@ -432,13 +434,13 @@ static PFRTBitmapNode map_remove_i(PFRTBitmapNode node,PMapNodeResult details,
 				(shift == 0) ? (node->datamap ^ bitpos) : bit_pos(mask(keyHash,0));
 				PFRTAny *dst = allocRawAnyArray(2);
 				if(idx == 0) {
-					dst[0] = getKey(node,1);
-					dst[1] = getValue(node,1);
+					dst[0] = foidl_retain(getKey(node,1));
+					dst[1] = foidl_retain(getValue(node,1));
 					return allocNodeWithAll(newDataMap,0,dst);
 				}
 				else {
-					dst[0] = getKey(node,0);
-					dst[1] = getValue(node,0);
+					dst[0] = foidl_retain(getKey(node,0));
+					dst[1] = foidl_retain(getValue(node,0));
 					return allocNodeWithAll(newDataMap,0,dst);
 				}
 			}
@@ -546,7 +548,7 @@ PFRTAny map_get_default(PFRTAny m,PFRTAny el, PFRTAny def) {
 
 
 static PFRTBitmapNode map_extend_bang_i(PFRTBitmapNode node,PMapNodeResult details,
-	ft shift, uint32_t keyHash, PFRTAny key, PFRTAny value) {
+	ft shift, uint32_t keyHash, PFRTAny key, PFRTAny value, uint32_t edit) {
 
 	uint32_t 		keyMask = mask(keyHash,shift);
 	uint32_t 		bitpos = bit_pos(keyMask);
@@ -564,7 +566,8 @@ static PFRTBitmapNode map_extend_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 			details->isModified = true;
 			details->isReplaced = true;
 			details->replacedValue = currentValue;
-			newNode = copyAndSetValue_m(node,bitpos,value);
+			newNode = copyAndSetValue_m(editableNode(node,edit,nodelength(node)),
+				bitpos,value);
 			debugMap("Inplace update after ",node,key,bitpos);
 		}
 		//	We have another kv at position
@@ -573,15 +576,19 @@ static PFRTBitmapNode map_extend_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 			//	printf("	Extend: key %s no match, push to node\n",(char *) key->value);
 			details->isModified = true;
 			newNode = mergeTwoKeyValPairs(currentKey,currentValue,key,value,shift + SHIFT);
-			return migrateFromEntryToNode_m(node,bitpos,newNode);
+			newNode->edit = edit;
+			return migrateFromEntryToNode_m(editableNode(node,edit,nodelength(node)),
+				bitpos,newNode);
 		}
 	}
 	else if((node->nodemap & bitpos) != 0) {
 		debugMap("	Node shift update before ",node,key,bitpos);
 		PFRTBitmapNode subNode = getNode(node,nodeIndex(node->nodemap,bitpos));
-		PFRTBitmapNode subNewNode = map_extend_bang_i(subNode,details,shift + SHIFT,keyHash,key,value);
-		if(details->isModified)	{
-			newNode = copyAndSetNode_m(node,bitpos,subNewNode);
+		PFRTBitmapNode subNewNode = map_extend_bang_i(subNode,details,shift + SHIFT,
+			keyHash,key,value,edit);
+		if(details->isModified && subNewNode != subNode)	{
+			newNode = copyAndSetNode_m(editableNode(node,edit,nodelength(node)),
+				bitpos,subNewNode);
 			debugMap("	Node shift update after ",node,key,bitpos);
 		}
 
@@ -590,12 +597,23 @@ static PFRTBitmapNode map_extend_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 		//printf("	Extend: No data or node positions match...\n");
 		debugMap("	All new before ",node,key,bitpos);
 		details->isModified = true;
-		newNode = copyAndInsertValue_m(node,bitpos,key,value);
+		newNode = copyAndInsertValue_m(editableNode(node,edit,nodelength(node)),
+			bitpos,key,value);
 		debugMap("	All new after ",node,key,bitpos);
 	}
 	return newNode;
 }
 
+//	Replace the root of a map being changed in place
+
+static void map_setroot(PFRTMap map, PFRTBitmapNode root) {
+	if(root != map->root) {
+		PFRTBitmapNode old = map->root;
+		map->root = (PFRTBitmapNode) foidl_retain((PFRTAny) root);
+		foidl_unref_node(old, TUPLELEN);
+	}
+}
+
 PFRTAny foidl_map_extend_bang(PFRTAny m, PFRTAny k, PFRTAny v) {
 	struct MapNodeResult 	details = {end,false,false};
 	uint32_t 				keyhash = hash(k);
@@ -603,7 +621,8 @@ PFRTAny foidl_map_extend_bang(PFRTAny m, PFRTAny k, PFRTAny v) {
 	PFRTMap  map = ((PFRTMap) m != empty_map) ? (PFRTMap) m
 					: allocMap(0,SHIFT,allocNode());
 	uint32_t 				ohash  = map->hash;
-	map_extend_bang_i(map->root,&details,0,keyhash,k,v);
+	map_setroot(map,
+		map_extend_bang_i(map->root,&details,0,keyhash,k,v,(uint32_t) map->edit));
 	PFRTMap 				newMap = map;
 
 	if(details.isModified == true) {
@@ -658,7 +677,7 @@ PFRTAny map_update(PFRTAny m, PFRTAny k, PFRTAny v) {
 }
 
 static PFRTBitmapNode map_remove_bang_i(PFRTBitmapNode node,PMapNodeResult details,
-	ft shift, uint32_t keyHash, PFRTAny key) {
+	ft shift, uint32_t keyHash, PFRTAny key, uint32_t edit) {
 
 	uint32_t 		keyMask = mask(keyHash,shift);
 	uint32_t 		bitpos = bit_pos(keyMask);
@@ -672,18 +691,19 @@ static PFRTBitmapNode map_remove_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 				(shift == 0) ? (node->datamap ^ bitpos) : bit_pos(mask(keyHash,0));
 				PFRTAny *dst = allocRawAnyArray(2);
 				if(idx == 0) {
-					dst[0] = getKey(node,1);
-					dst[1] = getValue(node,1);
+					dst[0] = foidl_retain(getKey(node,1));
+					dst[1] = foidl_retain(getValue(node,1));
 					return allocNodeWithAll(newDataMap,0,dst);
 				}
 				else {
-					dst[0] = getKey(node,0);
-					dst[1] = getValue(node,0);
+					dst[0] = foidl_retain(getKey(node,0));
+					dst[1] = foidl_retain(getValue(node,0));
 					return allocNodeWithAll(newDataMap,0,dst);
 				}
 			}
 			else {
-				return copyAndRemoveValue_m(node,bitpos,details);
+				return copyAndRemoveValue_m(editableNode(node,edit,nodelength(node)),
+					bitpos,details);
 			}
 		}
 		else {
@@ -692,7 +712,8 @@ static PFRTBitmapNode map_remove_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 	}
 	else if((node->nodemap & bitpos) != 0) {
 		PFRTBitmapNode subNode = getNode(node,nodeIndex(node->nodemap,bitpos));
-		PFRTBitmapNode subNewNode = map_remove_bang_i(subNode,details,shift + SHIFT,keyHash,key);
+		PFRTBitmapNode subNewNode = map_remove_bang_i(subNode,details,shift + SHIFT,
+			keyHash,key,edit);
 		if(details->isModified != true)	{
 			return node;
 		}
@@ -705,9 +726,11 @@ static PFRTBitmapNode map_remove_bang_i(PFRTBitmapNode node,PMapNodeResult detai
 				if(payloadArity(node) == 0 && nodeArity(node) == 1)
 					return subNewNode;
 				else
-					return migrateFromNodeToEntry_m(node,bitpos,subNewNode);
+					return migrateFromNodeToEntry_m(editableNode(node,edit,nodelength(node)),
+						bitpos,subNewNode);
 			default:
-				return copyAndSetNode_m(node,bitpos,subNewNode);
+				return copyAndSetNode_m(editableNode(node,edit,nodelength(node)),
+					bitpos,subNewNode);
 		}
 	}
 
@@ -719,7 +742,8 @@ PFRTAny map_remove_bang(PFRTAny m, PFRTAny k) {
 	struct MapNodeResult 	details = {end,false,false};
 	uint32_t 				keyhash = hash(k);
 	uint32_t 				ohash  = map->hash;
-	map_remove_bang_i(map->root,&details,0,keyhash,k);
+	map_setroot(map,
+		map_remove_bang_i(map->root,&details,0,keyhash,k,(uint32_t) map->edit));
 	PFRTMap 				newMap = map;
 
 	if(details.isModified == true) {
@@ -735,11 +759,73 @@ PFRTAny foidl_map_inst_bang() {
 	return (PFRTAny) allocMap(0,SHIFT,allocNode());
 }
 
+//	Transient over src, shares src's nodes until it changes them
+
+PFRTAny map_transient_bang(PFRTAny m) {
+	PFRTMap 	src = (PFRTMap) m;
+	PFRTMap 	res;
+	if(src->count == 0)
+		res = (PFRTMap) foidl_map_inst_bang();
+	else {
+		res = allocMap(src->count, src->shift, src->root);
+		res->hash = src->hash;
+	}
+	res->edit = foidl_edit_token();
+	return (PFRTAny) res;
+}
+
+//	Bulk construction, entries are gathered then the trie is built
+//	bottom up in one pass. For duplicate keys the last value wins
+
+static PFRTAny map_from_entries(PChampEntry es, ft cnt) {
+	PFRTMap 	res;
+	uint32_t 	h = 0;
+	res = allocMap(0, SHIFT, champ_from_entries(es, &cnt, TUPLELEN));
+	for(ft i = 0; i < cnt; i++)
+		h += es[i].hash ^ hash(es[i].value);
+	res->count = cnt;
+	res->hash = h;
+	if(es != NULL)
+		foidl_xdel(es);
+	return (PFRTAny) res;
+}
+
+//	Each element is a map entry or a two element collection
+
+PFRTAny map_from_pairs(PFRTIterator itr) {
+	PChampEntry es = NULL;
+	ft 			cnt = 0, cap = 0;
+	PFRTAny 	p;
+	while((p = iteratorNext(itr)) != end) {
+		if(p->ftype == mapentry_type)
+			es = champ_entry_add(es, &cnt, &cap,
+				((PFRTMapEntry) p)->key, ((PFRTMapEntry) p)->value);
+		else if(p->fclass == collection_class && p->count == 2)
+			es = champ_entry_add(es, &cnt, &cap,
+				foidl_first(p), foidl_second(p));
+		else
+			unknown_handler();
+	}
+	return map_from_entries(es, cnt);
+}
+
+//	Pairs keys with values until either runs out
+
+PFRTAny map_from_keys_values(PFRTIterator keys, PFRTIterator values) {
+	PChampEntry es = NULL;
+	ft 			cnt = 0, cap = 0;
+	PFRTAny 	k, v;
+	while((k = iteratorNext(keys)) != end
+		&& (v = iteratorNext(values)) != end)
+		es = champ_entry_add(es, &cnt, &cap, k, v);
+	return map_from_entries(es, cnt);
+}
+
 PFRTAny	map_first(PFRTAny map) {
 	PFRTAny	result = nil;
 	PFRTIterator mi = iteratorFor(map);
 	result = iteratorNext(mi);
-	foidl_xdel(mi);
+	iteratorRelease(mi);
 	result = (result == end) ? nil : ((PFRTMapEntry) result)->value;
 	return result;
 }
@@ -751,32 +837,51 @@ PFRTAny	map_second(PFRTAny map) {
 	if(result != end) {
 		result = iteratorNext(mi);
 	}
-	foidl_xdel(mi);
+	iteratorRelease(mi);
 	result = (result == end) ? nil : ((PFRTMapEntry) result)->value;
 	return result;
 }
 
+//	All but the first entry, a removal along one path so the rest of
+//	the trie is shared
+
 PFRTAny map_rest(PFRTAny src) {
 	PFRTAny result = (PFRTAny) empty_map;
 	if(src->count > 1) {
-		PFRTAny 		itm = nil;
-		PFRTAny 		m1 = foidl_map_inst_bang();
 		PFRTIterator	mi = iteratorFor(src);
-		result = m1;
-		iteratorNext(mi);
-		while((itm = iteratorNext(mi)) != end) {
-			PFRTMapEntry e = (PFRTMapEntry) itm;
-			foidl_map_extend_bang(m1,e->key,e->value);
-		}
-		foidl_xdel(mi);
-		uint32_t s1hsh = hash(map_first(src));
-		m1->hash = src->hash - s1hsh;
-		m1->count = src->count - 1;
+		PFRTAny 		e = iteratorNext(mi);
+		iteratorRelease(mi);
+		result = map_remove(src, ((PFRTMapEntry) e)->key);
 	}
 	return result;
 }
 
 
+//	Merge shares every subtree only one map has. For keys in both the
+//	value is m2's, or with call set what it makes of the two values
+
+PFRTAny map_merge_with(PFRTAny m1, PFRTAny m2, PFRTAny fn, champ_combine call) {
+	PFRTMap 			a = (PFRTMap) m1;
+	PFRTMap 			b = (PFRTMap) m2;
+	struct ChampJoin 	j = {fn,call,0,0};
+	if(b->count == 0)
+		return m1;
+	if(a->count == 0)
+		return m2;
+	PFRTBitmapNode 		root = champ_merge(a->root,b->root,TUPLELEN,&j);
+	if(root == a->root)
+		return m1;
+	if(root == b->root)
+		return m2;
+	PFRTMap 			res = allocMap(a->count + j.count,SHIFT,root);
+	res->hash = a->hash + j.hash;
+	return (PFRTAny) res;
+}
+
+PFRTAny map_merge(PFRTAny m1, PFRTAny m2) {
+	return map_merge_with(m1,m2,nil,NULL);
+}
+
 PFRTAny write_map(PFRTAny chn, PFRTAny map, channel_writer writer) {
 	PFRTIterator mi = iteratorFor(map);
 	PFRTAny entry;
@@ -791,17 +896,27 @@ PFRTAny write_map(PFRTAny chn, PFRTAny map, channel_writer writer) {
 			writer(chn,spchr);
 			writer(chn,e->value);
 			if(mcount > count++) writer(chn,comma);
-			foidl_xdel(e);
+			foidl_release_temp((PFRTAny) e);
 		}
-		foidl_xdel(mi);
 	}
+	iteratorRelease(mi);
 	writer(chn,rbrace);
 	return nil;
 }
 
+//	Builds in one pass from any collection's elements
+
 PFRTAny coerce_to_map(PFRTAny mtemplate, PFRTAny src) {
-	unknown_handler();
-	return src;
+	PFRTAny 		res;
+	PFRTIterator 	itr;
+	if(src->ftype == map2_type)
+		return src;
+	if(foidl_collection_qmark(src) != true)
+		unknown_handler();
+	itr = iteratorFor(src);
+	res = map_from_pairs(itr);
+	iteratorRelease(itr);
+	return res;
 }
 
 PFRTAny foidl_key(PFRTAny me) {
@@ -821,5 +936,5 @@ PFRTAny foidl_value(PFRTAny me) {
 }
 
 void release_map(PFRTAny m) {
-	unknown_handler();
+	foidl_release(m);
 }
\ No newline at end of file
@@ -10,12 +10,20 @@
 
 #include <foidlrt.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+#define EDIT_NEXT(p) 	((uint32_t) InterlockedIncrement((LONG *)(p)))
+#else
+#define EDIT_NEXT(p) 	__sync_add_and_fetch((p),1)
+#endif
 
 const struct FRTBitmapNodeG _empty_champ_node = {
 	global_signature,
 	bitmapnode_class,
 	0,
 	0,
+	0,
 	(PFRTAny *) emtndarray};
 
 PFRTBitmapNode const empty_champ_node = (PFRTBitmapNode) &_empty_champ_node.fclass;
@@ -80,9 +88,474 @@ uint32_t mask(uint32_t keyHash, ft shift) {
 
 //	Common functions 
 
+//	Copies are shared structure, each copied slot is retained
+
 void arraycopy(PFRTAny *src, PFRTAny *dst,uint32_t len) {
 	for(uint32_t i = 0; i < len; i++) {
 		PFRTAny  srcVal = src[i];
-		dst[i] = srcVal;
+		dst[i] = foidl_retain(srcVal);
+	}
+}
+
+//	Replace a slot, the new value is retained before the old one is dropped
+
+static void unref_slot(PFRTAny v, ft tuplelen) {
+	if(v->fclass == bitmapnode_class)
+		foidl_unref_node((PFRTBitmapNode) v, tuplelen);
+	else
+		foidl_unref(v);
+}
+
+void arrayset(PFRTAny *slots, uint32_t idx, PFRTAny value, ft tuplelen) {
+	PFRTAny old = slots[idx];
+	slots[idx] = foidl_retain(value);
+	unref_slot(old, tuplelen);
+}
+
+//	Drop the references of a slot array that is being discarded
+
+void arrayrelease(PFRTAny *src, uint32_t len, ft tuplelen) {
+	if(src == emtndarray)
+		return;
+	for(uint32_t i = 0; i < len; i++)
+		unref_slot(src[i], tuplelen);
+	foidl_xdel(src);
+}
+
+//	Transient ownership. Each transient gets a fresh non zero token
+//	and stamps the nodes it creates with it, only those nodes may be
+//	changed in place. Persistent collections carry 0
+
+static volatile uint32_t edit_tokens = 0;
+
+uint32_t foidl_edit_token() {
+	uint32_t t;
+	while((t = EDIT_NEXT(&edit_tokens)) == 0)
+		;
+	return t;
+}
+
+//	Returns node when the editor owns it, otherwise a copy that it
+//	does. The caller puts the copy in place of the original
+
+PFRTBitmapNode editableNode(PFRTBitmapNode node, uint32_t edit, uint32_t slen) {
+	PFRTBitmapNode res;
+	if(node->edit == edit && node != empty_champ_node)
+		return node;
+	res = (slen == 0) ? allocNode() : allocNodeClone(node, slen);
+	res->edit = edit;
+	return res;
+}
+
+//	Bulk construction. Entries sorted on their hash digits, level 0
+//	digit highest, put every subtree in one contiguous run so each
+//	node is allocated once at its final size. Equal keys collapse with
+//	the later value winning, the result matches incremental inserts
+
+PChampEntry champ_entry_add(PChampEntry es, ft *cnt, ft *cap,
+	PFRTAny key, PFRTAny value) {
+	if(*cnt == *cap) {
+		*cap = *cap ? *cap * 2 : 32;
+		es = es == NULL ? foidl_xall(*cap * sizeof(struct ChampEntry))
+			: foidl_xreall(es, *cap * sizeof(struct ChampEntry));
+	}
+	es[*cnt].hash = hash(key);
+	es[*cnt].seq = (uint32_t) *cnt;
+	es[*cnt].key = key;
+	es[*cnt].value = value;
+	++*cnt;
+	return es;
+}
+
+static uint64_t champ_order(uint32_t keyHash) {
+	uint64_t order = 0;
+	for(ft shift = 0; shift < WCNT; shift += SHIFT)
+		order = (order << SHIFT) | mask(keyHash, shift);
+	return order;
+}
+
+static int champ_compare(const void *a, const void *b) {
+	PChampEntry x = (PChampEntry) a;
+	PChampEntry y = (PChampEntry) b;
+	if(x->order != y->order)
+		return x->order < y->order ? -1 : 1;
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static ft champ_unique(PChampEntry es, ft cnt) {
+	ft out = 0;
+	for(ft i = 0; i < cnt; i++) {
+		ft j = out;
+		while(j > 0 && es[j-1].order == es[i].order
+			&& foidl_equal_qmark(es[j-1].key, es[i].key) != true)
+			--j;
+		if(j > 0 && es[j-1].order == es[i].order)
+			es[j-1].value = es[i].value;
+		else
+			es[out++] = es[i];
+	}
+	return out;
+}
+
+static PFRTBitmapNode champ_node(PChampEntry es, ft cnt, ft shift,
+	ft tuplelen) {
+	uint32_t datamap = 0, nodemap = 0, slen, d = 0, n = 0;
+	ft i, j;
+	//	Full hash collision, as with insertion
+	if(shift >= WCNT)
+		unknown_handler();
+	for(i = 0; i < cnt; i = j) {
+		uint32_t m = mask(es[i].hash, shift);
+		for(j = i + 1; j < cnt && mask(es[j].hash, shift) == m; j++)
+			;
+		if(j - i == 1)
+			datamap |= bit_pos(m);
+		else
+			nodemap |= bit_pos(m);
+	}
+	slen = bit_count(datamap) * tuplelen + bit_count(nodemap);
+	PFRTBitmapNode node = allocNodeWith(datamap, nodemap, slen);
+	for(i = 0; i < cnt; i = j) {
+		uint32_t m = mask(es[i].hash, shift);
+		for(j = i + 1; j < cnt && mask(es[j].hash, shift) == m; j++)
+			;
+		if(j - i == 1) {
+			node->slots[d * tuplelen] = foidl_retain(es[i].key);
+			if(tuplelen == TUPLELEN)
+				node->slots[d * tuplelen + 1] = foidl_retain(es[i].value);
+			++d;
+		}
+		else
+			node->slots[slen - 1 - n++] = foidl_retain((PFRTAny)
+				champ_node(&es[i], j - i, shift + SHIFT, tuplelen));
+	}
+	return node;
+}
+
+//	Sorts and collapses es in place, cnt becomes the unique count
+
+PFRTBitmapNode champ_from_entries(PChampEntry es, ft *cnt, ft tuplelen) {
+	for(ft i = 0; i < *cnt; i++)
+		es[i].order = champ_order(es[i].hash);
+	qsort(es, *cnt, sizeof(struct ChampEntry), champ_compare);
+	*cnt = champ_unique(es, *cnt);
+	return *cnt ? champ_node(es, *cnt, 0, tuplelen) : allocNode();
+}
+
+//	Structural merge and filter. Both tries are walked together a
+//	bitmap position at a time, a subtree only one side has is shared
+//	as is and a node that comes through unchanged is returned itself
+
+#define CHAMP_WIDTH 	32
+
+typedef struct ChampBuild {
+	uint32_t 		datamap;
+	uint32_t 		nodemap;
+	ft 				dlen;
+	ft 				ncnt;
+	PFRTAny 		data[CHAMP_WIDTH * 2];
+	PFRTBitmapNode 	nodes[CHAMP_WIDTH];
+} *PChampBuild;
+
+static ft champ_slen(PFRTBitmapNode n, ft tuplelen) {
+	return data_count(n) * tuplelen + node_count(n);
+}
+
+static PFRTAny *champ_data(PFRTBitmapNode n, uint32_t bitpos, ft tuplelen) {
+	return &n->slots[tuplelen * dataIndex(n->datamap, bitpos)];
+}
+
+static PFRTBitmapNode champ_child(PFRTBitmapNode n, uint32_t bitpos,
+	ft tuplelen) {
+	return (PFRTBitmapNode)
+		n->slots[champ_slen(n, tuplelen) - 1 - nodeIndex(n->nodemap, bitpos)];
+}
+
+static uint32_t champ_hash(PFRTAny *e, ft tuplelen) {
+	return tuplelen == TUPLELEN ? hash(e[0]) ^ hash(e[1]) : hash(e[0]);
+}
+
+//	Joins count the side that is usually small, the entries one trie
+//	has in a subtree the other trie does not
+
+static void champ_tally(PFRTAny *e, ft tuplelen, PChampJoin j) {
+	++j->count;
+	j->hash += champ_hash(e, tuplelen);
+}
+
+static void champ_tally_node(PFRTBitmapNode n, ft tuplelen, PChampJoin j) {
+	ft 	dcnt = data_count(n);
+	ft 	ncnt = node_count(n);
+	for(ft i = 0; i < dcnt; i++)
+		champ_tally(&n->slots[i * tuplelen], tuplelen, j);
+	for(ft i = 0; i < ncnt; i++)
+		champ_tally_node((PFRTBitmapNode) n->slots[dcnt * tuplelen + i],
+			tuplelen, j);
+}
+
+static int champ_contains(PFRTBitmapNode n, PFRTAny key, ft shift,
+	ft tuplelen) {
+	uint32_t 	keyHash = hash(key);
+	for(;;) {
+		uint32_t bitpos = bit_pos(mask(keyHash, shift));
+		if((n->datamap & bitpos) != 0)
+			return foidl_equal_qmark(*champ_data(n, bitpos, tuplelen), key) == true;
+		if((n->nodemap & bitpos) == 0)
+			return 0;
+		n = champ_child(n, bitpos, tuplelen);
+		shift += SHIFT;
+	}
+}
+
+//	A lone entry viewed as a node so it can take part in the walk.
+//	It borrows the entry's slots and lives on the caller's stack, a
+//	merge that comes back with it keeps the entry as data instead
+
+static PFRTBitmapNode champ_single(PFRTBitmapNode s, PFRTAny *e, ft shift) {
+	s->fclass = bitmapnode_class;
+	s->datamap = bit_pos(mask(hash(e[0]), shift));
+	s->nodemap = 0;
+	s->edit = 0;
+	s->slots = e;
+	return s;
+}
+
+//	Node holding two distinct entries whose hashes agree above shift
+
+static PFRTBitmapNode champ_pair(PFRTAny *e0, PFRTAny *e1, ft shift,
+	ft tuplelen) {
+	PFRTBitmapNode 	node;
+	if(shift >= WCNT)
+		unknown_handler();
+	uint32_t 	m0 = mask(hash(e0[0]), shift);
+	uint32_t 	m1 = mask(hash(e1[0]), shift);
+	if(m0 == m1) {
+		node = allocNodeWith(0, bit_pos(m0), 1);
+		node->slots[0] = foidl_retain((PFRTAny) champ_pair(e0, e1, shift + SHIFT,
+			tuplelen));
+	}
+	else {
+		PFRTAny 	*lo = m0 < m1 ? e0 : e1;
+		PFRTAny 	*hi = m0 < m1 ? e1 : e0;
+		node = allocNodeWith(bit_pos(m0) | bit_pos(m1), 0, 2 * tuplelen);
+		for(ft i = 0; i < tuplelen; i++) {
+			node->slots[i] = foidl_retain(lo[i]);
+			node->slots[tuplelen + i] = foidl_retain(hi[i]);
+		}
+	}
+	return node;
+}
+
+static void champ_add_data(PChampBuild r, uint32_t bitpos, PFRTAny *e,
+	ft tuplelen) {
+	r->datamap |= bitpos;
+	for(ft i = 0; i < tuplelen; i++)
+		r->data[r->dlen++] = e[i];
+}
+
+static void champ_add_node(PChampBuild r, uint32_t bitpos, PFRTBitmapNode n) {
+	r->nodemap |= bitpos;
+	r->nodes[r->ncnt++] = n;
+}
+
+static PFRTBitmapNode champ_build(PChampBuild r) {
+	ft 				slen = r->dlen + r->ncnt;
+	PFRTBitmapNode 	node = allocNodeWith(r->datamap, r->nodemap, slen);
+	for(ft i = 0; i < r->dlen; i++)
+		node->slots[i] = foidl_retain(r->data[i]);
+	for(ft i = 0; i < r->ncnt; i++)
+		node->slots[slen - 1 - i] = foidl_retain((PFRTAny) r->nodes[i]);
+	return node;
+}
+
+//	Entry for a key both sides have, the hash follows a changed value
+
+static void champ_both(PChampBuild r, uint32_t bitpos, PFRTAny *a, PFRTAny *b,
+	ft tuplelen, PChampJoin j, int *sameA, int *sameB) {
+	PFRTAny 	e[2] = {a[0], nil};
+	if(tuplelen == TUPLELEN) {
+		e[1] = j->call != NULL ? j->call(j->fn, a[1], b[1]) : b[1];
+		*sameA &= e[1] == a[1];
+		*sameB &= e[1] == b[1];
+	}
+	j->hash += champ_hash(e, tuplelen) - champ_hash(a, tuplelen);
+	champ_add_data(r, bitpos, e, tuplelen);
+}
+
+static PFRTBitmapNode champ_merge_i(PFRTBitmapNode a, PFRTBitmapNode b,
+	ft shift, ft tuplelen, PChampJoin j) {
+	struct ChampBuild 		r;
+	struct FRTBitmapNode 	one;
+	PFRTBitmapNode 			kid, ca, cb;
+	uint32_t 	all = a->datamap | a->nodemap | b->datamap | b->nodemap;
+	int 		sameA = 1, sameB = 1;
+
+	if(a == b && j->call == NULL)
+		return a;
+	r.datamap = r.nodemap = 0;
+	r.dlen = r.ncnt = 0;
+	while(all != 0) {
+		uint32_t bitpos = all & (~all + 1);
+		all ^= bitpos;
+		if((a->datamap & bitpos) != 0) {
+			PFRTAny *ea = champ_data(a, bitpos, tuplelen);
+			if((b->datamap & bitpos) != 0) {
+				PFRTAny *eb = champ_data(b, bitpos, tuplelen);
+				if(foidl_equal_qmark(ea[0], eb[0]) == true)
+					champ_both(&r, bitpos, ea, eb, tuplelen, j, &sameA, &sameB);
+				else {
+					champ_add_node(&r, bitpos,
+						champ_pair(ea, eb, shift + SHIFT, tuplelen));
+					champ_tally(eb, tuplelen, j);
+					sameA = sameB = 0;
+				}
+			}
+			else if((b->nodemap & bitpos) != 0) {
+				cb = champ_child(b, bitpos, tuplelen);
+				kid = champ_merge_i(champ_single(&one, ea, shift + SHIFT), cb,
+					shift + SHIFT, tuplelen, j);
+				if(kid == &one)
+					champ_add_data(&r, bitpos, ea, tuplelen);
+				else {
+					champ_add_node(&r, bitpos, kid);
+					sameA = 0;
+				}
+				sameB &= kid == cb;
+			}
+			else {
+				champ_add_data(&r, bitpos, ea, tuplelen);
+				sameB = 0;
+			}
+		}
+		else if((a->nodemap & bitpos) != 0) {
+			ca = champ_child(a, bitpos, tuplelen);
+			if((b->datamap & bitpos) != 0) {
+				kid = champ_merge_i(ca,
+					champ_single(&one, champ_data(b, bitpos, tuplelen), shift + SHIFT),
+					shift + SHIFT, tuplelen, j);
+				sameB = 0;
+				if(kid == &one) {
+					champ_add_data(&r, bitpos, one.slots, tuplelen);
+					sameA = 0;
+					continue;
+				}
+			}
+			else if((b->nodemap & bitpos) != 0) {
+				cb = champ_child(b, bitpos, tuplelen);
+				kid = champ_merge_i(ca, cb, shift + SHIFT, tuplelen, j);
+				sameB &= kid == cb;
+			}
+			else {
+				kid = ca;
+				sameB = 0;
+			}
+			champ_add_node(&r, bitpos, kid);
+			sameA &= kid == ca;
+		}
+		else if((b->datamap & bitpos) != 0) {
+			PFRTAny *eb = champ_data(b, bitpos, tuplelen);
+			champ_add_data(&r, bitpos, eb, tuplelen);
+			champ_tally(eb, tuplelen, j);
+			sameA = 0;
+		}
+		else {
+			cb = champ_child(b, bitpos, tuplelen);
+			champ_add_node(&r, bitpos, cb);
+			champ_tally_node(cb, tuplelen, j);
+			sameA = 0;
+		}
 	}
+	if(sameA)
+		return a;
+	if(sameB)
+		return b;
+	return champ_build(&r);
+}
+
+//	Union of a and b, for a key in both b's value or j's combination
+//	of the two. The join counts what b adds to a, the result's hash is
+//	a's plus the join hash
+
+PFRTBitmapNode champ_merge(PFRTBitmapNode a, PFRTBitmapNode b, ft tuplelen,
+	PChampJoin j) {
+	return champ_merge_i(a, b, 0, tuplelen, j);
+}
+
+static PFRTBitmapNode champ_filter_i(PFRTBitmapNode a, PFRTBitmapNode b,
+	ft shift, ft tuplelen, int common, PChampJoin j) {
+	struct ChampBuild 		r;
+	struct FRTBitmapNode 	one;
+	PFRTBitmapNode 			kid, ca, cb;
+	PFRTBitmapNode 			lone[CHAMP_WIDTH];
+	ft 						lcnt = 0;
+	uint32_t 	all = a->datamap | a->nodemap;
+	int 		sameA = 1;
+
+	r.datamap = r.nodemap = 0;
+	r.dlen = r.ncnt = 0;
+	while(all != 0) {
+		uint32_t bitpos = all & (~all + 1);
+		all ^= bitpos;
+		if((a->datamap & bitpos) != 0) {
+			PFRTAny *ea = champ_data(a, bitpos, tuplelen);
+			int 	inb = 0;
+			if((b->datamap & bitpos) != 0)
+				inb = foidl_equal_qmark(ea[0],
+					*champ_data(b, bitpos, tuplelen)) == true;
+			else if((b->nodemap & bitpos) != 0)
+				inb = champ_contains(champ_child(b, bitpos, tuplelen), ea[0],
+					shift + SHIFT, tuplelen);
+			if(!inb)
+				champ_tally(ea, tuplelen, j);
+			if(inb == common)
+				champ_add_data(&r, bitpos, ea, tuplelen);
+			else
+				sameA = 0;
+			continue;
+		}
+		ca = champ_child(a, bitpos, tuplelen);
+		if((b->datamap & bitpos) != 0)
+			kid = champ_filter_i(ca,
+				champ_single(&one, champ_data(b, bitpos, tuplelen), shift + SHIFT),
+				shift + SHIFT, tuplelen, common, j);
+		else if((b->nodemap & bitpos) != 0) {
+			cb = champ_child(b, bitpos, tuplelen);
+			if(ca == cb)
+				kid = common ? ca : NULL;
+			else
+				kid = champ_filter_i(ca, cb, shift + SHIFT, tuplelen, common, j);
+		}
+		else {
+			champ_tally_node(ca, tuplelen, j);
+			kid = common ? NULL : ca;
+		}
+		if(kid == ca)
+			champ_add_node(&r, bitpos, kid);
+		else {
+			sameA = 0;
+			//	A single entry left moves up into this node
+			if(kid != NULL && node_count(kid) == 0 && data_count(kid) == 1) {
+				champ_add_data(&r, bitpos, kid->slots, tuplelen);
+				lone[lcnt++] = kid;
+			}
+			else if(kid != NULL)
+				champ_add_node(&r, bitpos, kid);
+		}
+	}
+	if(sameA)
+		return a;
+	kid = (r.dlen + r.ncnt) ? champ_build(&r) : NULL;
+	for(ft i = 0; i < lcnt; i++) {
+		foidl_retain((PFRTAny) lone[i]);
+		foidl_unref_node(lone[i], tuplelen);
+	}
+	return kid;
+}
+
+//	The entries of a whose keys are (common) or are not in b. The
+//	join counts the entries of a not in b. NULL when nothing is left
+
+PFRTBitmapNode champ_filter(PFRTBitmapNode a, PFRTBitmapNode b, ft tuplelen,
+	int common, PChampJoin j) {
+	return champ_filter_i(a, b, 0, tuplelen, common, j);
 }
@@ -9,7 +9,14 @@
 #define NUMBER_IMPL
 #include <foidlrt.h>
 #include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+#include <float.h>
 #include <m_apm_lc.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 static PFRTAny fend = (PFRTAny) &_end.fclass;
 static PFRTAny fnil = (PFRTAny) &_nil.fclass;
@@ -17,94 +24,321 @@ static PFRTAny ftrue = (PFRTAny) &_true.fclass;
 static PFRTAny ffalse = (PFRTAny) &_false.fclass;
 
 /*
-    Handle library re-entrancy issues
+    MAPM keeps its constants, caches and scratch variables per
+    thread (see M_APM_THREAD in m_apm.h), numbers are created and
+    computed on any thread without a lock. The state of a thread is
+    built on its first use and returned when the thread ends
 */
-#ifdef _MSC_VER
-static HANDLE   number_lock;
-#else
-static pthread_mutex_t number_lock;
-#endif
 
-static void init_locks() {
-#ifdef _MSC_VER
-    number_lock = CreateMutex(
-        NULL,              // default security attributes
-        FALSE,             // initially not owned
-        NULL);
-#else
-    pthread_mutex_init(&number_lock, NULL);
-#endif
+EXTERNC void foidl_number_thread_release() {
+    m_apm_free_all_mem();
 }
 
-static int get_nlock() {
+/*
+    Fixnums
+
+    Integers that fit in 64 bits are held directly in the value of
+    the number (count is number_fixnum) and need no M_APM. Arithmetic
+    on two fixnums is done natively and only overflows into M_APM.
+    Sums, differences and products that come back into range are
+    fixnums again.
+    Integers in [SMALL_MIN, SMALL_MAX] are preallocated, registering
+    one does not allocate at all
+*/
+
+#define SMALL_MIN   -128
+#define SMALL_MAX   1023
+
+static struct FRTTypeG small_ints[SMALL_MAX - SMALL_MIN + 1];
+
+#define FIXVAL(n)   ((lt) (n)->value)
+
 #ifdef _MSC_VER
-    return (int) WaitForSingleObject(
-            number_lock,    // handle to mutex
-            INFINITE);
-#else
-    return pthread_mutex_lock(&number_lock);
-#endif
+static bool fix_add(lt a, lt b, lt *r) {
+    if((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b))
+        return true;
+    *r = a + b;
+    return false;
 }
 
-static int release_nlock() {
-#ifdef _MSC_VER
-    return (int) ReleaseMutex(number_lock);
+static bool fix_sub(lt a, lt b, lt *r) {
+    if((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b))
+        return true;
+    *r = a - b;
+    return false;
+}
+
+static bool fix_mul(lt a, lt b, lt *r) {
+    lt  hi;
+    lt  lo = _mul128(a, b, &hi);
+    if((lo < 0 && hi != -1) || (lo >= 0 && hi != 0))
+        return true;
+    *r = lo;
+    return false;
+}
 #else
-    return pthread_mutex_unlock(&number_lock);
+#define fix_add(a,b,r)  __builtin_add_overflow(a,b,r)
+#define fix_sub(a,b,r)  __builtin_sub_overflow(a,b,r)
+#define fix_mul(a,b,r)  __builtin_mul_overflow(a,b,r)
 #endif
+
+/*
+    Hashing
+
+    Numbers that are equal must hash alike whatever their form. A
+    value a double holds exactly hashes as that double (-0.0 as 0.0),
+    floats compare through their double. Fixnums a double can not
+    hold hash their integer bits and M_APMs beyond DBL_DIG digits
+    their digits, so neighbouring large integers do not collide.
+    Fixnums and floats get it when built, a M_APM on the first hash()
+    as the conversion is costly and most are intermediate results. A
+    computed hash of 0 is stored as 1 to leave 0 as not yet known
+*/
+
+static uint32_t double_hash(double d) {
+    if(d == 0.0)
+        d = 0.0;
+    uint32_t h = murmur3_32((const uint8_t *) &d, sizeof(double), 0);
+    return h ? h : 1;
+}
+
+static uint32_t fixnum_hash(lt v) {
+    double  d = (double) v;
+    if(d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (lt) d == v)
+        return double_hash(d);
+    uint32_t h = murmur3_32((const uint8_t *) &v, sizeof(lt), 0);
+    return h ? h : 1;
+}
+
+static PFRTAny alloc_fixnum(lt v) {
+    if(v >= SMALL_MIN && v <= SMALL_MAX)
+        return (PFRTAny) &small_ints[v - SMALL_MIN].fclass;
+    PFRTAny res = allocAny(scalar_class, number_type, (void *) v);
+    res->count = number_fixnum;
+    res->hash = fixnum_hash(v);
+    return res;
+}
+
+static PFRTAny alloc_mapm(M_APM v) {
+    PFRTAny res = allocAny(scalar_class, number_type, (void *) v);
+    res->hash = 0;
+    return res;
+}
+
+//  A M_APM integer in 64 bits becomes a fixnum, the M_APM is freed
+
+#define FIXNUM_DIGITS   21      // Sign, 19 digits and terminator
+
+static bool apm_fixnum(M_APM v, lt *fv) {
+    char    buf[FIXNUM_DIGITS];
+    if(m_apm_is_integer(v) && m_apm_exponent(v) < 19) {
+        m_apm_to_integer_string(buf, v);
+        errno = 0;
+        *fv = strtoll(buf, NULL, 10);
+        return errno == 0;
+    }
+    return false;
+}
+
+static PFRTAny apm_result(M_APM v) {
+    lt  fv;
+    if(apm_fixnum(v, &fv)) {
+        m_apm_free(v);
+        return alloc_fixnum(fv);
+    }
+    return alloc_mapm(v);
+}
+
+static bool both_fixnum(PFRTAny lhs, PFRTAny rhs) {
+    return lhs->count == number_fixnum && rhs->count == number_fixnum;
+}
+
+/*
+    Floats
+
+    A float holds an IEEE double in the value of the number (count
+    is number_float). Floats are inexact and contagious, when either
+    operand is a float the other is converted and the operation is
+    done in hardware giving a float. float: and exact: convert
+    explicitly in either direction
+*/
+
+#define FLOAT_DIGITS    32      // Longest %.17g rendering and terminator
+
+static double FLOVAL(PFRTAny n) {
+    double  d;
+    memcpy(&d, &n->value, sizeof(double));
+    return d;
+}
+
+static PFRTAny alloc_float(double d) {
+    PFRTAny res = allocAny(scalar_class, number_type, NULL);
+    memcpy(&res->value, &d, sizeof(double));
+    res->count = number_float;
+    res->hash = double_hash(d);
+    return res;
+}
+
+static bool either_float(PFRTAny lhs, PFRTAny rhs) {
+    return lhs->count == number_float || rhs->count == number_float;
+}
+
+static double double_of(PFRTAny num) {
+    char    buf[64];
+    if(num->count == number_float)
+        return FLOVAL(num);
+    if(num->count == number_fixnum)
+        return (double) FIXVAL(num);
+    m_apm_to_string(buf, 17, (M_APM) num->value);
+    return strtod(buf, NULL);
+}
+
+//  Integers in 64 bits hash as the fixnum, up to DBL_DIG digits as
+//  the double, longer ones over sign, exponent and base 100 digits
+
+static uint32_t apm_hash(PFRTAny num) {
+    M_APM   v = (M_APM) num->value;
+    lt      fv;
+    if(apm_fixnum(v, &fv))
+        return fixnum_hash(fv);
+    if(m_apm_significant_digits(v) <= DBL_DIG)
+        return double_hash(double_of(num));
+    uint32_t seed = (uint32_t) v->m_apm_exponent ^ ((uint32_t) v->m_apm_sign << 24);
+    uint32_t h = murmur3_32((const uint8_t *) v->m_apm_data,
+        (v->m_apm_datalength + 1) >> 1, seed);
+    return h ? h : 1;
+}
+
+EXTERNC uint32_t number_hash(PFRTAny num) {
+    if(num->hash == 0)
+        num->hash = num->count == number_mapm ?
+            apm_hash(num) : double_hash(double_of(num));
+    return num->hash;
+}
+
+//  Returns the M_APM of a number, fixnums and floats get a
+//  temporary one that is given back with apm_done
+
+static M_APM apm_of(PFRTAny num) {
+    char    buf[FLOAT_DIGITS];
+    if(num->count == number_mapm)
+        return (M_APM) num->value;
+    M_APM   res = m_apm_init();
+    if(num->count == number_fixnum)
+        snprintf(buf, FLOAT_DIGITS, "%lld", FIXVAL(num));
+    else if(isfinite(FLOVAL(num)))
+        snprintf(buf, FLOAT_DIGITS, "%.17g", FLOVAL(num));
+    else
+        unknown_handler();
+    m_apm_set_string(res, buf);
+    return res;
+}
+
+static void apm_done(PFRTAny num, M_APM v) {
+    if(num->count != number_mapm)
+        m_apm_free(v);
+}
+
+//  Decimal literals without fraction or exponent that fit
+//  in 64 bits become fixnums
+
+static bool fixnum_literal(char *s, lt *v) {
+    char    *p = s;
+    if(*p == '-')
+        ++p;
+    if(*p == 0 || strlen(p) > 18)
+        return false;
+    for(; *p; p++)
+        if(*p < '0' || *p > '9')
+            return false;
+    *v = strtoll(s, NULL, 10);
+    return true;
 }
 
 // Register a new number
 
 EXTERNC PFRTAny  foidl_reg_number(char *s) {
-    get_nlock();
-    M_APM   numapm = m_apm_init();
-    if(strlen(s) > 2 && s[0] == '0') {
+    lt      v;
+    size_t  len = strlen(s);
+    if(len > 2 && s[0] == '0') {
         switch(s[1]) {
             case 'x':
             case 'X':
-                m_apm_set_long(numapm,
-                    strtol(&s[2], NULL, 16));
-                break;
+                return alloc_fixnum(strtoll(&s[2], NULL, 16));
             case 'b':
             case 'B':
-                m_apm_set_long(numapm,
-                    strtol(&s[2], NULL, 2));
-                break;
+                return alloc_fixnum(strtoll(&s[2], NULL, 2));
             default:
-                m_apm_set_string(numapm, s);
+                break;
         }
     }
-    else {
-        m_apm_set_string(numapm, s);
-    }
-    release_nlock();
-    return allocAny(scalar_class, number_type, (void *)numapm);
+    if(len > 1 && (s[len-1] == 'f' || s[len-1] == 'F'))
+        return alloc_float(strtod(s, NULL));
+    if(fixnum_literal(s, &v))
+        return alloc_fixnum(v);
+    M_APM   numapm = m_apm_init();
+    m_apm_set_string(numapm, s);
+    return alloc_mapm(numapm);
 }
 
 EXTERNC PFRTAny foidl_reg_intnum(long long v) {
-    get_nlock();
-    M_APM   numapm = m_apm_init();
-    m_apm_set_long(numapm,v);
-    release_nlock();
-    return allocAny(scalar_class, number_type, (void *)numapm);
+    return alloc_fixnum(v);
+}
+
+EXTERNC PFRTAny foidl_reg_floatnum(double d) {
+    return alloc_float(d);
+}
+
+EXTERNC void release_number_value(void *numapm) {
+    m_apm_free((M_APM) numapm);
+}
+
+EXTERNC void release_number(PFRTAny num) {
+    if(num->count == number_mapm)
+        release_number_value(num->value);
+    foidl_xdel(num);
 }
 
 // Conversions and helpers
 
+//  Trailing zeros of large integers and leading zeros of small
+//  fractions are not significant digits, the exponent covers them
+
 static ft num_buffersize(M_APM numapm) {
+    int exp = m_apm_exponent(numapm);
     ft cnt = (m_apm_sign(numapm) == -1) ? 1 : 0;
     cnt += m_apm_significant_digits(numapm);
-    cnt += (m_apm_is_integer(numapm) == 0) ? 1 : 0;
+    cnt += (exp < 0) ? -exp : exp;
+    cnt += (m_apm_is_integer(numapm) == 0) ? 2 : 0;
     return cnt+1;
-
 }
 
+
 EXTERNC ft  number_tostring_buffersize(PFRTAny num) {
+    if(num->count == number_fixnum)
+        return FIXNUM_DIGITS;
+    if(num->count == number_float)
+        return FLOAT_DIGITS;
     return num_buffersize((M_APM) num->value);
 }
 
 EXTERNC char *number_tostring(PFRTAny num) {
+    if(num->count == number_fixnum) {
+        char *foo = (char *) foidl_xall(FIXNUM_DIGITS);
+        snprintf(foo, FIXNUM_DIGITS, "%lld", FIXVAL(num));
+        return foo;
+    }
+    if(num->count == number_float) {
+        //  Shortest form that reads back as the same double
+        char    *foo = (char *) foidl_xall(FLOAT_DIGITS);
+        double  d = FLOVAL(num);
+        for(int prec = 15; prec <= 17; prec++) {
+            snprintf(foo, FLOAT_DIGITS, "%.*g", prec, d);
+            if(strtod(foo, NULL) == d)
+                break;
+        }
+        return foo;
+    }
     M_APM   numapm = (M_APM) num->value;
     char *foo = (char *) foidl_xall(num_buffersize(numapm));
     if(m_apm_is_integer(numapm) == 1) {
@@ -123,7 +357,12 @@ static M_APM _make_abs(M_APM numapm) {
 }
 
 EXTERNC long long number_tolong(PFRTAny num) {
-    get_nlock();
+    if(num->count == number_fixnum) {
+        lt v = FIXVAL(num);
+        return v < 0 ? -v : v;
+    }
+    if(num->count == number_float)
+        return (long long) fabs(FLOVAL(num));
     M_APM   numapm = (M_APM) num->value;
     M_APM   numabs = _make_abs(numapm);
     char *nts = (char *)foidl_xall(num_buffersize(numabs));
@@ -131,7 +370,6 @@ EXTERNC long long number_tolong(PFRTAny num) {
     long long res = strtoll(nts, NULL, 10);
     foidl_xdel(nts);
     m_apm_free(numabs);
-    release_nlock();
     return res;
 }
 
@@ -143,10 +381,27 @@ EXTERNC ft number_toft(PFRTAny num) {
     return (ft) number_tolong(num);
 }
 
+EXTERNC double number_todouble(PFRTAny num) {
+    return double_of(num);
+}
+
 // Equality
 
 static int _mnum_equality(PFRTAny flhs, PFRTAny frhs) {
-    return m_apm_compare((M_APM) flhs->value, (M_APM) frhs->value);
+    if(both_fixnum(flhs, frhs)) {
+        lt l = FIXVAL(flhs), r = FIXVAL(frhs);
+        return l < r ? -1 : l > r ? 1 : 0;
+    }
+    if(either_float(flhs, frhs)) {
+        double l = double_of(flhs), r = double_of(frhs);
+        return l < r ? -1 : l == r ? 0 : 1;
+    }
+    M_APM   l = apm_of(flhs);
+    M_APM   r = apm_of(frhs);
+    int     res = m_apm_compare(l, r);
+    apm_done(flhs, l);
+    apm_done(frhs, r);
+    return res;
 }
 
 EXTERNC PFRTAny foidl_num_lt(PFRTAny flhs, PFRTAny frhs) {
@@ -194,6 +449,10 @@ EXTERNC PFRTAny foidl_num_gteq(PFRTAny flhs, PFRTAny frhs) {
 // Odd/Even
 
 EXTERNC PFRTAny foidl_num_odd(PFRTAny flhs) {
+    if(flhs->count == number_fixnum)
+        return (FIXVAL(flhs) & 1) ? ftrue : ffalse;
+    if(flhs->count == number_float)
+        return fabs(fmod(FLOVAL(flhs), 2.0)) == 1.0 ? ftrue : ffalse;
     if(m_apm_is_odd((M_APM) flhs->value) == 1)
         return ftrue;
     else
@@ -201,6 +460,10 @@ EXTERNC PFRTAny foidl_num_odd(PFRTAny flhs) {
 }
 
 EXTERNC PFRTAny foidl_num_even(PFRTAny flhs) {
+    if(flhs->count == number_fixnum)
+        return (FIXVAL(flhs) & 1) ? ffalse : ftrue;
+    if(flhs->count == number_float)
+        return fmod(FLOVAL(flhs), 2.0) == 0.0 ? ftrue : ffalse;
     if(m_apm_is_even((M_APM) flhs->value) == 1)
         return ftrue;
     else
@@ -210,127 +473,235 @@ EXTERNC PFRTAny foidl_num_even(PFRTAny flhs) {
 // Positive negative
 
 EXTERNC PFRTAny is_number_positive(PFRTAny arg) {
+    if(arg->count == number_fixnum)
+        return FIXVAL(arg) < 0 ? ffalse : ftrue;
+    if(arg->count == number_float)
+        return FLOVAL(arg) < 0.0 ? ffalse : ftrue;
     return (m_apm_sign((M_APM) arg->value) == -1) ? ffalse: ftrue;
 }
 
 EXTERNC PFRTAny is_number_negative(PFRTAny arg) {
+    if(arg->count == number_fixnum)
+        return FIXVAL(arg) < 0 ? ftrue : ffalse;
+    if(arg->count == number_float)
+        return FLOVAL(arg) < 0.0 ? ftrue : ffalse;
     return (m_apm_sign((M_APM)arg->value) == -1) ? ftrue : ffalse;
 }
 
 EXTERNC PFRTAny is_number_integer(PFRTAny arg) {
+    if(arg->count == number_fixnum)
+        return ftrue;
+    if(arg->count == number_float) {
+        double d = FLOVAL(arg);
+        return (isfinite(d) && d == floor(d)) ? ftrue : ffalse;
+    }
     return (m_apm_is_integer((M_APM)arg->value) == 1) ? ftrue : ffalse;
 }
 
 // +, -, *, /
 
+typedef void (*apm_binary)(M_APM, M_APM, M_APM);
+
+static PFRTAny apm_binop(apm_binary fn, PFRTAny flhs, PFRTAny frhs) {
+    M_APM   l = apm_of(flhs);
+    M_APM   r = apm_of(frhs);
+    M_APM   res = m_apm_init();
+    fn(res, l, r);
+    apm_done(flhs, l);
+    apm_done(frhs, r);
+    return apm_result(res);
+}
+
 EXTERNC PFRTAny     foidl_num_add(PFRTAny flhs, PFRTAny frhs) {
-    M_APM res = m_apm_init();
-    m_apm_add(res, (M_APM)flhs->value,(M_APM)frhs->value);
-    return allocAny(scalar_class, number_type, (void *)res);
+    lt  v;
+    if(either_float(flhs, frhs))
+        return alloc_float(double_of(flhs) + double_of(frhs));
+    if(both_fixnum(flhs, frhs) && !fix_add(FIXVAL(flhs), FIXVAL(frhs), &v))
+        return alloc_fixnum(v);
+    return apm_binop(m_apm_add, flhs, frhs);
 }
 
 EXTERNC PFRTAny     foidl_num_sub(PFRTAny flhs, PFRTAny frhs) {
-    M_APM res = m_apm_init();
-    m_apm_subtract(res, (M_APM)flhs->value, (M_APM)frhs->value);
-    return allocAny(scalar_class, number_type, (void *)res);
+    lt  v;
+    if(either_float(flhs, frhs))
+        return alloc_float(double_of(flhs) - double_of(frhs));
+    if(both_fixnum(flhs, frhs) && !fix_sub(FIXVAL(flhs), FIXVAL(frhs), &v))
+        return alloc_fixnum(v);
+    return apm_binop(m_apm_subtract, flhs, frhs);
 }
 
 EXTERNC PFRTAny     foidl_num_mul(PFRTAny flhs, PFRTAny frhs) {
-    M_APM res = m_apm_init();
-    m_apm_multiply(res, (M_APM)flhs->value,(M_APM)frhs->value);
-    return allocAny(scalar_class, number_type, (void *)res);
+    lt  v;
+    if(either_float(flhs, frhs))
+        return alloc_float(double_of(flhs) * double_of(frhs));
+    if(both_fixnum(flhs, frhs) && !fix_mul(FIXVAL(flhs), FIXVAL(frhs), &v))
+        return alloc_fixnum(v);
+    return apm_binop(m_apm_multiply, flhs, frhs);
 }
 
+//  Exact fixnum quotients stay fixnums, the rest are M_APM
+
 EXTERNC PFRTAny     foidl_num_div(PFRTAny flhs, PFRTAny frhs) {
-    M_APM res = m_apm_init();
-    m_apm_divide(res, 10, (M_APM)flhs->value,(M_APM)frhs->value);
-    return allocAny(scalar_class, number_type, (void *)res);
+    if(either_float(flhs, frhs))
+        return alloc_float(double_of(flhs) / double_of(frhs));
+    if(both_fixnum(flhs, frhs)) {
+        lt l = FIXVAL(flhs), r = FIXVAL(frhs);
+        if(r != 0 && r != -1 && l % r == 0)
+            return alloc_fixnum(l / r);
+    }
+    M_APM   l = apm_of(flhs);
+    M_APM   r = apm_of(frhs);
+    M_APM   res = m_apm_init();
+    m_apm_divide(res, 10, l, r);
+    apm_done(flhs, l);
+    apm_done(frhs, r);
+    return alloc_mapm(res);
 }
 
 EXTERNC PFRTAny foidl_num_mod(PFRTAny arg1, PFRTAny arg2) {
+    if(either_float(arg1, arg2))
+        return alloc_float(fmod(double_of(arg1), double_of(arg2)));
+    if(both_fixnum(arg1, arg2) && FIXVAL(arg2) != 0) {
+        lt r = FIXVAL(arg2);
+        return alloc_fixnum(r == -1 ? 0 : FIXVAL(arg1) % r);
+    }
+    M_APM l = apm_of(arg1);
+    M_APM d = apm_of(arg2);
     M_APM q = m_apm_init();
     M_APM r = m_apm_init();
-    m_apm_integer_div_rem(q, r, (M_APM)arg1->value, (M_APM)arg2->value);
+    m_apm_integer_div_rem(q, r, l, d);
     m_apm_free(q);
-    return allocAny(scalar_class, number_type, (void *)r);
+    apm_done(arg1, l);
+    apm_done(arg2, d);
+    return alloc_mapm(r);
 }
 
 // Functions on numbers
 
+typedef void (*apm_unary)(M_APM, M_APM);
+
+static PFRTAny apm_unop(apm_unary fn, PFRTAny arg) {
+    M_APM   v = apm_of(arg);
+    M_APM   res = m_apm_init();
+    fn(res, v);
+    apm_done(arg, v);
+    return alloc_mapm(res);
+}
+
+typedef void (*apm_places)(M_APM, int, M_APM);
+
+static PFRTAny apm_placesop(apm_places fn, PFRTAny decpl, PFRTAny arg) {
+    int     decs = _number_toint(decpl);
+    M_APM   v = apm_of(arg);
+    M_APM   res = m_apm_init();
+    fn(res, decs, v);
+    apm_done(arg, v);
+    return alloc_mapm(res);
+}
+
 EXTERNC PFRTAny foidl_num_abs(PFRTAny arg) {
     if(arg->ftype != number_type)
         unknown_handler();
-    M_APM numabs = (_make_abs((M_APM) arg->value));
-    return allocAny(scalar_class, number_type, (void *)numabs);
+    if(arg->count == number_fixnum && FIXVAL(arg) != LLONG_MIN)
+        return FIXVAL(arg) < 0 ? alloc_fixnum(-FIXVAL(arg)) : arg;
+    if(arg->count == number_float)
+        return alloc_float(fabs(FLOVAL(arg)));
+    return apm_unop(m_apm_absolute_value, arg);
 }
 
 EXTERNC PFRTAny foidl_num_neg(PFRTAny arg) {
     if(arg->ftype != number_type)
         unknown_handler();
-    M_APM numneg = m_apm_init();
-    m_apm_negate(numneg, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numneg);
+    if(arg->count == number_fixnum && FIXVAL(arg) != LLONG_MIN)
+        return alloc_fixnum(-FIXVAL(arg));
+    if(arg->count == number_float)
+        return alloc_float(-FLOVAL(arg));
+    return apm_unop(m_apm_negate, arg);
 }
 
 EXTERNC PFRTAny foidl_num_factorial(PFRTAny arg) {
     if(arg->ftype != number_type)
         unknown_handler();
-    M_APM numflr = m_apm_init();
-    m_apm_factorial(numflr, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numflr);
+    return apm_unop(m_apm_factorial, arg);
 }
 
 EXTERNC PFRTAny foidl_num_floor(PFRTAny arg) {
     if(arg->ftype != number_type)
         unknown_handler();
-    M_APM numflr = m_apm_init();
-    m_apm_floor(numflr, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numflr);
+    if(arg->count == number_fixnum)
+        return arg;
+    if(arg->count == number_float)
+        return alloc_float(floor(FLOVAL(arg)));
+    return apm_unop(m_apm_floor, arg);
 }
 
 EXTERNC PFRTAny foidl_num_ceil(PFRTAny arg) {
     if(arg->ftype != number_type)
         unknown_handler();
-    M_APM numcil = m_apm_init();
-    m_apm_ceil(numcil, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numcil);
+    if(arg->count == number_fixnum)
+        return arg;
+    if(arg->count == number_float)
+        return alloc_float(ceil(FLOVAL(arg)));
+    return apm_unop(m_apm_ceil, arg);
 }
 
 EXTERNC PFRTAny foidl_num_round(PFRTAny decpl, PFRTAny arg) {
     if(arg->ftype != number_type || decpl->ftype != number_type)
         unknown_handler();
-    M_APM numcil = m_apm_init();
-    int decs = _number_toint(decpl);
-    m_apm_round(numcil, decs, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numcil);
+    if(arg->count == number_fixnum)
+        return arg;
+    if(arg->count == number_float) {
+        double p = pow(10.0, _number_toint(decpl));
+        return alloc_float(round(FLOVAL(arg) * p) / p);
+    }
+    return apm_placesop(m_apm_round, decpl, arg);
 }
 
 EXTERNC PFRTAny foidl_num_sqrt(PFRTAny decpl, PFRTAny arg) {
     if(arg->ftype != number_type || decpl->ftype != number_type)
         unknown_handler();
-    M_APM numcil = m_apm_init();
-    int decs = _number_toint(decpl);
-    m_apm_sqrt(numcil, decs, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numcil);
+    if(arg->count == number_float)
+        return alloc_float(sqrt(FLOVAL(arg)));
+    return apm_placesop(m_apm_sqrt, decpl, arg);
 }
 
 EXTERNC PFRTAny foidl_num_sin(PFRTAny decpl, PFRTAny arg) {
     if(arg->ftype != number_type || decpl->ftype != number_type)
         unknown_handler();
-    M_APM numcil = m_apm_init();
-    int decs = _number_toint(decpl);
-    m_apm_sin(numcil, decs, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numcil);
+    if(arg->count == number_float)
+        return alloc_float(sin(FLOVAL(arg)));
+    return apm_placesop(m_apm_sin, decpl, arg);
 }
 
 EXTERNC PFRTAny foidl_num_cos(PFRTAny decpl, PFRTAny arg) {
     if(arg->ftype != number_type || decpl->ftype != number_type)
         unknown_handler();
-    M_APM numcil = m_apm_init();
-    int decs = _number_toint(decpl);
-    m_apm_cos(numcil, decs, (M_APM) arg->value);
-    return allocAny(scalar_class, number_type, (void *)numcil);
+    if(arg->count == number_float)
+        return alloc_float(cos(FLOVAL(arg)));
+    return apm_placesop(m_apm_cos, decpl, arg);
+}
+// Conversions between exact numbers and floats
+
+EXTERNC PFRTAny foidl_num_float(PFRTAny arg) {
+    if(arg->ftype != number_type)
+        unknown_handler();
+    if(arg->count == number_float)
+        return arg;
+    return alloc_float(double_of(arg));
 }
+
+EXTERNC PFRTAny foidl_num_exact(PFRTAny arg) {
+    if(arg->ftype != number_type)
+        unknown_handler();
+    if(arg->count != number_float)
+        return arg;
+    double  d = FLOVAL(arg);
+    if(d == floor(d) && d >= -9.2e18 && d <= 9.2e18)
+        return alloc_fixnum((lt) d);
+    M_APM   res = apm_of(arg);
+    return alloc_mapm(res);
+}
+
 // Shorthand macro
 
 #define genint(lsym,v)  lsym = foidl_reg_intnum((long long) v)
@@ -338,35 +709,32 @@ EXTERNC PFRTAny foidl_num_cos(PFRTAny decpl, PFRTAny arg) {
 // Global 0 - 16 setup
 
 EXTERNC void foidl_rtl_init_numbers() {
-    M_init_trig_globals();
-    init_locks();
+    for(lt v = SMALL_MIN; v <= SMALL_MAX; v++) {
+        struct FRTTypeG *g = &small_ints[v - SMALL_MIN];
+        g->fsig = global_signature;
+        g->fclass = scalar_class;
+        g->ftype = number_type;
+        g->count = number_fixnum;
+        g->value = (void *) v;
+        g->hash = fixnum_hash(v);
+    }
     //  Utilitity counters
-    zero = allocAny(scalar_class, number_type, (void *)MM_Zero);
-    one = allocAny(scalar_class, number_type, (void *)MM_One);
-    two = allocAny(scalar_class, number_type, (void *)MM_Two);
-    three = allocAny(scalar_class, number_type, (void *)MM_Three);
-    four = allocAny(scalar_class, number_type, (void *)MM_Four);
-    five = allocAny(scalar_class, number_type, (void *)MM_Five);
-    /*
     genint(zero,0x00);
     genint(one,0x01);
     genint(two,0x02);
     genint(three,0x03);
     genint(four,0x04);
     genint(five,0x05);
-    */
     genint(six,0x06);
     genint(seven,0x07);
     genint(eight,0x08);
     genint(nine,0x09);
-    // genint(ten,0x0A);
-    ten = allocAny(scalar_class, number_type, (void *)MM_Ten);
+    genint(ten,0x0A);
     genint(eleven,0x0B);
     genint(twelve,0x0C);
     genint(thirteen,0x0D);
     genint(fourteen,0x0E);
     genint(fifteen,0x0F);
     genint(sixteen,0x10);
-
     return;
 }
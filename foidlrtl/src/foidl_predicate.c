@@ -56,8 +56,12 @@ PFRTAny scalar_equality(PFRTAny lhs, PFRTAny rhs) {
 				if(lhs->value != rhs->value)
 					res = false;
 			}
+			// Keywords are interned
+			else if(lhs->ftype == keyword_type)
+				res = false;
 			else {
-				if (0 != strcmp((char *)lhs->value,(char *)rhs->value))
+				if (lhs->count != rhs->count
+					|| 0 != memcmp(lhs->value,rhs->value,lhs->count))
 					res = false;
 			}
 		}
@@ -65,7 +69,8 @@ PFRTAny scalar_equality(PFRTAny lhs, PFRTAny rhs) {
 			if( (lhs->ftype == string_type && rhs->ftype == keyword_type)
 				||
 				(rhs->ftype == string_type && lhs->ftype == keyword_type) ) {
-				if (0 != strcmp((char *)lhs->value,(char *)rhs->value))
+				if (lhs->count != rhs->count
+					|| 0 != memcmp(lhs->value,rhs->value,lhs->count))
 					res = false;
 			}
 			else
@@ -76,6 +81,68 @@ PFRTAny scalar_equality(PFRTAny lhs, PFRTAny rhs) {
 	return res;
 }
 
+//	Maps, sets, lists and vectors of the same type are equal when
+//	their contents are. The count and structural hash settle most
+//	unequal pairs without visiting the elements
+
+PFRTAny foidl_equal_qmark(PFRTAny, PFRTAny);
+
+static PFRTAny collection_equality(PFRTAny lhs, PFRTAny rhs) {
+	PFRTAny 		res = true;
+	PFRTAny 		el;
+	if(lhs == rhs)
+		return true;
+	if(lhs->ftype != rhs->ftype || lhs->count != rhs->count
+		|| hash(lhs) != hash(rhs))
+		return false;
+	if(lhs->ftype == bytearray_type || lhs->ftype == intarray_type
+		|| lhs->ftype == floatarray_type)
+		return prim_equal(lhs, rhs);
+	PFRTIterator 	li = iteratorFor(lhs);
+	PFRTIterator 	ri = NULL;
+	switch(lhs->ftype) {
+		case 	map2_type:
+			while(res == true && (el = iteratorNext(li)) != end) {
+				PFRTMapEntry e = (PFRTMapEntry) el;
+				if(map_contains_qmark(rhs, e->key) != true
+					|| foidl_equal_qmark(e->value, map_get(rhs, e->key)) != true)
+					res = false;
+			}
+			break;
+		case 	set2_type:
+			while(res == true && (el = iteratorNext(li)) != end)
+				if(foidl_equal_qmark(set_get(rhs, el), el) != true)
+					res = false;
+			break;
+		case 	sortedmap_type:
+			ri = iteratorFor(rhs);
+			while(res == true && (el = iteratorNext(li)) != end) {
+				PFRTMapEntry e = (PFRTMapEntry) el;
+				PFRTMapEntry r = (PFRTMapEntry) iteratorNext(ri);
+				if(foidl_equal_qmark(e->key, r->key) != true
+					|| foidl_equal_qmark(e->value, r->value) != true)
+					res = false;
+				foidl_release_temp((PFRTAny) e);
+				foidl_release_temp((PFRTAny) r);
+			}
+			iteratorRelease(ri);
+			break;
+		case 	sortedset_type:
+		case 	list2_type:
+		case 	vector2_type:
+			ri = iteratorFor(rhs);
+			while(res == true && (el = iteratorNext(li)) != end)
+				res = foidl_equal_qmark(el, iteratorNext(ri));
+			iteratorRelease(ri);
+			break;
+		default:
+			res = false;
+			break;
+	}
+	iteratorRelease(li);
+	return res;
+}
+
 //	=, !=, <, <=, >, >=
 
 PFRTAny foidl_equal_qmark(PFRTAny lhs, PFRTAny rhs) {
@@ -90,8 +157,7 @@ PFRTAny foidl_equal_qmark(PFRTAny lhs, PFRTAny rhs) {
 					res = true;
 				break;
 			case 	collection_class:
-				if( lhs == rhs )
-					res = true;
+				res = collection_equality(lhs,rhs);
 				break;
 			default:
 				unknown_handler();
@@ -212,7 +278,11 @@ PFRTAny foidl_collection_qmark(PFRTAny el) {
 		(el->fclass == collection_class &&
 		(el->ftype == map2_type || el->ftype == list2_type
 		 || el->ftype == list2_type || el->ftype == vector2_type
-		 || el->ftype == set2_type|| el->ftype == series_type))) ? true : false;
+		 || el->ftype == set2_type|| el->ftype == series_type
+		 || el->ftype == sortedmap_type || el->ftype == sortedset_type
+		 || el->ftype == bytearray_type || el->ftype == intarray_type
+		 || el->ftype == floatarray_type))) ?
+		 true : false;
 	if(res == false) {
 		if(el->ftype == string_type || el->ftype == keyword_type)
 			res = true;
@@ -228,7 +298,8 @@ PFRTAny foidl_extendable_qmark(PFRTAny el) {
 }
 
 PFRTAny foidl_empty_qmark(PFRTAny el) {
-	if(foidl_collection_qmark(el) == true || el->ftype == string_type)
+	if(foidl_collection_qmark(el) == true || el->ftype == string_type
+		|| el->ftype == keyword_type)
 		return el->count == 0 ? true : false;
 	else
 		return true;
@@ -248,6 +319,10 @@ PFRTAny foidl_number_qmark(PFRTAny el) {
 	return (el->ftype == number_type) ? true : false;
 }
 
+PFRTAny foidl_float_qmark(PFRTAny el) {
+	return (el->ftype == number_type && el->count == number_float) ? true : false;
+}
+
 PFRTAny foidl_even_qmark(PFRTAny el) {
 	PFRTAny res = false;
 	if(foidl_number_qmark(el) == true) {
@@ -299,7 +374,8 @@ PFRTAny foidl_integer_qmark(PFRTAny el) {
 }
 
 PFRTAny foidl_string_qmark(PFRTAny el) {
-	return (el->ftype == string_type) ? true : false;
+	return (el->ftype == string_type || el->ftype == keyword_type) ?
+		true : false;
 }
 
 PFRTAny foidl_keyword_qmark(PFRTAny el) {
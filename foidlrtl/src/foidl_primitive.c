@@ -0,0 +1,679 @@
+/*
+	foidl_primitive.c
+	Library support for unboxed byte, int and float arrays
+
+	Copyright Frank V. Castellucci
+	All Rights Reserved
+*/
+
+#define  PRIMITIVE_IMPL
+#include <foidlrt.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PRIM_SSE2
+#endif
+
+#ifdef _MSC_VER
+#define FILL_CAS(p,o,n) 	((ft) InterlockedCompareExchange64((LONG64 *)(p),(LONG64)(n),(LONG64)(o)) == (o))
+
+static int fix_mul(lt a, lt b, lt *r) {
+	lt  hi;
+	lt  lo = _mul128(a, b, &hi);
+	if((lo < 0 && hi != -1) || (lo >= 0 && hi != 0))
+		return 1;
+	*r = lo;
+	return 0;
+}
+#else
+#define FILL_CAS(p,o,n) 	__sync_bool_compare_and_swap((p),(o),(n))
+#define fix_mul(a,b,r) 		__builtin_mul_overflow(a,b,r)
+#endif
+
+#define PRIM_GROW 	16 		//	Least capacity of a copied block
+
+typedef union PrimValue {
+	uint8_t 	b;
+	lt 			i;
+	double 		f;
+} PrimValue;
+
+static int is_prim(PFRTAny s) {
+	return s->fclass == collection_class && (s->ftype == bytearray_type
+		|| s->ftype == intarray_type || s->ftype == floatarray_type);
+}
+
+static uint32_t prim_width(ft ftype) {
+	return ftype == bytearray_type ? 1 : 8;
+}
+
+//	Element value of v for an array type, 0 if it has none
+
+static int prim_value(ft ftype, PFRTAny v, PrimValue *pv) {
+	if(ftype == bytearray_type) {
+		if(v->ftype == byte_type) {
+			pv->b = (uint8_t) (ft) v->value;
+			return 1;
+		}
+		if(v->ftype != number_type || v->count != number_fixnum
+			|| (lt) v->value < 0 || (lt) v->value > 255)
+			return 0;
+		pv->b = (uint8_t) (ft) v->value;
+	}
+	else if(ftype == intarray_type) {
+		if(v->ftype != number_type || v->count != number_fixnum)
+			return 0;
+		pv->i = (lt) v->value;
+	}
+	else {
+		if(v->ftype != number_type)
+			return 0;
+		pv->f = number_todouble(v);
+	}
+	return 1;
+}
+
+static void prim_put(ft ftype, PFRTPrimData d, ft i, PFRTAny v) {
+	PrimValue 	pv;
+	if(prim_value(ftype, v, &pv) == 0)
+		unknown_handler();
+	memcpy(PRIM_BYTES(d) + i * d->width, &pv, d->width);
+}
+
+static PFRTAny prim_box(PFRTPrimArray a, ft i) {
+	uint8_t 	*b = PRIM_BYTES(a->data);
+	if(a->ftype == bytearray_type)
+		return foidl_reg_intnum(b[i]);
+	if(a->ftype == intarray_type)
+		return foidl_reg_intnum(((lt *) b)[i]);
+	return foidl_reg_floatnum(((double *) b)[i]);
+}
+
+//	A new block holding the first cnt elements of src with room for cap
+
+static PFRTPrimData prim_copy(PFRTPrimData src, ft cnt, ft cap) {
+	PFRTPrimData d = allocPrimData(src->width, cap);
+	memcpy(PRIM_BYTES(d), PRIM_BYTES(src), cnt * src->width);
+	d->fill = cnt;
+	return d;
+}
+
+static ft prim_grow(ft cnt) {
+	return cnt < PRIM_GROW / 2 ? PRIM_GROW : cnt * 2;
+}
+
+//	A block no other array can see may be changed in place
+
+static int prim_owned(PFRTPrimData d) {
+	PFRTTypeG g = ANYTOG(d);
+	return SIGOF(g) == alloc_signature && (g->fsig & ref_mask) == ref_one;
+}
+
+//	Swaps the block of a, the old one is released
+
+static void prim_setdata(PFRTPrimArray a, PFRTPrimData d) {
+	PFRTPrimData old = a->data;
+	a->data = (PFRTPrimData) foidl_retain((PFRTAny) d);
+	foidl_unref((PFRTAny) old);
+}
+
+static PFRTPrimArray prim_new(ft ftype, ft cnt) {
+	PFRTPrimData d = allocPrimData(prim_width(ftype), cnt);
+	d->fill = cnt;
+	return allocPrimArray(ftype, cnt, d);
+}
+
+static ft prim_index(PFRTAny index) {
+	if(index->ftype != number_type)
+		unknown_handler();
+	return number_toft(index);
+}
+
+//	Builds from any iterator's elements
+
+PFRTAny prim_from_iterator(ft ftype, PFRTIterator itr) {
+	PFRTPrimData 	d = allocPrimData(prim_width(ftype), PRIM_GROW);
+	PFRTAny 		one;
+	PFRTAny 		*elems;
+	ft 				n;
+	while((n = iteratorChunk(itr, &one, &elems)) > 0) {
+		for(ft i = 0; i < n; i++) {
+			if(d->fill == d->capacity) {
+				PFRTPrimData nd = prim_copy(d, d->fill, d->fill * 2);
+				foidl_xdel(d);
+				d = nd;
+			}
+			prim_put(ftype, d, d->fill++, elems[i]);
+		}
+	}
+	return (PFRTAny) allocPrimArray(ftype, d->fill, d);
+}
+
+//	Access
+
+PFRTAny prim_get(PFRTAny s, PFRTAny index) {
+	ft 	i = prim_index(index);
+	return i < s->count ? prim_box((PFRTPrimArray) s, i) : nil;
+}
+
+PFRTAny prim_get_default(PFRTAny s, PFRTAny index, PFRTAny def) {
+	ft 	i = prim_index(index);
+	return i < s->count ? prim_box((PFRTPrimArray) s, i) : def;
+}
+
+PFRTAny prim_first(PFRTAny s) {
+	return s->count > 0 ? prim_box((PFRTPrimArray) s, 0) : nil;
+}
+
+PFRTAny prim_second(PFRTAny s) {
+	return s->count > 1 ? prim_box((PFRTPrimArray) s, 1) : nil;
+}
+
+PFRTAny prim_last(PFRTAny s) {
+	return s->count > 0 ? prim_box((PFRTPrimArray) s, s->count - 1) : nil;
+}
+
+//	Extend appends in place when this array ends where its block was
+//	last written and there is room. The first array to claim the slot
+//	gets it, others copy
+
+PFRTAny prim_extend(PFRTAny s, PFRTAny v) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	PFRTPrimData 	d = a->data;
+	ft 				cnt = a->count;
+	PrimValue 		pv;
+	if(prim_value(a->ftype, v, &pv) == 0)
+		unknown_handler();
+	if(cnt >= d->capacity || FILL_CAS(&d->fill, cnt, cnt + 1) == 0) {
+		d = prim_copy(d, cnt, prim_grow(cnt));
+		d->fill = cnt + 1;
+	}
+	memcpy(PRIM_BYTES(d) + cnt * d->width, &pv, d->width);
+	return (PFRTAny) allocPrimArray(a->ftype, cnt + 1, d);
+}
+
+PFRTAny prim_extend_bang(PFRTAny s, PFRTAny v) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	PFRTPrimData 	d = a->data;
+	ft 				cnt = a->count;
+	PrimValue 		pv;
+	if(prim_value(a->ftype, v, &pv) == 0)
+		unknown_handler();
+	if(cnt >= d->capacity || FILL_CAS(&d->fill, cnt, cnt + 1) == 0) {
+		d = prim_copy(d, cnt, prim_grow(cnt));
+		d->fill = cnt + 1;
+		prim_setdata(a, d);
+	}
+	memcpy(PRIM_BYTES(d) + cnt * d->width, &pv, d->width);
+	a->count = cnt + 1;
+	a->hash = 0;
+	return s;
+}
+
+PFRTAny prim_update(PFRTAny s, PFRTAny index, PFRTAny v) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	ft 				i = prim_index(index);
+	if(i >= a->count)
+		unknown_handler();
+	PFRTPrimData 	d = prim_copy(a->data, a->count, a->count);
+	prim_put(a->ftype, d, i, v);
+	return (PFRTAny) allocPrimArray(a->ftype, a->count, d);
+}
+
+PFRTAny prim_update_bang(PFRTAny s, PFRTAny index, PFRTAny v) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	ft 				i = prim_index(index);
+	if(i >= a->count)
+		unknown_handler();
+	if(prim_owned(a->data) == 0)
+		prim_setdata(a, prim_copy(a->data, a->count, a->count));
+	prim_put(a->ftype, a->data, i, v);
+	a->hash = 0;
+	return s;
+}
+
+//	Kernels. Reductions the compiler can not reorder, float sums and
+//	byte lanes, use SSE2 where available and otherwise keep several
+//	accumulators. The rest are plain loops left to auto vectorization
+
+#ifdef PRIM_SSE2
+static ft lanes64(__m128i v) {
+	ft 	l[2];
+	_mm_storeu_si128((__m128i *) l, v);
+	return l[0] + l[1];
+}
+
+static double lanespd(__m128d v) {
+	double 	l[2];
+	_mm_storeu_pd(l, v);
+	return l[0] + l[1];
+}
+#endif
+
+static ft sum_bytes(const uint8_t *p, ft n) {
+	ft 	i = 0;
+	ft 	s = 0;
+#ifdef PRIM_SSE2
+	__m128i 	zero = _mm_setzero_si128();
+	__m128i 	acc = zero;
+	for(; i + 16 <= n; i += 16)
+		acc = _mm_add_epi64(acc,
+			_mm_sad_epu8(_mm_loadu_si128((const __m128i *) (p + i)), zero));
+	s = lanes64(acc);
+#endif
+	for(; i < n; i++)
+		s += p[i];
+	return s;
+}
+
+static double sum_floats(const double *p, ft n) {
+	ft 		i = 0;
+	double 	s = 0.0;
+#ifdef PRIM_SSE2
+	__m128d 	a0 = _mm_setzero_pd();
+	__m128d 	a1 = a0;
+	for(; i + 4 <= n; i += 4) {
+		a0 = _mm_add_pd(a0, _mm_loadu_pd(p + i));
+		a1 = _mm_add_pd(a1, _mm_loadu_pd(p + i + 2));
+	}
+	s = lanespd(_mm_add_pd(a0, a1));
+#else
+	double 	s1 = 0.0, s2 = 0.0, s3 = 0.0;
+	for(; i + 4 <= n; i += 4) {
+		s += p[i];
+		s1 += p[i + 1];
+		s2 += p[i + 2];
+		s3 += p[i + 3];
+	}
+	s += s1 + s2 + s3;
+#endif
+	for(; i < n; i++)
+		s += p[i];
+	return s;
+}
+
+static double dot_floats(const double *a, const double *b, ft n) {
+	ft 		i = 0;
+	double 	s = 0.0;
+#ifdef PRIM_SSE2
+	__m128d 	a0 = _mm_setzero_pd();
+	__m128d 	a1 = a0;
+	for(; i + 4 <= n; i += 4) {
+		a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		a1 = _mm_add_pd(a1,
+			_mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+	}
+	s = lanespd(_mm_add_pd(a0, a1));
+#else
+	double 	s1 = 0.0, s2 = 0.0, s3 = 0.0;
+	for(; i + 4 <= n; i += 4) {
+		s += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	s += s1 + s2 + s3;
+#endif
+	for(; i < n; i++)
+		s += a[i] * b[i];
+	return s;
+}
+
+static ft dot_bytes(const uint8_t *a, const uint8_t *b, ft n) {
+	ft 	i = 0;
+	ft 	s = 0;
+#ifdef PRIM_SSE2
+	__m128i 	zero = _mm_setzero_si128();
+	__m128i 	acc = zero;
+	for(; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+		__m128i m = _mm_add_epi32(
+			_mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero)),
+			_mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero)));
+		acc = _mm_add_epi64(acc, _mm_add_epi64(
+			_mm_unpacklo_epi32(m, zero), _mm_unpackhi_epi32(m, zero)));
+	}
+	s = lanes64(acc);
+#endif
+	for(; i < n; i++)
+		s += (ft) a[i] * b[i];
+	return s;
+}
+
+//	Exact int totals are kept as separate sums of the low and high 32
+//	bits of each term, neither overflows below 2^32 terms
+
+static PFRTAny exact_total(lt hi, ft lo) {
+	lt 	h = hi + (lt) (lo >> 32);
+	lt 	l = (lt) (lo & 0xffffffff);
+	if(h >= -0x80000000LL && h < 0x80000000LL)
+		return foidl_reg_intnum(h * 0x100000000LL + l);
+	return foidl_num_add(
+		foidl_num_mul(foidl_reg_intnum(h), foidl_reg_intnum(0x100000000LL)),
+		foidl_reg_intnum(l));
+}
+
+static PFRTAny sum_ints(const lt *p, ft n) {
+	ft 	lo = 0;
+	lt 	hi = 0;
+	for(ft i = 0; i < n; i++) {
+		lo += (uint32_t) p[i];
+		hi += p[i] >> 32;
+	}
+	return exact_total(hi, lo);
+}
+
+//	With all elements within 32 bits the products fit, otherwise
+//	the terms are summed as numbers
+
+static PFRTAny dot_ints(const lt *a, const lt *b, ft n) {
+	ft 	wide = 0;
+	for(ft i = 0; i < n; i++)
+		wide |= ((ft) a[i] + 0x80000000ULL) | ((ft) b[i] + 0x80000000ULL);
+	if((wide >> 32) == 0) {
+		ft 	lo = 0;
+		lt 	hi = 0;
+		for(ft i = 0; i < n; i++) {
+			lt 	p = a[i] * b[i];
+			lo += (uint32_t) p;
+			hi += p >> 32;
+		}
+		return exact_total(hi, lo);
+	}
+	PFRTAny 	s = foidl_reg_intnum(0);
+	for(ft i = 0; i < n; i++)
+		s = foidl_num_add(s,
+			foidl_num_mul(foidl_reg_intnum(a[i]), foidl_reg_intnum(b[i])));
+	return s;
+}
+
+static uint8_t minmax_bytes(const uint8_t *p, ft n, int max) {
+	ft 		i = 0;
+	uint8_t m = p[0];
+#ifdef PRIM_SSE2
+	if(n >= 16) {
+		uint8_t 	l[16];
+		__m128i 	acc = _mm_loadu_si128((const __m128i *) p);
+		for(i = 16; i + 16 <= n; i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *) (p + i));
+			acc = max ? _mm_max_epu8(acc, x) : _mm_min_epu8(acc, x);
+		}
+		_mm_storeu_si128((__m128i *) l, acc);
+		for(int j = 0; j < 16; j++)
+			m = max ? (l[j] > m ? l[j] : m) : (l[j] < m ? l[j] : m);
+	}
+#endif
+	for(; i < n; i++)
+		m = max ? (p[i] > m ? p[i] : m) : (p[i] < m ? p[i] : m);
+	return m;
+}
+
+static lt min_ints(const lt *p, ft n) {
+	lt 	m = p[0];
+	for(ft i = 1; i < n; i++)
+		m = p[i] < m ? p[i] : m;
+	return m;
+}
+
+static lt max_ints(const lt *p, ft n) {
+	lt 	m = p[0];
+	for(ft i = 1; i < n; i++)
+		m = p[i] > m ? p[i] : m;
+	return m;
+}
+
+static double minmax_floats(const double *p, ft n, int max) {
+	ft 		i = 1;
+	double 	m = p[0];
+#ifdef PRIM_SSE2
+	if(n >= 2) {
+		double 	l[2];
+		__m128d acc = _mm_loadu_pd(p);
+		for(i = 2; i + 2 <= n; i += 2) {
+			__m128d x = _mm_loadu_pd(p + i);
+			acc = max ? _mm_max_pd(acc, x) : _mm_min_pd(acc, x);
+		}
+		_mm_storeu_pd(l, acc);
+		m = max ? (l[1] > l[0] ? l[1] : l[0]) : (l[1] < l[0] ? l[1] : l[0]);
+	}
+#endif
+	for(; i < n; i++)
+		m = max ? (p[i] > m ? p[i] : m) : (p[i] < m ? p[i] : m);
+	return m;
+}
+
+//	Reductions
+
+PFRTAny prim_sum(PFRTAny s) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	uint8_t 		*p = PRIM_BYTES(a->data);
+	if(a->ftype == bytearray_type)
+		return foidl_reg_intnum(sum_bytes(p, a->count));
+	if(a->ftype == intarray_type)
+		return sum_ints((lt *) p, a->count);
+	return foidl_reg_floatnum(sum_floats((double *) p, a->count));
+}
+
+static PFRTAny prim_minmax(PFRTAny s, int max) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	uint8_t 		*p = PRIM_BYTES(a->data);
+	if(a->count == 0)
+		return nil;
+	if(a->ftype == bytearray_type)
+		return foidl_reg_intnum(minmax_bytes(p, a->count, max));
+	if(a->ftype == intarray_type)
+		return foidl_reg_intnum(max ? max_ints((lt *) p, a->count)
+			: min_ints((lt *) p, a->count));
+	return foidl_reg_floatnum(minmax_floats((double *) p, a->count, max));
+}
+
+PFRTAny prim_min(PFRTAny s) {
+	return prim_minmax(s, 0);
+}
+
+PFRTAny prim_max(PFRTAny s) {
+	return prim_minmax(s, 1);
+}
+
+PFRTAny prim_dot(PFRTAny lhs, PFRTAny rhs) {
+	PFRTPrimArray 	a = (PFRTPrimArray) lhs;
+	PFRTPrimArray 	b = (PFRTPrimArray) rhs;
+	if(is_prim(rhs) == 0 || a->ftype != b->ftype || a->count != b->count)
+		unknown_handler();
+	uint8_t 	*pa = PRIM_BYTES(a->data);
+	uint8_t 	*pb = PRIM_BYTES(b->data);
+	if(a->ftype == bytearray_type)
+		return foidl_reg_intnum(dot_bytes(pa, pb, a->count));
+	if(a->ftype == intarray_type)
+		return dot_ints((lt *) pa, (lt *) pb, a->count);
+	return foidl_reg_floatnum(dot_floats((double *) pa, (double *) pb, a->count));
+}
+
+//	Elementwise add and multiply of two arrays of one type and length,
+//	or of an array and a number applied to each element. Byte arrays
+//	widen to int arrays, int results that overflow fail
+
+static PFRTPrimArray prim_widen(PFRTPrimArray a) {
+	PFRTPrimArray 	r = prim_new(intarray_type, a->count);
+	uint8_t 		*p = PRIM_BYTES(a->data);
+	lt 				*q = (lt *) PRIM_BYTES(r->data);
+	for(ft i = 0; i < a->count; i++)
+		q[i] = p[i];
+	return r;
+}
+
+static void prim_dispose(PFRTPrimArray a) {
+	foidl_retain((PFRTAny) a);
+	foidl_unref((PFRTAny) a);
+}
+
+static void add_ints(lt *r, const lt *a, const lt *b, ft bs, ft n) {
+	lt 	ovf = 0;
+	if(bs) {
+		for(ft i = 0; i < n; i++) {
+			lt 	s = (lt) ((ft) a[i] + (ft) b[i]);
+			ovf |= (a[i] ^ s) & (b[i] ^ s);
+			r[i] = s;
+		}
+	}
+	else {
+		lt 	y = *b;
+		for(ft i = 0; i < n; i++) {
+			lt 	s = (lt) ((ft) a[i] + (ft) y);
+			ovf |= (a[i] ^ s) & (y ^ s);
+			r[i] = s;
+		}
+	}
+	if(ovf < 0)
+		unknown_handler();
+}
+
+static void mul_ints(lt *r, const lt *a, const lt *b, ft bs, ft n) {
+	for(ft i = 0; i < n; i++)
+		if(fix_mul(a[i], b[i * bs], &r[i]))
+			unknown_handler();
+}
+
+static void add_floats(double *r, const double *a, const double *b, ft bs, ft n) {
+	if(bs)
+		for(ft i = 0; i < n; i++)
+			r[i] = a[i] + b[i];
+	else {
+		double 	y = *b;
+		for(ft i = 0; i < n; i++)
+			r[i] = a[i] + y;
+	}
+}
+
+static void mul_floats(double *r, const double *a, const double *b, ft bs, ft n) {
+	if(bs)
+		for(ft i = 0; i < n; i++)
+			r[i] = a[i] * b[i];
+	else {
+		double 	y = *b;
+		for(ft i = 0; i < n; i++)
+			r[i] = a[i] * y;
+	}
+}
+
+static PFRTAny prim_elementwise(PFRTAny lhs, PFRTAny rhs, int mul) {
+	PFRTPrimArray 	a = (PFRTPrimArray) lhs;
+	PFRTPrimArray 	b = NULL;
+	PFRTPrimArray 	wa = NULL;
+	PFRTPrimArray 	wb = NULL;
+	PrimValue 		pv;
+	const uint8_t 	*pb;
+	ft 				bs = 1;
+	if(a->ftype == bytearray_type)
+		a = wa = prim_widen(a);
+	if(is_prim(rhs)) {
+		b = (PFRTPrimArray) rhs;
+		if(b->ftype == bytearray_type)
+			b = wb = prim_widen(b);
+		if(a->ftype != b->ftype || a->count != b->count)
+			unknown_handler();
+		pb = PRIM_BYTES(b->data);
+	}
+	else {
+		if(prim_value(a->ftype, rhs, &pv) == 0)
+			unknown_handler();
+		pb = (const uint8_t *) &pv;
+		bs = 0;
+	}
+	PFRTPrimArray 	r = prim_new(a->ftype, a->count);
+	uint8_t 		*pr = PRIM_BYTES(r->data);
+	uint8_t 		*pa = PRIM_BYTES(a->data);
+	if(a->ftype == intarray_type) {
+		if(mul)
+			mul_ints((lt *) pr, (lt *) pa, (const lt *) pb, bs, a->count);
+		else
+			add_ints((lt *) pr, (lt *) pa, (const lt *) pb, bs, a->count);
+	}
+	else if(mul)
+		mul_floats((double *) pr, (double *) pa, (const double *) pb, bs, a->count);
+	else
+		add_floats((double *) pr, (double *) pa, (const double *) pb, bs, a->count);
+	if(wa)
+		prim_dispose(wa);
+	if(wb)
+		prim_dispose(wb);
+	return (PFRTAny) r;
+}
+
+PFRTAny prim_elem_add(PFRTAny lhs, PFRTAny rhs) {
+	return prim_elementwise(lhs, rhs, 0);
+}
+
+PFRTAny prim_elem_mul(PFRTAny lhs, PFRTAny rhs) {
+	return prim_elementwise(lhs, rhs, 1);
+}
+
+//	Index of the first element equal to v, nil if none. Bytes use
+//	memchr which the C library vectorizes
+
+PFRTAny prim_index_of(PFRTAny s, PFRTAny v) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	uint8_t 		*p = PRIM_BYTES(a->data);
+	PrimValue 		pv;
+	if(prim_value(a->ftype, v, &pv) == 0)
+		return nil;
+	if(a->ftype == bytearray_type) {
+		uint8_t *f = memchr(p, pv.b, a->count);
+		return f ? foidl_reg_intnum(f - p) : nil;
+	}
+	if(a->ftype == intarray_type) {
+		lt 	*q = (lt *) p;
+		for(ft i = 0; i < a->count; i++)
+			if(q[i] == pv.i)
+				return foidl_reg_intnum(i);
+	}
+	else {
+		double 	*q = (double *) p;
+		for(ft i = 0; i < a->count; i++)
+			if(q[i] == pv.f)
+				return foidl_reg_intnum(i);
+	}
+	return nil;
+}
+
+//	Hash and equality are over the element bytes
+
+uint32_t prim_hash(PFRTAny s) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	if(a->hash == 0) {
+		uint32_t h = murmur3_32(PRIM_BYTES(a->data),
+			a->count * a->data->width, (uint32_t) a->ftype);
+		a->hash = h ? h : 1;
+	}
+	return a->hash;
+}
+
+PFRTAny prim_equal(PFRTAny lhs, PFRTAny rhs) {
+	PFRTPrimArray 	a = (PFRTPrimArray) lhs;
+	PFRTPrimArray 	b = (PFRTPrimArray) rhs;
+	if(a->ftype != b->ftype || a->count != b->count)
+		return false;
+	return memcmp(PRIM_BYTES(a->data), PRIM_BYTES(b->data),
+		a->count * a->data->width) == 0 ? true : false;
+}
+
+PFRTAny primiterator_next(PFRTPrim_Iterator i) {
+	if(i->index >= i->array->count)
+		return end;
+	return prim_box(i->array, i->index++);
+}
+
+PFRTAny write_prim(PFRTAny channel, PFRTAny s, channel_writer writer) {
+	PFRTPrimArray 	a = (PFRTPrimArray) s;
+	writer(channel,meta);
+	writer(channel,lbracket);
+	for(ft i = 0; i < a->count; i++) {
+		if(i > 0)
+			writer(channel,comma);
+		writer(channel,prim_box(a, i));
+	}
+	writer(channel,rbracket);
+	return nil;
+}
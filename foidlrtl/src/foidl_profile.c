@@ -0,0 +1,275 @@
+/*
+	foidl_profile.c
+	Library support for allocation profiling
+
+	Copyright Frank V. Castellucci
+	All Rights Reserved
+*/
+
+/*
+	The profiler is off unless FOIDL_PROFILE is set in the environment,
+	which also reports at exit, or it is started from foidl code with
+	profile_start!. When on, the object constructors record a count and
+	the bytes (structure plus owned buffer) keyed by the runtime type and
+	by the allocating function. Records are kept in a table per thread,
+	tables of ended threads are folded into a retired table and
+	profile_dump! merges them all.
+*/
+
+#define PROFILE_IMPL
+
+#include <foidlrt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL 	__declspec(thread)
+#else
+#define THREAD_LOCAL 	__thread
+#endif
+
+#define PROFILE_SLOTS 	512 		// Per thread (function, type) pairs
+
+typedef struct ProfileEntry {
+	const char 	*site;				// Allocating function
+	ft 			kind;				// ftype, or fclass for trie nodes
+	ft 			count;
+	ft 			bytes;
+} ProfileEntry;
+
+typedef struct ProfileTable {
+	ProfileEntry 	slots[PROFILE_SLOTS];
+	ft 				dropped;		// Records that found the table full
+	struct ProfileTable *next;
+} ProfileTable;
+
+typedef struct ProfileLabel {
+	ft 			kind;
+	const char 	*name;
+} ProfileLabel;
+
+static const ProfileLabel profile_labels[] = {
+	{profile_slots,			"slot array"},
+	{string_type,			"string_type"},
+	{keyword_type,			"keyword_type"},
+	{character_type,		"character_type"},
+	{byte_type,				"byte_type"},
+	{number_type,			"number_type"},
+	{regex_type,			"regex_type"},
+	{list2_type,			"list2_type"},
+	{vector2_type,			"vector2_type"},
+	{set2_type,				"set2_type"},
+	{map2_type,				"map2_type"},
+	{sortedmap_type,		"sortedmap_type"},
+	{sortedset_type,		"sortedset_type"},
+	{bytearray_type,		"bytearray_type"},
+	{intarray_type,			"intarray_type"},
+	{floatarray_type,		"floatarray_type"},
+	{mapentry_type,			"mapentry_type"},
+	{linknode_type,			"linknode_type"},
+	{series_type,			"series_type"},
+	{reduced_type,			"reduced_type"},
+	{hamptnode_class,		"hamptnode_class"},
+	{rrbnode_class,			"rrbnode_class"},
+	{bitmapnode_class,		"bitmapnode_class"},
+	{sortnode_class,		"sortnode_class"},
+	{primdata_class,		"primdata_class"},
+	{vector_iterator_type,	"vector_iterator_type"},
+	{map_iterator_type,		"map_iterator_type"},
+	{set_iterator_type,		"set_iterator_type"},
+	{list_iterator_type,	"list_iterator_type"},
+	{series_iterator_type,	"series_iterator_type"},
+	{channel_iterator_type,	"channel_iterator_type"},
+	{string_iterator_type,	"string_iterator_type"},
+	{sorted_iterator_type,	"sorted_iterator_type"},
+	{prim_iterator_type,	"prim_iterator_type"},
+	{funcinst_type,			"funcinst_type"},
+	{worker_type,			"worker_type"},
+	{thrdpool_type,			"thrdpool_type"},
+	{thread_type,			"thread_type"},
+	{file_type,				"file_type"}};
+
+#define PROFILE_LABELS (sizeof(profile_labels) / sizeof(ProfileLabel))
+
+ft 	foidl_profiling = 0;
+
+static ProfileTable 	*profile_tables = NULL;		// Live thread tables
+static ProfileTable 	profile_retired;			// Tables of ended threads
+static THREAD_LOCAL ProfileTable *profile_table = NULL;
+
+#ifdef _MSC_VER
+static SRWLOCK 			profile_lock = SRWLOCK_INIT;
+#define lock_profile()		AcquireSRWLockExclusive(&profile_lock)
+#define unlock_profile()	ReleaseSRWLockExclusive(&profile_lock)
+#else
+static pthread_mutex_t 	profile_lock = PTHREAD_MUTEX_INITIALIZER;
+#define lock_profile()		pthread_mutex_lock(&profile_lock)
+#define unlock_profile()	pthread_mutex_unlock(&profile_lock)
+#endif
+
+static const char *profile_label(ft kind) {
+	for(ft i = 0; i < PROFILE_LABELS; i++)
+		if(profile_labels[i].kind == kind)
+			return profile_labels[i].name;
+	return "other";
+}
+
+//	Finds or claims the entry for the pair, NULL when the table is full
+
+static ProfileEntry *profile_entry(ProfileTable *tab, const char *site, ft kind) {
+	ft 	h = (((ft) site >> 3) ^ kind) % PROFILE_SLOTS;
+	for(ft i = 0; i < PROFILE_SLOTS; i++) {
+		ProfileEntry *e = &tab->slots[(h + i) % PROFILE_SLOTS];
+		if(e->site == site && e->kind == kind)
+			return e;
+		if(e->site == NULL) {
+			e->site = site;
+			e->kind = kind;
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void profile_merge(ProfileTable *into, ProfileTable *from) {
+	for(ft i = 0; i < PROFILE_SLOTS; i++) {
+		ProfileEntry *s = &from->slots[i];
+		if(s->site == NULL)
+			continue;
+		ProfileEntry *e = profile_entry(into, s->site, s->kind);
+		if(e == NULL) {
+			into->dropped += s->count;
+			continue;
+		}
+		e->count += s->count;
+		e->bytes += s->bytes;
+	}
+	into->dropped += from->dropped;
+}
+
+void foidl_profile_record(const char *site, ft kind, ft bytes) {
+	ProfileTable *tab = profile_table;
+	if(tab == NULL) {
+		tab = calloc(1, sizeof(ProfileTable));
+		if(tab == NULL)
+			unknown_handler();
+		lock_profile();
+		tab->next = profile_tables;
+		profile_tables = tab;
+		unlock_profile();
+		profile_table = tab;
+	}
+	ProfileEntry *e = profile_entry(tab, site, kind);
+	if(e == NULL) {
+		++tab->dropped;
+		return;
+	}
+	++e->count;
+	e->bytes += bytes;
+}
+
+//	Called as a runtime thread ends
+
+void foidl_profile_thread_release() {
+	ProfileTable *tab = profile_table;
+	if(tab == NULL)
+		return;
+	lock_profile();
+	ProfileTable **link = &profile_tables;
+	while(*link != tab)
+		link = &(*link)->next;
+	*link = tab->next;
+	profile_merge(&profile_retired, tab);
+	unlock_profile();
+	profile_table = NULL;
+	free(tab);
+}
+
+//	Report rows are (name, count, bytes) sorted by bytes
+
+typedef struct ProfileRow {
+	const char 	*name;
+	ft 			count;
+	ft 			bytes;
+} ProfileRow;
+
+static int row_order(const void *a, const void *b) {
+	ft ab = ((const ProfileRow *) a)->bytes;
+	ft bb = ((const ProfileRow *) b)->bytes;
+	return ab < bb ? 1 : ab > bb ? -1 : 0;
+}
+
+static ft row_add(ProfileRow *rows, ft cnt, const char *name, ProfileEntry *e) {
+	for(ft i = 0; i < cnt; i++)
+		if(rows[i].name == name) {
+			rows[i].count += e->count;
+			rows[i].bytes += e->bytes;
+			return cnt;
+		}
+	rows[cnt].name = name;
+	rows[cnt].count = e->count;
+	rows[cnt].bytes = e->bytes;
+	return cnt + 1;
+}
+
+static void row_print(ProfileRow *rows, ft cnt) {
+	qsort(rows, cnt, sizeof(ProfileRow), row_order);
+	for(ft i = 0; i < cnt; i++)
+		printf("%-24s %12llu %14llu\n", rows[i].name, rows[i].count,
+			rows[i].bytes);
+}
+
+void foidl_profile_report() {
+	ProfileTable 	*all = calloc(1, sizeof(ProfileTable));
+	ProfileRow 		*types = calloc(PROFILE_SLOTS, sizeof(ProfileRow));
+	ProfileRow 		*sites = calloc(PROFILE_SLOTS, sizeof(ProfileRow));
+	ft 				tcnt = 0, scnt = 0;
+	if(all == NULL || types == NULL || sites == NULL)
+		unknown_handler();
+	lock_profile();
+	profile_merge(all, &profile_retired);
+	for(ProfileTable *tab = profile_tables; tab; tab = tab->next)
+		profile_merge(all, tab);
+	unlock_profile();
+	for(ft i = 0; i < PROFILE_SLOTS; i++) {
+		ProfileEntry *e = &all->slots[i];
+		if(e->site == NULL)
+			continue;
+		tcnt = row_add(types, tcnt, profile_label(e->kind), e);
+		scnt = row_add(sites, scnt, e->site, e);
+	}
+	printf("--------------- Type ----------------------\n");
+	printf("%-24s %12s %14s\n", "type", "count", "bytes");
+	row_print(types, tcnt);
+	printf("--------------- Function ------------------\n");
+	printf("%-24s %12s %14s\n", "function", "count", "bytes");
+	row_print(sites, scnt);
+	if(all->dropped)
+		printf("Unrecorded allocations %llu\n", all->dropped);
+	printf("-------------------------------------------\n");
+	free(sites);
+	free(types);
+	free(all);
+}
+
+void foidl_profile_init() {
+	if(getenv("FOIDL_PROFILE") != NULL && foidl_profiling == 0) {
+		foidl_profiling = 1;
+		atexit(foidl_profile_report);
+	}
+}
+
+PFRTAny foidl_profile_start_bang() {
+	foidl_profiling = 1;
+	return nil;
+}
+
+PFRTAny foidl_profile_stop_bang() {
+	foidl_profiling = 0;
+	return nil;
+}
+
+PFRTAny foidl_profile_dump_bang() {
+	foidl_profile_report();
+	return nil;
+}
@@ -0,0 +1,316 @@
+/*
+	foidl_refcount.c
+	Library support for reference counting
+
+	Copyright Frank V. Castellucci
+	All Rights Reserved
+*/
+
+/*
+	Counts live in MEMSIG.refs of the hidden object signature and
+	record how many collection slots (headers, HAMT/CHAMP nodes, link
+	nodes) refer to an object. Increments happen at the structural
+	sharing points of vector, map, set and list. Decrements are deferred
+	onto a per thread stack and applied in batches so that persistent
+	updates pay for a push and not for the cascade.
+
+	Internal nodes are reclaimed when their count drops to zero. Values
+	(scalars and collections) are only reclaimed after they have been
+	released (foidl_release) and no collection refers to them anymore.
+	Map entries and series count their fields, function instances their
+	args vector. Locals are not counted, releasing a value asserts the
+	caller holds the last local reference to it.
+	Globals and arena blocks are never counted and a saturated count
+	is sticky. Iterators count what they walk until they are exhausted
+	or released (iteratorRelease).
+
+	The compiler does not emit releases for dead locals or superseded
+	bindings, it can not tell when a value escapes. Values that are
+	never released are left to the collector (foidl_gc.c), release!
+	only makes reclaiming them eager.
+*/
+
+#define REFCOUNT_IMPL
+
+#include <foidlrt.h>
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL 	__declspec(thread)
+#define REF_CAS(p,o,n)	((ft) InterlockedCompareExchange64((LONG64 *)(p),(LONG64)(n),(LONG64)(o)))
+#else
+#define THREAD_LOCAL 	__thread
+#define REF_CAS(p,o,n)	__sync_val_compare_and_swap((p),(o),(n))
+#endif
+
+#define REF_BATCH 	256 		// Pending decrements before a flush
+#define REF_KINDS 	0x7 		// Pointer tag bits of a pending entry
+#define REF_ANY 	0x0
+#define REF_SETNODE	0x1 		// CHAMP node with TUPLELENSFT payload
+#define REF_MAPNODE	0x2 		// CHAMP node with TUPLELEN payload
+
+typedef struct RefPending {
+	ft 		count;
+	ft 		size;
+	ft 		*items;
+} RefPending;
+
+static THREAD_LOCAL RefPending pending = {0, 0, NULL};
+static THREAD_LOCAL ft flushing = 0;
+
+//	Only runtime heap objects carry a count
+
+static PFRTTypeG counted(PFRTAny s) {
+	if(s == NULL || s == (PFRTAny) empty_node)
+		return NULL;
+	PFRTTypeG g = ANYTOG(s);
+	return SIGOF(g) == alloc_signature ? g : NULL;
+}
+
+static int isnode(PFRTAny s) {
+	return s->fclass == hamptnode_class || s->fclass == rrbnode_class
+		|| s->fclass == bitmapnode_class || s->fclass == sortnode_class
+		|| s->fclass == primdata_class
+		|| s->ftype == linknode_type;
+}
+
+//	Atomically adjust the count, returns the signature before the change
+
+static ft ref_adjust(PFRTTypeG g, lt delta, ft orphan) {
+	ft old = g->fsig;
+	for(;;) {
+		ft cnt = old & ref_mask;
+		ft nsig = old | orphan;
+		if(cnt == ref_mask)
+			;	// Saturated, leave it be
+		else if(delta > 0)
+			nsig += ref_one;
+		else if(delta < 0 && cnt != 0)
+			nsig -= ref_one;
+		ft seen = REF_CAS(&g->fsig, old, nsig);
+		if(seen == old)
+			return old;
+		old = seen;
+	}
+}
+
+//	Flag bits share the word with the count, they are changed the same way
+
+void foidl_sig_flags(PFRTAny s, ft set, ft clear) {
+	PFRTTypeG 	g = ANYTOG(s);
+	ft 			old = g->fsig;
+	for(;;) {
+		ft seen = REF_CAS(&g->fsig, old, (old | set) & ~clear);
+		if(seen == old)
+			return;
+		old = seen;
+	}
+}
+
+//	Only the change that drops the last reference of a node, or of a
+//	released value, reclaims it
+
+static int dropped_last(PFRTAny s, ft old) {
+	return (old & ref_mask) == ref_one && (isnode(s) || (old & ref_orphan) != 0);
+}
+
+static void push_pending(PFRTAny s, ft kind) {
+	if(pending.count == pending.size) {
+		ft 	nsize = pending.size ? pending.size * 2 : REF_BATCH * 2;
+		ft 	*items = (ft *) realloc(pending.items, nsize * sizeof(ft));
+		if(items == NULL)
+			unknown_handler();
+		pending.items = items;
+		pending.size = nsize;
+	}
+	pending.items[pending.count++] = ((ft) s) | kind;
+}
+
+//	Free an object whose count reached zero, queueing what it refers to
+
+static void ref_free(PFRTAny s, ft kind) {
+	if(s->fclass == hamptnode_class || s->fclass == rrbnode_class) {
+		PFRTHamtNode n = (PFRTHamtNode) s;
+		for(ft i = 0; i < WCNT; i++)
+			if(counted(n->slots[i]) != NULL)
+				push_pending(n->slots[i], REF_ANY);
+		foidl_xdel(n);
+	}
+	else if(s->fclass == bitmapnode_class) {
+		PFRTBitmapNode n = (PFRTBitmapNode) s;
+		ft 	tlen = kind == REF_SETNODE ? TUPLELENSFT : TUPLELEN;
+		ft 	plen = bit_count(n->datamap) * tlen;
+		ft 	slen = plen + bit_count(n->nodemap);
+		for(ft i = 0; i < slen; i++)
+			push_pending(n->slots[i], i < plen ? REF_ANY : kind);
+		if(n->slots != (PFRTAny *) emtndarray)
+			foidl_xdel(n->slots);
+		foidl_xdel(n);
+	}
+	else if(s->fclass == sortnode_class) {
+		PFRTSortNode n = (PFRTSortNode) s;
+		for(ft i = 0; i < n->count; i++) {
+			push_pending(n->keys[i], REF_ANY);
+			if(n->slots[i] != end)
+				push_pending(n->slots[i], REF_ANY);
+		}
+		foidl_xdel(n);
+	}
+	else if(s->fclass == primdata_class) {
+		foidl_xdel(s);
+	}
+	else if(s->fclass == scalar_class) {
+		switch(s->ftype) {
+			case 	string_type:
+			case 	keyword_type:
+				release_string(s);
+				break;
+			case 	number_type:
+				release_number(s);
+				break;
+			default:
+				break;		// Characters, regex, etc. are left alone
+		}
+	}
+	else if(s->fclass == collection_class) {
+		switch(s->ftype) {
+			case 	list2_type:
+				push_pending((PFRTAny) ((PFRTList) s)->root, REF_ANY);
+				if(((PFRTList) s)->skips != NULL)
+					foidl_xdel(((PFRTList) s)->skips);
+				foidl_xdel(s);
+				break;
+			case 	vector2_type:
+				push_pending((PFRTAny) ((PFRTVector) s)->root, REF_ANY);
+				push_pending((PFRTAny) ((PFRTVector) s)->tail, REF_ANY);
+				foidl_xdel(s);
+				break;
+			case 	set2_type:
+				push_pending((PFRTAny) ((PFRTSet) s)->root, REF_SETNODE);
+				foidl_xdel(s);
+				break;
+			case 	map2_type:
+				push_pending((PFRTAny) ((PFRTMap) s)->root, REF_MAPNODE);
+				foidl_xdel(s);
+				break;
+			case 	sortedmap_type:
+			case 	sortedset_type:
+				push_pending((PFRTAny) ((PFRTSorted) s)->root, REF_ANY);
+				foidl_xdel(s);
+				break;
+			case 	bytearray_type:
+			case 	intarray_type:
+			case 	floatarray_type:
+				push_pending((PFRTAny) ((PFRTPrimArray) s)->data, REF_ANY);
+				foidl_xdel(s);
+				break;
+			case 	linknode_type:
+				push_pending(((PFRTLinkNode) s)->data, REF_ANY);
+				push_pending((PFRTAny) ((PFRTLinkNode) s)->next, REF_ANY);
+				foidl_xdel(s);
+				break;
+			case 	mapentry_type:
+				push_pending(((PFRTMapEntry) s)->key, REF_ANY);
+				push_pending(((PFRTMapEntry) s)->value, REF_ANY);
+				foidl_xdel(s);
+				break;
+			case 	series_type:
+				push_pending(((PFRTSeries) s)->start, REF_ANY);
+				push_pending(((PFRTSeries) s)->stop, REF_ANY);
+				push_pending(((PFRTSeries) s)->step, REF_ANY);
+				foidl_xdel(s);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+//	Apply pending decrements, including the ones produced by reclaiming
+
+void foidl_ref_flush() {
+	if(flushing)
+		return;
+	flushing = 1;
+	while(pending.count > 0) {
+		ft 			item = pending.items[--pending.count];
+		PFRTAny 	s = (PFRTAny) (item & ~((ft) REF_KINDS));
+		PFRTTypeG 	g = counted(s);
+		if(g == NULL)
+			continue;
+		if(dropped_last(s, ref_adjust(g, -1, 0)))
+			ref_free(s, item & REF_KINDS);
+	}
+	flushing = 0;
+}
+
+//	Called as a thread ends
+
+void foidl_ref_thread_release() {
+	foidl_ref_flush();
+	free(pending.items);
+	pending.items = NULL;
+	pending.count = pending.size = 0;
+}
+
+//	The calling threads pending decrements, the collector treats
+//	them as roots
+
+ft foidl_ref_pending(ft **items) {
+	*items = pending.items;
+	return pending.count;
+}
+
+//	Increment, returns the argument so stores can be wrapped
+
+PFRTAny foidl_retain(PFRTAny s) {
+	PFRTTypeG 	g = counted(s);
+	if(g != NULL)
+		ref_adjust(g, 1, 0);
+	return s;
+}
+
+//	Deferred decrements
+
+void foidl_unref(PFRTAny s) {
+	if(counted(s) == NULL)
+		return;
+	push_pending(s, REF_ANY);
+	if(pending.count >= REF_BATCH)
+		foidl_ref_flush();
+}
+
+void foidl_unref_node(PFRTBitmapNode n, ft tuplelen) {
+	if(counted((PFRTAny) n) == NULL)
+		return;
+	push_pending((PFRTAny) n, tuplelen == TUPLELENSFT ? REF_SETNODE : REF_MAPNODE);
+	if(pending.count >= REF_BATCH)
+		foidl_ref_flush();
+}
+
+//	Give up the callers claim on a runtime temporary, it is reclaimed
+//	as soon as no collection refers to it
+
+PFRTAny foidl_release_temp(PFRTAny s) {
+	PFRTTypeG 	g = counted(s);
+	if(g != NULL && isnode(s) == 0) {
+		ft 	old = ref_adjust(g, 0, ref_orphan);
+		if((old & (ref_mask | ref_orphan)) == 0)
+			ref_free(s, REF_ANY);
+		foidl_ref_flush();
+	}
+	return nil;
+}
+
+//	Give up the callers claim on a value. Globals do not count what
+//	they hold, a value bound to one stays with the collector
+
+PFRTAny foidl_release(PFRTAny s) {
+	if(counted(s) == NULL || foidl_gc_rooted(s))
+		return nil;
+	return foidl_release_temp(s);
+}
+
+PFRTAny foidl_release_type(PFRTAny s) {
+	return foidl_release(s);
+}
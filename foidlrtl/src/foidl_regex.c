@@ -31,7 +31,7 @@ PFRTAny	foidl_regex(PFRTAny s) {
 		return allocRegex(s,_string_to_regex(s->value));
 	}
 	else {
-		printf("Skipped for pattern processing 0x%08llx\n",s->ftype);
+		printf("Skipped for pattern processing 0x%08x\n",s->ftype);
 	}
 	return nil;
 }
@@ -43,7 +43,7 @@ PFRTAny 	foidl_split(PFRTAny s, PFRTAny pattern) {
 
 	PFRTAny rlist = foidl_list_inst_bang();
 	PFRTRegEx rex = (PFRTRegEx) pattern;
-	_string_split(rlist, s->value, rex->regex);
+	_string_split(rlist, s, rex->regex);
 	return rlist;
 }
 
@@ -99,7 +99,7 @@ static void gen_block(PFRTAny patterns,PFRTAny ignores, token_block *block) {
 			block->type_array[count] = (char *) ttype->value;
 			count++;
 		}
-		foidl_xdel(li);
+		iteratorRelease(li);
 	}
 	else {
 		block->pattern_cnt = 0;
@@ -114,7 +114,7 @@ static void gen_block(PFRTAny patterns,PFRTAny ignores, token_block *block) {
 			block->ig_regex_array[count] = tregex->regex;
 			count++;
 		}
-		foidl_xdel(li);
+		iteratorRelease(li);
 	}
 	else {
 		block->ignore_cnt = 0;
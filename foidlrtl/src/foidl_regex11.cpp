@@ -11,6 +11,7 @@
 #include <sstream>
 #include <regex>
 #include <list>
+#include <vector>
 
 using namespace std;
 
@@ -37,7 +38,7 @@ const char *astring = ":string";
 // Build a token object for later processing
 
 ptoken _build_token(string &word, int ti, int lc, int sp ) {
-    ptoken _tok = (ptoken) foidl_xall(sizeof(token));
+    ptoken _tok = (ptoken) foidl_xall_root(sizeof(token));
     _tok->type_index = ti;
     _tok->colno = sp;
     _tok->lineno = lc;
@@ -71,15 +72,37 @@ EXTERNC void* _string_to_regex(const char* s) {
 }
 
 // Split a string
-EXTERNC void _string_split(void *rlist, const char *strng, void* pattern) {
-    string base(strng);
+// The pieces are slices of one copy of the string with the first
+// character of each separator overwritten by a NUL. Pieces that are
+// directly followed by another (empty separator matches) are copied
+EXTERNC void _string_split(void *rlist, PFRTAny s, void* pattern) {
+    const char *base = (const char *) s->value;
     regex* rpattern = static_cast<regex*>(pattern);
-    sregex_token_iterator it(base.begin(), base.end(), *rpattern, -1);
-    sregex_token_iterator reg_end;
-    for (; it != reg_end; ++it) {
-        string hs = it->str();
-        list_extend_bang(rlist, allocStringWithCopy((char *) hs.c_str()));
+    cregex_token_iterator it(base, base + s->count, *rpattern, -1);
+    cregex_token_iterator reg_end;
+    vector<pair<uint32_t, uint32_t>> pieces;
+    for (; it != reg_end; ++it)
+        pieces.push_back(make_pair((uint32_t) (it->first - base),
+            (uint32_t) it->length()));
+    if(pieces.empty())
+        return;
+    PFRTAny copy = allocStringShared(s->count);
+    char    *v = (char *) copy->value;
+    memcpy(v, base, s->count);
+    v[s->count] = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        uint32_t eol = pieces[i].first + pieces[i].second;
+        if(pieces[i].second > 0 &&
+            (i + 1 == pieces.size() || pieces[i + 1].first > eol)) {
+            v[eol] = 0;
+            list_extend_bang(rlist,
+                allocStringSlice(copy, v + pieces[i].first, pieces[i].second));
+        }
+        else
+            list_extend_bang(rlist,
+                allocStringWithCopyCnt(pieces[i].second, v + pieces[i].first));
     }
+    foidl_release_temp(copy);
 }
 
 // String stream reduction to tokens
@@ -225,7 +248,7 @@ static void _ttstr(ostringstream &ost, PFRTAny e) {
     switch(e->ftype) {
         case    string_type:
         case    keyword_type:
-            ost << (char *)e->value;
+            ost.write((char *)e->value, e->count);
             break;
         case nil_type:
             ost << (char *)nilstr->value;
@@ -251,6 +274,9 @@ static void _ttstr(ostringstream &ost, PFRTAny e) {
             }
             break;
         case vector2_type:
+        case bytearray_type:
+        case intarray_type:
+        case floatarray_type:
             {
                 ost << "#[";
                 _single_coll(ost, e);
@@ -258,6 +284,7 @@ static void _ttstr(ostringstream &ost, PFRTAny e) {
             }
             break;
         case map2_type:
+        case sortedmap_type:
             {
                 ost << "{";
                 _assoc_coll(ost, e);
@@ -265,6 +292,7 @@ static void _ttstr(ostringstream &ost, PFRTAny e) {
             }
             break;
         case set2_type:
+        case sortedset_type:
             {
                 ost << "#{";
                 _single_coll(ost, e);
@@ -301,7 +329,7 @@ EXTERNC PFRTAny foidl_format(PFRTAny s, PFRTAny coll) {
         // Imbue base string 's' with converted
         // objects
 
-        string base((char *) s->value);
+        string base((char *) s->value, s->count);
         string result;
         smatch m;
         int pos=0;
@@ -328,27 +356,25 @@ EXTERNC PFRTAny foidl_format(PFRTAny s, PFRTAny coll) {
 
 const char* whts = " \t\n\r\f\v";
 
-// trim from end of string (right)
-inline string& rtrim(string& s, const char* t = whts) {
-    s.erase(s.find_last_not_of(t) + 1);
-    return s;
-}
-
-// trim from beginning of string (left)
-inline string& ltrim(string& s, const char* t = whts) {
-    s.erase(0, s.find_first_not_of(t));
-    return s;
-}
-
-// trim from both ends of string (right then left)
-inline string& trim(string& s, const char* t = whts) {
-    return ltrim(rtrim(s, t), t);
+static inline bool is_whts(char c) {
+    return c != 0 && strchr(whts, c) != NULL;
 }
 
+// Trims whitespace from both ends. Without trailing whitespace the
+// result is a suffix and shares the characters of s
 EXTERNC PFRTAny foidl_trim(PFRTAny s) {
     if(s->ftype != string_type)
         unknown_handler();
-    string content((char *)s->value);
-    string result = trim(content);
-    return allocStringWithCopy((char *) result.c_str());
+    char        *v = (char *) s->value;
+    uint32_t    lo = 0;
+    uint32_t    hi = s->count;
+    while(lo < hi && is_whts(v[lo]))
+        ++lo;
+    while(hi > lo && is_whts(v[hi - 1]))
+        --hi;
+    if(lo == hi)
+        return allocStringWithCopyCnt(0, v);
+    if(hi == s->count)
+        return allocStringSlice(s, v + lo, hi - lo);
+    return allocStringWithCopyCnt(hi - lo, v + lo);
 }
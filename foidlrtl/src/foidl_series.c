@@ -108,5 +108,8 @@ PFRTAny 	foidl_series(PFRTAny start, PFRTAny stop, PFRTAny step) {
 	else
 		unknown_handler();
 
+	foidl_retain(result->start);
+	foidl_retain(result->stop);
+	foidl_retain(result->step);
 	return (PFRTAny) result;
 }
\ No newline at end of file
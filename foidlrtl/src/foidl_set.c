@@ -9,6 +9,7 @@
 #define  SET_IMPL
 #include <foidlrt.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 //	Global things
 
@@ -51,7 +52,7 @@ static PFRTAny *entryToNode(PFRTAny *src,uint32_t olen,uint32_t idx, uint32_t id
 	arraycopy(src,dst,idx);
 	//debugArray("New array 1",dst,newlen);
 	arraycopy(&src[idx + TUPLELENSFT],&dst[idx],idxNew - idx);
-	dst[idxNew] = node;
+	dst[idxNew] = foidl_retain(node);
 	//debugArray("New array 2",dst,newlen);
 	arraycopy(&src[idxNew+TUPLELENSFT],&dst[idxNew+TUPLELENSFT],olen - idxNew - TUPLELENSFT);
 	return dst;
@@ -64,7 +65,7 @@ static PFRTAny *insertK(PFRTAny *src,uint32_t olen,uint32_t idx,
 		arraycopy(src,dst,idx);
 		arraycopy(&src[idx],&dst[idx+TUPLELENSFT],olen-idx);
 	}
-	dst[idx+KEYPOS] = k;
+	dst[idx+KEYPOS] = foidl_retain(k);
 	return dst;
 }
 
@@ -73,7 +74,7 @@ static PFRTAny  *nodeToEntry(PFRTAny *src,uint32_t oldlen,uint32_t idxOld,uint32
 
  	PFRTAny  *dst = allocRawAnyArray(oldlen - TUPLELENSFT + TUPLELENSFT);
  	arraycopy(src,dst,idxNew);
- 	dst[idxNew+KEYPOS] = k;
+ 	dst[idxNew+KEYPOS] = foidl_retain(k);
     arraycopy(&src[idxNew],&dst[idxNew+1],idxOld - idxNew);
 	arraycopy(&src[idxOld+1],&dst[idxOld+1],oldlen - idxOld - 1);
 	return dst;
@@ -107,18 +108,18 @@ static PFRTBitmapNode mergeTwoKeyValPairs(PFRTAny cKey,  PFRTAny key,  ft shift)
 		//printf("	Simple shot\n");
 		node = allocNodeWith(bit_pos(mask0) | bit_pos(mask1),0,2);
 		if(mask0 < mask1) {
-			node->slots[0] = cKey;
-			node->slots[1] = key;
+			node->slots[0] = foidl_retain(cKey);
+			node->slots[1] = foidl_retain(key);
 		}
 		else {
-			node->slots[0] = key;
-			node->slots[1] = cKey;
+			node->slots[0] = foidl_retain(key);
+			node->slots[1] = foidl_retain(cKey);
 		}
 	}
 	else {
 		//printf("	Recursive shot\n");
 		node = allocNodeWith(0,bit_pos(mask0),1);
-		node->slots[0] = (PFRTAny) mergeTwoKeyValPairs(cKey,key,shift+SHIFT);
+		node->slots[0] = foidl_retain((PFRTAny) mergeTwoKeyValPairs(cKey,key,shift+SHIFT));
 	}
 	return node;
 }
@@ -155,7 +156,7 @@ static PFRTBitmapNode copyAndSetNode (PFRTBitmapNode src,
 	ft slen =set_nodelength(src);
 	uint32_t idx = slen - 1 - nodeIndex(src->nodemap,bitpos);
 	PFRTBitmapNode dst = allocNodeClone(src,slen);
-	dst->slots[idx+0] = (PFRTAny) node;
+	arrayset(dst->slots,idx,(PFRTAny) node,TUPLELENSFT);
 	return dst;
 }
 
@@ -171,7 +172,7 @@ static PFRTBitmapNode copyAndSetNode_m (PFRTBitmapNode src,
 
 	ft slen =set_nodelength(src);
 	uint32_t idx = slen - 1 - nodeIndex(src->nodemap,bitpos);
-	src->slots[idx] = (PFRTAny) node;
+	arrayset(src->slots,idx,(PFRTAny) node,TUPLELENSFT);
 	return src;
 }
 //	Return node copy with inserted new K/V pair
@@ -183,7 +184,7 @@ static PFRTBitmapNode copyAndInsertValue (PFRTBitmapNode src,uint32_t bitpos,
 	return allocNodeWithAll(src->datamap | bitpos,
 		src->nodemap,
 		insertK(src->slots,
-			nodelength(src),
+			set_nodelength(src),
 			TUPLELENSFT * dataIndex(src->datamap,bitpos),
 			bitpos,
 			key));
@@ -202,9 +203,10 @@ static PFRTBitmapNode copyAndInsertValue_m (PFRTBitmapNode src,uint32_t bitpos,
 	PFRTAny key) {
 	//printf("	Insert/Adjust value %s at index %u of node 0x%08llX\n",(char *)key->value,idx,(ft) src);
 	PFRTAny *old = src->slots;
+	uint32_t oldlen = set_nodelength(src);
 	//printf("Old node length = %u \n",set_nodelength(src));
 	src->slots = insertK(old,
-		set_nodelength(src),
+		oldlen,
 		TUPLELENSFT * dataIndex(src->datamap,bitpos),
 		bitpos,
 		key);
@@ -212,8 +214,7 @@ static PFRTBitmapNode copyAndInsertValue_m (PFRTBitmapNode src,uint32_t bitpos,
 	src->datamap = src->datamap | bitpos;
 	//printf("New node length = %u \n",set_nodelength(src));
 
-	if(old != emtndarray)
-		foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELENSFT);
 	return src;
 }
 
@@ -229,7 +230,7 @@ static PFRTBitmapNode migrateFromEntryToNode_m(PFRTBitmapNode o, uint32_t bitpos
 	o->nodemap = o->nodemap | bitpos;
 	PFRTAny *old = o->slots;
 	o->slots   = entryToNode(old,oldlen,idxOld, idxNew, (PFRTAny) node);
-	foidl_xdel(old);
+	arrayrelease(old,oldlen,TUPLELENSFT);
 
 	return o;
 }
@@ -340,7 +341,7 @@ PFRTAny set_remove(PFRTAny s, PFRTAny k) {
 
 
 static PFRTBitmapNode set_extend_bang_i(PFRTBitmapNode node, PSetNodeResult details,
-	ft shift,uint32_t keyHash, PFRTAny key) {
+	ft shift,uint32_t keyHash, PFRTAny key, uint32_t edit) {
 	uint32_t 		keyMask = mask(keyHash,shift);
 	uint32_t 		bitpos = bit_pos(keyMask);
 	PFRTBitmapNode 	newNode = node;
@@ -358,17 +359,21 @@ static PFRTBitmapNode set_extend_bang_i(PFRTBitmapNode node, PSetNodeResult deta
 			details->isModified = true;
 			++details->deltaSize;
 			details->deltaHashCode += keyHash;
-			newNode = migrateFromEntryToNode_m(node,bitpos,
-						mergeTwoKeyValPairs(currentKey,key,shift + SHIFT));
+			PFRTBitmapNode merged = mergeTwoKeyValPairs(currentKey,key,shift + SHIFT);
+			merged->edit = edit;
+			newNode = migrateFromEntryToNode_m(
+						editableNode(node,edit,set_nodelength(node)),bitpos,merged);
 		}
 
 	}
 	else if((node->nodemap & bitpos) != 0) {
 		//printf("	nodemap hit\n");
 		PFRTBitmapNode subNode = set_getNode(node,nodeIndex(node->nodemap,bitpos));
-		PFRTBitmapNode subNewNode = set_extend_bang_i(subNode,details,shift + SHIFT,keyHash,key);
-		if(details->isModified == true) {
-			newNode = copyAndSetNode_m(node,bitpos,subNewNode);
+		PFRTBitmapNode subNewNode = set_extend_bang_i(subNode,details,shift + SHIFT,
+			keyHash,key,edit);
+		if(details->isModified == true && subNewNode != subNode) {
+			newNode = copyAndSetNode_m(editableNode(node,edit,set_nodelength(node)),
+				bitpos,subNewNode);
 		}
 
 	}
@@ -376,15 +381,61 @@ static PFRTBitmapNode set_extend_bang_i(PFRTBitmapNode node, PSetNodeResult deta
 		details->isModified = true;
 		++details->deltaSize;
 		details->deltaHashCode += keyHash;
-		newNode = copyAndInsertValue_m(node,bitpos,key);
+		newNode = copyAndInsertValue_m(editableNode(node,edit,set_nodelength(node)),
+			bitpos,key);
 	}
 	return newNode;
 }
 
+//	Replace the root of a set being changed in place
+
+static void set_setroot(PFRTSet set, PFRTBitmapNode root) {
+	if(root != set->root) {
+		PFRTBitmapNode old = set->root;
+		set->root = (PFRTBitmapNode) foidl_retain((PFRTAny) root);
+		foidl_unref_node(old, TUPLELENSFT);
+	}
+}
+
 PFRTAny 	foidl_set_inst_bang() {
 	return (PFRTAny) allocSet(0,SHIFT,allocNode());
 }
 
+//	Transient over src, shares src's nodes until it changes them
+
+PFRTAny 	set_transient_bang(PFRTAny s) {
+	PFRTSet 	src = (PFRTSet) s;
+	PFRTSet 	res;
+	if(src->count == 0)
+		res = (PFRTSet) foidl_set_inst_bang();
+	else {
+		res = allocSet(src->count, src->shift, src->root);
+		res->hash = src->hash;
+	}
+	res->edit = foidl_edit_token();
+	return (PFRTAny) res;
+}
+
+//	Bulk construction, the trie is built bottom up in one pass
+
+PFRTAny 	set_from_iterator(PFRTIterator itr) {
+	PChampEntry es = NULL;
+	ft 			cnt = 0, cap = 0;
+	uint32_t 	h = 0;
+	PFRTSet 	res;
+	PFRTAny 	k;
+	while((k = iteratorNext(itr)) != end)
+		es = champ_entry_add(es, &cnt, &cap, k, nil);
+	res = allocSet(0, SHIFT, champ_from_entries(es, &cnt, TUPLELENSFT));
+	for(ft i = 0; i < cnt; i++)
+		h += es[i].hash;
+	res->count = cnt;
+	res->hash = h;
+	if(es != NULL)
+		foidl_xdel(es);
+	return (PFRTAny) res;
+}
+
 PFRTAny 	foidl_set_extend_bang(PFRTAny s, PFRTAny k) {
 	struct SetNodeResult 	details = {end,false,false,0,0};
 	uint32_t keyhash = hash(k);
@@ -394,7 +445,8 @@ PFRTAny 	foidl_set_extend_bang(PFRTAny s, PFRTAny k) {
 
 	//printf("Adding element %c to set with hash 0x%4X\n",(char) (ft) k->value, keyhash);
 
-	set_extend_bang_i(set->root,&details,0,keyhash,k);
+	set_setroot(set,
+		set_extend_bang_i(set->root,&details,0,keyhash,k,(uint32_t) set->edit));
 	PFRTSet 				newSet = set;
 
 	if(details.isModified == true) {
@@ -478,7 +530,7 @@ PFRTAny	set_first(PFRTAny set) {
 	PFRTAny	result = nil;
 	PFRTIterator si = iteratorFor(set);
 	result = iteratorNext(si);
-	foidl_xdel(si);
+	iteratorRelease(si);
 	result = (result == end) ? nil : result;
 	return result;
 }
@@ -490,29 +542,74 @@ PFRTAny	set_second(PFRTAny set) {
 	if(result != end) {
 		result = iteratorNext(si);
 	}
-	foidl_xdel(si);
+	iteratorRelease(si);
 	result = (result == end) ? nil : result;
 	return result;
 }
 
+//	All but the first member, a removal along one path so the rest of
+//	the trie is shared
+
 PFRTAny set_rest(PFRTAny src) {
 	PFRTAny result = (PFRTAny) empty_set;
-	if(src->count > 1) {
-		PFRTAny 		itm = nil;
-		PFRTAny 		s1 = foidl_set_inst_bang();
-		PFRTIterator	si = iteratorFor(src);
-		result = s1;
-		iteratorNext(si);
-		while((itm = iteratorNext(si)) != end)
-			foidl_set_extend_bang(s1,itm);
-		foidl_xdel(si);
-		uint32_t s1hsh = hash(set_first(src));
-		s1->hash = src->hash - s1hsh;
-		s1->count = src->count - 1;
-	}
+	if(src->count > 1)
+		result = set_remove(src, set_first(src));
 	return result;
 }
 
+//	Set algebra, both tries are walked together so subtrees only one
+//	side has are shared rather than re-inserted
+
+PFRTAny set_union(PFRTAny s1, PFRTAny s2) {
+	PFRTSet 			a = (PFRTSet) s1;
+	PFRTSet 			b = (PFRTSet) s2;
+	struct ChampJoin 	j = {nil,NULL,0,0};
+	if(b->count == 0)
+		return s1;
+	if(a->count == 0)
+		return s2;
+	PFRTBitmapNode 		root = champ_merge(a->root,b->root,TUPLELENSFT,&j);
+	if(root == a->root)
+		return s1;
+	if(root == b->root)
+		return s2;
+	PFRTSet 			res = allocSet(a->count + j.count,SHIFT,root);
+	res->hash = a->hash + j.hash;
+	return (PFRTAny) res;
+}
+
+PFRTAny set_intersect(PFRTAny s1, PFRTAny s2) {
+	PFRTSet 			a = (PFRTSet) s1;
+	PFRTSet 			b = (PFRTSet) s2;
+	struct ChampJoin 	j = {nil,NULL,0,0};
+	if(a->count == 0 || b->count == 0)
+		return (PFRTAny) empty_set;
+	PFRTBitmapNode 		root = champ_filter(a->root,b->root,TUPLELENSFT,1,&j);
+	if(root == NULL)
+		return (PFRTAny) empty_set;
+	if(root == a->root)
+		return s1;
+	PFRTSet 			res = allocSet(a->count - j.count,SHIFT,root);
+	res->hash = a->hash - j.hash;
+	return (PFRTAny) res;
+}
+
+PFRTAny set_difference(PFRTAny s1, PFRTAny s2) {
+	PFRTSet 			a = (PFRTSet) s1;
+	PFRTSet 			b = (PFRTSet) s2;
+	struct ChampJoin 	j = {nil,NULL,0,0};
+	if(a->count == 0 || b->count == 0)
+		return s1;
+	PFRTBitmapNode 		root = champ_filter(a->root,b->root,TUPLELENSFT,0,&j);
+	if(root == NULL)
+		return (PFRTAny) empty_set;
+	if(root == a->root)
+		return s1;
+	PFRTSet 			res = allocSet(j.count,SHIFT,root);
+	res->hash = j.hash;
+	return (PFRTAny) res;
+}
+
 PFRTAny write_set(PFRTAny channel, PFRTAny set, channel_writer writer) {
 	PFRTIterator mi = iteratorFor(set);
 	PFRTAny entry;
@@ -526,17 +623,27 @@ PFRTAny write_set(PFRTAny channel, PFRTAny set, channel_writer writer) {
 			writer(channel,entry);
 			if(mcount > count++) writer(channel,comma);
 		}
-		foidl_xdel(mi);
 	}
+	iteratorRelease(mi);
 	writer(channel,rbrace);
 	return nil;
 }
 
+//	Builds in one pass from any collection's elements
+
 PFRTAny coerce_to_set(PFRTAny stemplate, PFRTAny src) {
-	unknown_handler();
-	return src;
+	PFRTAny 		res;
+	PFRTIterator 	itr;
+	if(src->ftype == set2_type)
+		return src;
+	if(foidl_collection_qmark(src) != true)
+		unknown_handler();
+	itr = iteratorFor(src);
+	res = set_from_iterator(itr);
+	iteratorRelease(itr);
+	return res;
 }
 
 void  release_set(PFRTAny s) {
-	unknown_handler();
+	foidl_release(s);
 }
@@ -0,0 +1,602 @@
+/*
+	foidl_sorted.c
+	Library support for sorted map and set (B+ tree)
+
+	Copyright Frank V. Castellucci
+	All Rights Reserved
+*/
+
+#define  SORTED_IMPL
+#include <foidlrt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SORT_WIDTH 	32 		//	Entries per node
+#define SORT_MIN 	8 		//	Below this a node joins a neighbour
+
+//	Edit details passed back up the path
+
+typedef struct SortEdit {
+	PFRTSortNode 	right; 		//	Split off sibling, NULL if none
+	int 			changed;
+} SortEdit;
+
+//	Bulk construction entry, seq orders duplicates
+
+typedef struct SortEntry {
+	PFRTAny 	key;
+	PFRTAny 	value;
+	ft 			seq;
+} SortEntry, *PSortEntry;
+
+//	Keys order by value within one scalar type
+
+static int key_compare(PFRTAny a, PFRTAny b) {
+	if(a->fclass != scalar_class || b->fclass != scalar_class
+		|| a->ftype != b->ftype)
+		unknown_handler();
+	switch(a->ftype) {
+		case 	number_type:
+			if(a->count == number_fixnum && b->count == number_fixnum)
+				return (lt) a->value < (lt) b->value ? -1 :
+					(lt) a->value > (lt) b->value;
+			if(foidl_num_lt(a, b) == true)
+				return -1;
+			return foidl_num_equal(a, b) == true ? 0 : 1;
+		case 	string_type:
+		case 	keyword_type:
+			{
+				ft 	n = a->count < b->count ? a->count : b->count;
+				int c = memcmp(a->value, b->value, n);
+				if(c != 0)
+					return c;
+				return a->count < b->count ? -1 : a->count > b->count;
+			}
+		case 	character_type:
+			return a->value < b->value ? -1 : a->value > b->value;
+		default:
+			unknown_handler();
+	}
+	return 0;
+}
+
+static int is_map(PFRTAny s) {
+	return s->ftype == sortedmap_type;
+}
+
+static uint32_t entry_hash(int map, PFRTAny k, PFRTAny v) {
+	return map ? hash(k) ^ hash(v) : hash(k);
+}
+
+//	Index of the first key not less than k
+
+static uint32_t sort_lower(PFRTSortNode n, PFRTAny k, int *hit) {
+	uint32_t 	lo = 0, hi = n->count;
+	while(lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if(key_compare(n->keys[mid], k) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*hit = lo < n->count && key_compare(n->keys[lo], k) == 0;
+	return lo;
+}
+
+//	Child of an inner node that would hold k
+
+static uint32_t sort_route(PFRTSortNode n, PFRTAny k) {
+	int 		hit;
+	uint32_t 	i = sort_lower(n, k, &hit);
+	return hit || i == 0 ? i : i - 1;
+}
+
+//	A fresh node over the entries, retaining each
+
+static PFRTSortNode sort_fill(uint32_t leaf, int map, PFRTAny *keys,
+	PFRTAny *slots, uint32_t cnt) {
+	PFRTSortNode 	n = allocSortNode(leaf);
+	for(uint32_t i = 0; i < cnt; i++) {
+		n->keys[i] = foidl_retain(keys[i]);
+		n->slots[i] = leaf && map == 0 ? end : foidl_retain(slots[i]);
+		if(leaf) {
+			n->hash += entry_hash(map, keys[i], slots[i]);
+			++n->size;
+		}
+		else {
+			n->hash += ((PFRTSortNode) slots[i])->hash;
+			n->size += ((PFRTSortNode) slots[i])->size;
+		}
+	}
+	n->count = cnt;
+	return n;
+}
+
+//	Reclaims a fresh node that was not used
+
+static void sort_dispose(PFRTSortNode n) {
+	foidl_retain((PFRTAny) n);
+	foidl_unref((PFRTAny) n);
+}
+
+//	Copy of n with del entries at at replaced by ins entries. Returns
+//	the left half and sets right when the result had to be split
+
+static PFRTSortNode sort_splice(PFRTSortNode n, int map, uint32_t at,
+	uint32_t del, PFRTAny *keys, PFRTAny *slots, uint32_t ins,
+	PFRTSortNode *right) {
+	PFRTAny 	k[SORT_WIDTH + 2], s[SORT_WIDTH + 2];
+	uint32_t 	c = 0;
+	for(uint32_t i = 0; i < at; i++, c++) {
+		k[c] = n->keys[i];
+		s[c] = n->slots[i];
+	}
+	for(uint32_t i = 0; i < ins; i++, c++) {
+		k[c] = keys[i];
+		s[c] = slots[i];
+	}
+	for(uint32_t i = at + del; i < n->count; i++, c++) {
+		k[c] = n->keys[i];
+		s[c] = n->slots[i];
+	}
+	uint32_t 	lc = c > SORT_WIDTH ? c / 2 : c;
+	*right = lc < c ? sort_fill(n->leaf, map, &k[lc], &s[lc], c - lc) : NULL;
+	return sort_fill(n->leaf, map, k, s, lc);
+}
+
+//	Replaces child i of n with l and, if set, r
+
+static PFRTSortNode sort_replace(PFRTSortNode n, int map, uint32_t i,
+	PFRTSortNode l, PFRTSortNode r, SortEdit *e) {
+	PFRTAny 	k[2] = {l->keys[0], r ? r->keys[0] : end};
+	PFRTAny 	s[2] = {(PFRTAny) l, (PFRTAny) r};
+	return sort_splice(n, map, i, 1, k, s, r ? 2 : 1, &e->right);
+}
+
+static PFRTSortNode sort_insert(PFRTSortNode n, int map, PFRTAny k,
+	PFRTAny v, SortEdit *e) {
+	int 		hit;
+	if(n->leaf) {
+		uint32_t 	i = sort_lower(n, k, &hit);
+		if(hit && (map == 0 || n->slots[i] == v))
+			return n;
+		e->changed = 1;
+		if(hit)
+			return sort_splice(n, map, i, 1, &n->keys[i], &v, 1, &e->right);
+		return sort_splice(n, map, i, 0, &k, &v, 1, &e->right);
+	}
+	uint32_t 		i = sort_route(n, k);
+	SortEdit 		ce = {NULL, 0};
+	PFRTSortNode 	c = sort_insert((PFRTSortNode) n->slots[i], map, k, v, &ce);
+	if(ce.changed == 0)
+		return n;
+	e->changed = 1;
+	return sort_replace(n, map, i, c, ce.right, e);
+}
+
+static PFRTSortNode sort_delete(PFRTSortNode n, int map, PFRTAny k,
+	SortEdit *e) {
+	int 			hit;
+	PFRTSortNode 	r;
+	if(n->leaf) {
+		uint32_t 	i = sort_lower(n, k, &hit);
+		if(hit == 0)
+			return n;
+		e->changed = 1;
+		return sort_splice(n, map, i, 1, NULL, NULL, 0, &r);
+	}
+	uint32_t 		i = sort_route(n, k);
+	SortEdit 		ce = {NULL, 0};
+	PFRTSortNode 	c = sort_delete((PFRTSortNode) n->slots[i], map, k, &ce);
+	if(ce.changed == 0)
+		return n;
+	e->changed = 1;
+	if(c->count == 0) {
+		sort_dispose(c);
+		return sort_splice(n, map, i, 1, NULL, NULL, 0, &r);
+	}
+	if(c->count >= SORT_MIN || n->count < 2)
+		return sort_replace(n, map, i, c, NULL, e);
+
+	//	Joins the small child with a neighbour, or shares their
+	//	entries out evenly when both will not fit in one
+
+	uint32_t 		at = i > 0 ? i - 1 : i;
+	PFRTSortNode 	a = at == i ? c : (PFRTSortNode) n->slots[at];
+	PFRTSortNode 	b = at == i ? (PFRTSortNode) n->slots[i + 1] : c;
+	PFRTAny 		jk[SORT_WIDTH * 2], js[SORT_WIDTH * 2];
+	uint32_t 		jc = 0;
+	for(uint32_t x = 0; x < a->count; x++, jc++) {
+		jk[jc] = a->keys[x];
+		js[jc] = a->slots[x];
+	}
+	for(uint32_t x = 0; x < b->count; x++, jc++) {
+		jk[jc] = b->keys[x];
+		js[jc] = b->slots[x];
+	}
+	uint32_t 		lc = jc > SORT_WIDTH ? jc / 2 : jc;
+	PFRTSortNode 	l = sort_fill(c->leaf, map, jk, js, lc);
+	PFRTSortNode 	rn = lc < jc ?
+		sort_fill(c->leaf, map, &jk[lc], &js[lc], jc - lc) : NULL;
+	PFRTAny 		k2[2] = {l->keys[0], rn ? rn->keys[0] : end};
+	PFRTAny 		s2[2] = {(PFRTAny) l, (PFRTAny) rn};
+	sort_dispose(c);
+	return sort_splice(n, map, at, 2, k2, s2, rn ? 2 : 1, &r);
+}
+
+//	Wraps a root in a new collection, single child roots give way
+//	to their child
+
+static PFRTAny sort_wrap(ft ftype, PFRTSortNode root) {
+	PFRTSortNode 	top = root;
+	while(root->leaf == 0 && root->count < 2)
+		root = root->count ? (PFRTSortNode) root->slots[0] : allocSortNode(1);
+	PFRTSorted 		res = allocSorted(ftype, root);
+	res->count = root->size;
+	res->hash = root->hash;
+	if(top != root)
+		sort_dispose(top);
+	return (PFRTAny) res;
+}
+
+static PFRTAny sort_root_edit(PFRTAny coll, PFRTSortNode root, SortEdit *e) {
+	if(e->changed == 0)
+		return coll;
+	if(e->right != NULL) {
+		PFRTAny 	k[2] = {root->keys[0], e->right->keys[0]};
+		PFRTAny 	s[2] = {(PFRTAny) root, (PFRTAny) e->right};
+		root = sort_fill(0, 0, k, s, 2);
+	}
+	return sort_wrap(coll->ftype, root);
+}
+
+//	Bang variants move the new tree into coll
+
+static PFRTAny sort_take(PFRTAny coll, PFRTAny res) {
+	if(res == coll)
+		return coll;
+	PFRTSorted 		dst = (PFRTSorted) coll;
+	PFRTSorted 		src = (PFRTSorted) res;
+	PFRTSortNode 	old = dst->root;
+	dst->root = src->root;
+	dst->count = src->count;
+	dst->hash = src->hash;
+	foidl_xdel(src);
+	foidl_unref((PFRTAny) old);
+	return coll;
+}
+
+//	Entries in key order, for duplicates the last one wins
+
+static int entry_order(const void *x, const void *y) {
+	PSortEntry 	a = (PSortEntry) x;
+	PSortEntry 	b = (PSortEntry) y;
+	int 		c = key_compare(a->key, b->key);
+	if(c != 0)
+		return c;
+	return a->seq < b->seq ? -1 : a->seq > b->seq;
+}
+
+//	Packs cnt entries into evenly filled nodes, returns the node count
+
+static uint32_t sort_pack(uint32_t leaf, int map, PFRTAny *keys,
+	PFRTAny *slots, ft cnt, PFRTSortNode *out) {
+	ft 	nodes = (cnt + SORT_WIDTH - 1) / SORT_WIDTH;
+	ft 	at = 0;
+	for(ft i = 0; i < nodes; i++) {
+		ft 	take = (cnt - at) / (nodes - i);
+		out[i] = sort_fill(leaf, map, &keys[at], &slots[at], take);
+		at += take;
+	}
+	return nodes;
+}
+
+PFRTAny sorted_from_iterator(ft ftype, PFRTIterator itr) {
+	int 		map = ftype == sortedmap_type;
+	PSortEntry 	es = NULL;
+	ft 			cnt = 0, cap = 0;
+	PFRTAny 	p;
+	while((p = iteratorNext(itr)) != end) {
+		if(cnt == cap) {
+			cap = cap ? cap * 2 : SORT_WIDTH;
+			es = (PSortEntry) (es == NULL ? foidl_xall(cap * sizeof(SortEntry))
+				: foidl_xreall(es, cap * sizeof(SortEntry)));
+		}
+		es[cnt].seq = cnt;
+		if(map == 0) {
+			es[cnt].key = p;
+			es[cnt].value = end;
+		}
+		else if(p->ftype == mapentry_type) {
+			es[cnt].key = ((PFRTMapEntry) p)->key;
+			es[cnt].value = ((PFRTMapEntry) p)->value;
+		}
+		else if(p->fclass == collection_class && p->count == 2) {
+			es[cnt].key = foidl_first(p);
+			es[cnt].value = foidl_second(p);
+		}
+		else
+			unknown_handler();
+		key_compare(es[cnt].key, es[cnt].key); 	//	Rejects unordered keys
+		++cnt;
+	}
+	if(cnt > 1)
+		qsort(es, cnt, sizeof(SortEntry), entry_order);
+
+	PFRTAny 	*keys = allocRawAnyArray(cnt ? cnt : 1);
+	PFRTAny 	*slots = allocRawAnyArray(cnt ? cnt : 1);
+	ft 			uniq = 0;
+	for(ft i = 0; i < cnt; i++) {
+		if(i + 1 < cnt && key_compare(es[i].key, es[i + 1].key) == 0)
+			continue;
+		keys[uniq] = es[i].key;
+		slots[uniq++] = es[i].value;
+	}
+	if(es != NULL)
+		foidl_xdel(es);
+
+	ft 				width = (uniq + SORT_WIDTH - 1) / SORT_WIDTH;
+	PFRTSortNode 	*level = (PFRTSortNode *) allocRawAnyArray(width ? width : 1);
+	ft 				n = sort_pack(1, map, keys, slots, uniq, level);
+	while(n > 1) {
+		for(ft i = 0; i < n; i++) {
+			keys[i] = level[i]->keys[0];
+			slots[i] = (PFRTAny) level[i];
+		}
+		n = sort_pack(0, map, keys, slots, n, level);
+	}
+	PFRTAny 		res = sort_wrap(ftype, n ? level[0] : allocSortNode(1));
+	foidl_xdel(keys);
+	foidl_xdel(slots);
+	foidl_xdel(level);
+	return res;
+}
+
+//	Lookup
+
+static PFRTSortNode sort_find(PFRTSortNode n, PFRTAny k, uint32_t *at) {
+	int 	hit;
+	while(n->leaf == 0)
+		n = (PFRTSortNode) n->slots[sort_route(n, k)];
+	*at = sort_lower(n, k, &hit);
+	return hit ? n : NULL;
+}
+
+static PFRTAny sort_result(int map, PFRTSortNode n, uint32_t i) {
+	if(map)
+		return (PFRTAny) allocMapEntryWith(n->keys[i], n->slots[i]);
+	return n->keys[i];
+}
+
+PFRTAny sorted_get_default(PFRTAny coll, PFRTAny k, PFRTAny def) {
+	uint32_t 		i;
+	PFRTSortNode 	n = sort_find(((PFRTSorted) coll)->root, k, &i);
+	if(n == NULL)
+		return def;
+	return is_map(coll) ? n->slots[i] : n->keys[i];
+}
+
+PFRTAny sorted_get(PFRTAny coll, PFRTAny k) {
+	return sorted_get_default(coll, k, nil);
+}
+
+//	Persistent edits
+
+PFRTAny sorted_extend(PFRTAny coll, PFRTAny k) {
+	SortEdit 		e = {NULL, 0};
+	PFRTSortNode 	root;
+	if(is_map(coll))
+		unknown_handler();
+	root = sort_insert(((PFRTSorted) coll)->root, 0, k, end, &e);
+	return sort_root_edit(coll, root, &e);
+}
+
+PFRTAny sorted_assoc(PFRTAny coll, PFRTAny k, PFRTAny v) {
+	SortEdit 		e = {NULL, 0};
+	PFRTSortNode 	root;
+	if(is_map(coll) == 0)
+		unknown_handler();
+	root = sort_insert(((PFRTSorted) coll)->root, 1, k, v, &e);
+	return sort_root_edit(coll, root, &e);
+}
+
+PFRTAny sorted_remove(PFRTAny coll, PFRTAny k) {
+	SortEdit 		e = {NULL, 0};
+	PFRTSortNode 	root;
+	root = sort_delete(((PFRTSorted) coll)->root, is_map(coll), k, &e);
+	return sort_root_edit(coll, root, &e);
+}
+
+PFRTAny sorted_extend_bang(PFRTAny coll, PFRTAny k) {
+	return sort_take(coll, sorted_extend(coll, k));
+}
+
+PFRTAny sorted_assoc_bang(PFRTAny coll, PFRTAny k, PFRTAny v) {
+	return sort_take(coll, sorted_assoc(coll, k, v));
+}
+
+//	Ends, values for maps as with map first
+
+static PFRTSortNode sort_edge(PFRTSortNode n, int last) {
+	while(n->leaf == 0)
+		n = (PFRTSortNode) n->slots[last ? n->count - 1 : 0];
+	return n;
+}
+
+static PFRTAny sort_element(PFRTAny coll, PFRTSortNode n, uint32_t i) {
+	return is_map(coll) ? n->slots[i] : n->keys[i];
+}
+
+PFRTAny sorted_first(PFRTAny coll) {
+	if(coll->count == 0)
+		return nil;
+	return sort_element(coll, sort_edge(((PFRTSorted) coll)->root, 0), 0);
+}
+
+PFRTAny sorted_second(PFRTAny coll) {
+	PFRTAny 		res = nil;
+	if(coll->count < 2)
+		return res;
+	PFRTIterator 	itr = iteratorFor(coll);
+	iteratorNext(itr);
+	res = iteratorNext(itr);
+	if(is_map(coll)) {
+		PFRTAny 	e = res;
+		res = ((PFRTMapEntry) e)->value;
+		foidl_release_temp(e);
+	}
+	iteratorRelease(itr);
+	return res;
+}
+
+PFRTAny sorted_last(PFRTAny coll) {
+	if(coll->count == 0)
+		return nil;
+	PFRTSortNode 	n = sort_edge(((PFRTSorted) coll)->root, 1);
+	return sort_element(coll, n, n->count - 1);
+}
+
+PFRTAny sorted_rest(PFRTAny coll) {
+	return sorted_remove(coll, sort_edge(((PFRTSorted) coll)->root, 0)->keys[0]);
+}
+
+//	Greatest key not above k, a map entry for maps, nil if none
+
+PFRTAny sorted_floor(PFRTAny coll, PFRTAny k) {
+	PFRTSortNode 	n = ((PFRTSorted) coll)->root;
+	int 			hit;
+	while(n->leaf == 0)
+		n = (PFRTSortNode) n->slots[sort_route(n, k)];
+	uint32_t 		i = sort_lower(n, k, &hit);
+	if(hit == 0) {
+		if(i == 0)
+			return nil;
+		--i;
+	}
+	return sort_result(is_map(coll), n, i);
+}
+
+//	Least key not below k, past the end of its leaf that is the
+//	first key of the nearest subtree to the right on the path
+
+PFRTAny sorted_ceiling(PFRTAny coll, PFRTAny k) {
+	PFRTSortNode 	n = ((PFRTSorted) coll)->root;
+	PFRTSortNode 	next = NULL;
+	int 			hit;
+	while(n->leaf == 0) {
+		uint32_t 	i = sort_route(n, k);
+		if(i + 1 < n->count)
+			next = (PFRTSortNode) n->slots[i + 1];
+		n = (PFRTSortNode) n->slots[i];
+	}
+	uint32_t 		i = sort_lower(n, k, &hit);
+	if(i == n->count) {
+		if(next == NULL)
+			return nil;
+		n = sort_edge(next, 0);
+		i = 0;
+	}
+	return sort_result(is_map(coll), n, i);
+}
+
+//	Keys from lo up to but not including hi, nil leaves an end open.
+//	Subtrees wholly in the range are shared, only the nodes along the
+//	two boundary paths are copied
+
+static PFRTSortNode sort_trim(PFRTSortNode n, int map, PFRTAny lo, PFRTAny hi) {
+	int 		hit;
+	uint32_t 	b = hi != nil ? sort_lower(n, hi, &hit) : n->count;
+	if(n->leaf) {
+		uint32_t 	a = lo != nil ? sort_lower(n, lo, &hit) : 0;
+		if(a == 0 && b == n->count)
+			return n;
+		return sort_fill(1, map, &n->keys[a], &n->slots[a], b > a ? b - a : 0);
+	}
+
+	//	Children a up to b may hold keys in range
+
+	uint32_t 	a = lo != nil ? sort_route(n, lo) : 0;
+	if(b <= a)
+		return sort_fill(0, map, NULL, NULL, 0);
+	PFRTAny 		k[SORT_WIDTH], s[SORT_WIDTH];
+	PFRTSortNode 	fresh[2] = {NULL, NULL};
+	uint32_t 		c = 0;
+	int 			same = a == 0 && b == n->count;
+	for(uint32_t i = a; i < b; i++) {
+		PFRTSortNode 	child = (PFRTSortNode) n->slots[i];
+		PFRTSortNode 	t = child;
+		if(i == a || i == b - 1)
+			t = sort_trim(child, map, i == a ? lo : nil, i == b - 1 ? hi : nil);
+		if(t != child) {
+			same = 0;
+			fresh[i == a ? 0 : 1] = t;
+		}
+		if(t->count == 0)
+			continue;
+		k[c] = t->keys[0];
+		s[c++] = (PFRTAny) t;
+	}
+	if(same)
+		return n;
+	PFRTSortNode 	res = sort_fill(0, map, k, s, c);
+	for(int x = 0; x < 2; x++)
+		if(fresh[x] != NULL)
+			sort_dispose(fresh[x]);
+	return res;
+}
+
+PFRTAny sorted_subrange(PFRTAny coll, PFRTAny lo, PFRTAny hi) {
+	PFRTSortNode 	root = ((PFRTSorted) coll)->root;
+	if(lo != nil && hi != nil && key_compare(lo, hi) > 0)
+		hi = lo;
+	PFRTSortNode 	t = sort_trim(root, is_map(coll), lo, hi);
+	if(t == root)
+		return coll;
+	return sort_wrap(coll->ftype, t);
+}
+
+//	In order iteration, a stack of the path to the current leaf
+
+static int sort_advance(PFRTSorted_Iterator si) {
+	int 	leaf = si->depth;
+	int 	d = leaf - 1;
+	while(d >= 0 && si->index[d] + 1 >= si->nodes[d]->count)
+		--d;
+	if(d < 0) {
+		si->depth = -1;
+		return 0;
+	}
+	++si->index[d];
+	for(int l = d + 1; l <= leaf; l++) {
+		si->nodes[l] = (PFRTSortNode) si->nodes[l - 1]->slots[si->index[l - 1]];
+		si->index[l] = 0;
+	}
+	return 1;
+}
+
+static PFRTSortNode sort_current(PFRTSorted_Iterator si) {
+	while(si->depth >= 0 && si->index[si->depth] >= si->nodes[si->depth]->count)
+		if(sort_advance(si) == 0)
+			return NULL;
+	return si->depth >= 0 ? si->nodes[si->depth] : NULL;
+}
+
+PFRTAny sortediterator_next(PFRTSorted_Iterator si) {
+	PFRTSortNode 	n = sort_current(si);
+	if(n == NULL)
+		return end;
+	return sort_result(is_map((PFRTAny) si->sorted), n, si->index[si->depth]++);
+}
+
+//	Hands out the rest of the current leaf's keys
+
+ft sortediterator_chunk(PFRTSorted_Iterator si, PFRTAny **elems) {
+	PFRTSortNode 	n = sort_current(si);
+	if(n == NULL)
+		return 0;
+	uint32_t 		i = si->index[si->depth];
+	*elems = &n->keys[i];
+	si->index[si->depth] = n->count;
+	return n->count - i;
+}
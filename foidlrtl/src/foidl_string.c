@@ -11,19 +11,166 @@
 #include <string.h>
 #include <stdio.h>
 
+#ifdef _MSC_VER
+#define KW_CAS(p,o,n) 		(InterlockedCompareExchangePointer((PVOID *)(p),(n),(o)) == (o))
+#define KW_ADD(p) 			((ft) InterlockedIncrement64((LONG64 *)(p)))
+static SRWLOCK 			retired_lock = SRWLOCK_INIT;
+#else
+#define KW_CAS(p,o,n) 		__sync_bool_compare_and_swap((p),(o),(n))
+#define KW_ADD(p) 			__sync_add_and_fetch((p),1)
+static pthread_mutex_t 	retired_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 #ifdef _MSC_VER
 #endif // _MSC_VER
 
 static PFRTAny strMap;
-static PFRTAny kwMap;
-
-// TODO: Separate strings from keywords
 
 typedef PFRTAny (*_regskalloc)(char*);
 
 void foildl_rtl_init_strings() {
+	foidl_gc_register_root(&strMap);
 	strMap = foidl_map_inst_bang();
-	kwMap = foidl_map_inst_bang();
+}
+
+/*
+	Keyword intern table
+
+	Chained hash table whose buckets are pushed with a CAS so pool
+	threads may intern without a lock. Nodes and keywords are never
+	removed. A keyword gets its hash when it is interned, equal
+	keywords being the same object equality is a pointer compare
+
+	When the chains average KW_LOAD nodes the table doubles. One thread
+	wins the table's next pointer and moves the nodes over, freezing
+	each bucket by tagging its head so a push there fails. A thread
+	that misses on a frozen bucket waits for the new table to be
+	published and looks again. Readers may still be walking a replaced
+	table, so its buckets are never freed
+*/
+
+#define KW_BUCKETS 	4096
+#define KW_LOAD 	2
+#define KW_FROZEN(n) 	((ft) (n) & 1)
+#define KW_HEAD(n) 		((KwNode *) ((ft) (n) & ~(ft) 1))
+
+typedef struct KwNode {
+	struct KwNode 	*next;
+	PFRTAny 		kw;
+} KwNode;
+
+typedef struct KwTable {
+	KwNode * volatile 		*buckets;
+	ft 						mask;
+	volatile ft 			count;
+	struct KwTable * volatile next;
+} KwTable;
+
+static KwNode * volatile kw_first[KW_BUCKETS];
+static KwTable 	kw_initial = {kw_first, KW_BUCKETS - 1, 0, NULL};
+static KwTable * volatile kw_table = &kw_initial;
+
+//	Moves every node of t into a table twice its size and publishes it
+
+static void kw_grow(KwTable *t) {
+	ft 		size = (t->mask + 1) * 2;
+	KwTable *nt = foidl_xall_root(sizeof(KwTable) + size * sizeof(KwNode *));
+	nt->buckets = (KwNode * volatile *) (nt + 1);
+	nt->mask = size - 1;
+	nt->count = 0;
+	nt->next = NULL;
+	memset((void *) nt->buckets, 0, size * sizeof(KwNode *));
+	if(!KW_CAS(&t->next, NULL, nt)) {
+		foidl_xdel(nt);
+		return;
+	}
+	for(ft i = 0; i <= t->mask; i++) {
+		KwNode 	*head;
+		do
+			head = t->buckets[i];
+		while(!KW_CAS(&t->buckets[i], head, (KwNode *) ((ft) head | 1)));
+		for(KwNode *n = head, *next; n != NULL; n = next) {
+			KwNode * volatile *slot = &nt->buckets[n->kw->hash & nt->mask];
+			next = n->next;
+			n->next = *slot;
+			*slot = n;
+			++nt->count;
+		}
+	}
+	KW_CAS(&kw_table, t, nt);
+}
+
+//	Returns the keyword spelled by the cnt characters at p. When there
+//	is none, kw (or a new keyword if kw is NULL) is added
+
+static PFRTAny kw_intern(char *p, uint32_t cnt, PFRTAny kw) {
+	struct FRTTypeG probe = {0,scalar_class,keyword_type,cnt,0,p};
+	uint32_t 	h = hash((PFRTAny) &probe.fclass);
+	KwNode 		*node = NULL;
+	for(;;) {
+		KwTable *t = kw_table;
+		KwNode * volatile *slot = &t->buckets[h & t->mask];
+		KwNode 	*head = *slot;
+		for(KwNode *n = KW_HEAD(head); n != NULL; n = n->next)
+			if(n->kw->hash == h && n->kw->count == cnt
+				&& memcmp(n->kw->value, p, cnt) == 0) {
+				if(node != NULL) {
+					if(node->kw != kw)
+						releaseGlobalKeywordCopy(node->kw);
+					foidl_xdel(node);
+				}
+				return n->kw;
+			}
+		if(KW_FROZEN(head)) {
+			while(kw_table == t)
+				;
+			continue;
+		}
+		if(node == NULL) {
+			node = foidl_xall_root(sizeof(KwNode));
+			node->kw = kw != NULL ? kw : allocGlobalKeywordCopy(p, cnt);
+			node->kw->hash = h;
+		}
+		node->next = head;
+		if(KW_CAS(slot, head, node)) {
+			if(KW_ADD(&t->count) > KW_LOAD * (t->mask + 1)
+				&& t->next == NULL)
+				kw_grow(t);
+			return node->kw;
+		}
+	}
+}
+
+PFRTAny foidl_intern_keyword(char *p, uint32_t cnt) {
+	return kw_intern(p, cnt, NULL);
+}
+
+//	Runtime keywords (constKeyword) are interned before anything else
+//	can register their text. Keywords with the same text end up as
+//	the same object
+
+EXTERNC PFRTAny unknownKW, typeKW, regexKW, errorKW, strKW,
+	token_typeKW, token_strKW, linenoKW, colnoKW;
+EXTERNC PFRTAny channel_ext_init, channel_ext_open, channel_ext_read,
+	channel_ext_write, channel_ext_close, channel_ext_iterator,
+	channel_ext_iterator_next;
+EXTERNC PFRTAny chan_file, ext_subtype, ext_interface, ext_functions;
+
+static PFRTAny *static_keywords[] = {
+	&chan_file, &chan_target, &chan_type, &chan_render, &chan_mode,
+	&channel_ext, &channel_ext_init, &channel_ext_open, &channel_ext_read,
+	&channel_ext_write, &channel_ext_close, &channel_ext_iterator,
+	&channel_ext_iterator_next,
+	&ext_type, &ext_subtype, &ext_interface, &ext_functions,
+	&unknownKW, &typeKW, &regexKW, &errorKW, &strKW, &token_typeKW,
+	&token_strKW, &linenoKW, &colnoKW
+};
+
+void foidl_rtl_init_keywords() {
+	for(ft i = 0; i < sizeof(static_keywords) / sizeof(PFRTAny *); i++) {
+		PFRTAny kw = *static_keywords[i];
+		*static_keywords[i] = kw_intern(kw->value, kw->count, kw);
+	}
 }
 
 /*
@@ -138,9 +285,10 @@ PFRTAny	foidl_descan_string(PFRTAny s) {
 */
 
 PFRTAny  foidl_reg_string(char *i) {
-	FRTAny 	anyStr = {scalar_class,string_type,strlen(i),0,i};
-	PFRTAny res = map_get(strMap,&anyStr);
+	struct FRTTypeG anyStr = {0,scalar_class,string_type,strlen(i),0,i};
+	PFRTAny res = map_get(strMap,(PFRTAny) &anyStr.fclass);
 	if(res == nil) {
+		void 	*ar = foidl_arena_suspend();
 		PFRTAny sval = nil;
 		PFRTAny skey = allocGlobalStringCopy(anyStr.value);
 		char *es = escape_scan(i);
@@ -151,23 +299,18 @@ PFRTAny  foidl_reg_string(char *i) {
 			sval = skey;
 		}
 		foidl_map_extend_bang(strMap,skey,sval);
+		foidl_arena_resume(ar);
 		res = sval;
 	}
 	return res;
 }
 
 /*
-	Registers keywords in map and eliminate duplicates
+	Registers keywords in the intern table
 */
 
 PFRTAny  foidl_reg_keyword(char *i) {
-	FRTAny 	anyKW = {scalar_class,keyword_type,strlen(i),0,i};
-	PFRTAny res = map_get(kwMap,&anyKW);
-	if(res == nil) {
-		res = allocGlobalStringCopy(anyKW.value);
-		foidl_map_extend_bang(kwMap,res,res);
-	}
-	return res;
+	return kw_intern(i, strlen(i), NULL);
 }
 
 PFRTAny 	string_first(PFRTAny s) {
@@ -178,19 +321,19 @@ PFRTAny 	string_second(PFRTAny s) {
 	return allocCharWithValue((ft) ((char *)s->value)[1]);
 }
 
+//	The rest of a string is a suffix so it shares the characters
+
 PFRTAny 	string_rest(PFRTAny s) {
 	PFRTAny res = empty_string;
-	if(s != space_string) {
-		char* v = (char *)s->value;
-		res = allocStringWithCopyCnt(s->count,&v[1]);
-	}
+	if(s->count > 1)
+		res = allocStringSlice(s, (char *)s->value + 1, s->count - 1);
 	return res;
 }
 
 PFRTAny 	string_last(PFRTAny s) {
 	PFRTAny res = nil;
-	if(s != empty_string)
-		res = allocCharWithValue(((char *)s->value)[strlen((char *)s->value) - 1]);
+	if(s->count)
+		res = allocCharWithValue(((char *)s->value)[s->count - 1]);
 	return res;
 }
 
@@ -201,7 +344,7 @@ PFRTAny 	string_get(PFRTAny s, PFRTAny index) {
 	if(index->ftype != number_type)
 		unknown_handler();
 	ft val = number_toft(index);
-	if(strlen((char *)s->value) > val)
+	if(s->count > val)
 		res = allocCharWithValue(((char *)s->value)[val]);
 	return res;
 }
@@ -228,72 +371,246 @@ PFRTAny 	string_get_default(PFRTAny s, PFRTAny index,PFRTAny def) {
 	return res;
 }
 
-// Extend a string
-// TODO: Possibly leverage 'format'
+//	Results derived from a keyword are interned as keywords
 
-PFRTAny 	string_extend(PFRTAny s, PFRTAny v) {
-	char 	 *p1=0;
-	int 	 delp = 0;
-	uint32_t bcnt=0;
-	uint32_t tcnt = s->count;
+static PFRTAny string_keyword(PFRTAny s, PFRTAny res) {
+	if(s->ftype == keyword_type) {
+		PFRTAny kw = foidl_intern_keyword(res->value, res->count);
+		foidl_release_temp(res);
+		res = kw;
+	}
+	return res;
+}
+
+// Characters extend appends for v, delp is set when p must be
+// released with foidl_xdel
+
+static uint32_t string_piece(PFRTAny v, char **p, int *delp) {
+	uint32_t bcnt = 0;
 	switch(v->ftype) {
 		// Should checck for control characters (tab, nl, quote, dbl quote)
 		case 	character_type:
-			{
-				p1 = (char *) &v->value;
-				tcnt += bcnt = 1;
-			}
+			*p = (char *) &v->value;
+			bcnt = 1;
 			break;
 		case 	keyword_type:
 		case 	string_type:
-			{
-			p1 = (char *) v->value;
-			tcnt += bcnt = v->count;
-			}
+			*p = (char *) v->value;
+			bcnt = v->count;
 			break;
 		case 	number_type:
-			{
-				p1 = number_tostring(v);
-				delp = 1;
-				tcnt += bcnt = strlen(p1);
-			}
+			*p = number_tostring(v);
+			*delp = 1;
+			bcnt = strlen(*p);
 			break;
 		// Does this make sense?
 		case 	nil_type:
-			p1 = (char *) nilstr->value;
-			tcnt += bcnt = nilstr->count;
+			*p = (char *) nilstr->value;
+			bcnt = nilstr->count;
 			break;
 		default:
 			unknown_handler();
 	}
+	return bcnt;
+}
 
-	PFRTAny res = allocAndConcatString(tcnt,s->value,s->count,p1,bcnt);
-	if(s->ftype == keyword_type)
-		res->ftype = keyword_type;
+// Extend a string
+// TODO: Possibly leverage 'format'
+
+PFRTAny 	string_extend(PFRTAny s, PFRTAny v) {
+	char 	 *p1=0;
+	int 	 delp = 0;
+	uint32_t bcnt = string_piece(v, &p1, &delp);
+	uint32_t tcnt = s->count + bcnt;
+
+	PFRTAny res = string_keyword(s,
+		allocAndConcatString(tcnt,s->value,s->count,p1,bcnt));
 	if(delp == 1)
 		foidl_xdel(p1);
 
 	return res;
 }
 
+//	A transient string is the tip of a builder, extend! appends to it
+//	in place while the builder has room and nothing else was cut from
+//	it, otherwise it moves to a new builder. Any other slice becomes
+//	a transient on its first extend!
+
+static int string_tip(PFRTAny s) {
+	if(!STR_SLICE(s))
+		return 0;
+	PFRTStrBuffer b = (PFRTStrBuffer) ((PFRTStrSlice) s)->owner;
+	return STR_BUILDER(b) && s->value == b->value && s->count == b->fill;
+}
+
+PFRTAny 	string_transient_bang(PFRTAny s) {
+	return allocStringBuilder(s->count, s->value, s->count, NULL, 0);
+}
+
+PFRTAny 	string_persistent_bang(PFRTAny s) {
+	if(string_tip(s)) {
+		PFRTStrBuffer b = (PFRTStrBuffer) ((PFRTStrSlice) s)->owner;
+		b->capacity = b->fill;
+	}
+	return s;
+}
+
 PFRTAny 	string_extend_bang(PFRTAny s, PFRTAny v) {
-	PFRTAny sn = s;
-	return sn;
+	char 	 *p1=0;
+	int 	 delp = 0;
+	uint32_t bcnt = string_piece(v, &p1, &delp);
+	uint32_t tcnt = s->count + bcnt;
+	if(!STR_SLICE(s))
+		unknown_handler();
+	PFRTStrSlice ss = (PFRTStrSlice) s;
+	PFRTStrBuffer b = (PFRTStrBuffer) ss->owner;
+	if(string_tip(s) && tcnt <= b->capacity) {
+		char *v = (char *) ss->value;
+		memcpy(&v[ss->count], p1, bcnt);
+		v[tcnt] = 0;
+		b->fill = tcnt;
+	}
+	else {
+		PFRTStrSlice t = (PFRTStrSlice)
+			allocStringBuilder(tcnt, ss->value, ss->count, p1, bcnt);
+		foidl_unref(ss->owner);
+		ss->owner = foidl_retain(t->owner);
+		ss->value = t->value;
+		foidl_release_temp((PFRTAny) t);
+	}
+	ss->count = tcnt;
+	ss->hash = 0;
+	if(delp == 1)
+		foidl_xdel(p1);
+	return s;
 }
 
 PFRTAny 	string_update(PFRTAny s, PFRTAny index, PFRTAny v) {
 	PFRTAny sn = s;
 	if(v->fclass == scalar_class && v->ftype == character_type) {
-		sn = allocStringWithCopy(s->value);
+		sn = allocStringWithCopyCnt(s->count, s->value);
 		((char *) sn->value)[(uint32_t)index->value] = (char)v->value;
+		sn = string_keyword(s, sn);
 	}
 	return sn;
 }
 
+/*
+	Retired characters
+
+	A shared string that moves to new characters keeps the old ones
+	for its slices. They are raw roots the collector leaves alone and
+	are freed with the string, by release_string or by the collector's
+	sweep. Buckets are keyed by the owning string
+*/
+
+#define RETIRED_BUCKETS 64
+
+typedef struct Retired {
+	struct Retired 	*next;
+	PFRTAny 		owner;
+	char 			*chars;
+} Retired;
+
+static Retired *retired[RETIRED_BUCKETS];
+
+static void lock_retired() {
+#ifdef _MSC_VER
+	AcquireSRWLockExclusive(&retired_lock);
+#else
+	pthread_mutex_lock(&retired_lock);
+#endif
+}
+
+static void unlock_retired() {
+#ifdef _MSC_VER
+	ReleaseSRWLockExclusive(&retired_lock);
+#else
+	pthread_mutex_unlock(&retired_lock);
+#endif
+}
+
+static Retired **retired_bucket(PFRTAny s) {
+	return &retired[((ft) s >> 5) % RETIRED_BUCKETS];
+}
+
+static void retire_chars(PFRTAny s, char *chars) {
+	Retired *r = malloc(sizeof(Retired));
+	if(r == NULL)
+		unknown_handler();
+	foidl_sig_flags((PFRTAny) chars, raw_root, 0);
+	r->owner = s;
+	r->chars = chars;
+	lock_retired();
+	r->next = *retired_bucket(s);
+	*retired_bucket(s) = r;
+	unlock_retired();
+	foidl_sig_flags(s, str_retired, 0);
+}
+
+void release_retired(PFRTAny s) {
+	Retired 	*done = NULL;
+	lock_retired();
+	for(Retired **link = retired_bucket(s); *link != NULL;) {
+		Retired *r = *link;
+		if(r->owner == s) {
+			*link = r->next;
+			r->next = done;
+			done = r;
+		}
+		else
+			link = &r->next;
+	}
+	unlock_retired();
+	while(done != NULL) {
+		Retired *r = done;
+		done = r->next;
+		foidl_xdel(r->chars);
+		free(r);
+	}
+}
+
+//	Gives a slice its own characters before they are written so the
+//	string it was cut from, and its other slices, are left alone. A
+//	string that slices were cut from moves to new characters instead,
+//	the old ones are freed now if no slice holds the string, else they
+//	are retired to it
+
+static void string_unshare(PFRTAny s) {
+	if(STR_SLICE(s)) {
+		PFRTStrSlice ss = (PFRTStrSlice) s;
+		PFRTAny 	 own = allocStringShared(ss->count);
+		memcpy(own->value, ss->value, ss->count);
+		((char *) own->value)[ss->count] = 0;
+		foidl_unref(ss->owner);
+		ss->owner = foidl_retain(own);
+		ss->value = own->value;
+		foidl_release_temp(own);
+	}
+	else if(STR_SHARED(s)) {
+		char 	*oldp = (char *) s->value;
+		char 	*newp = foidl_xall_shared(s->count + 1);
+		memcpy(newp, oldp, s->count);
+		newp[s->count] = 0;
+		s->value = newp;
+		if(((ANYTOG(s))->fsig & ref_mask) == 0)
+			foidl_xdel(oldp);
+		else
+			retire_chars(s, oldp);
+		foidl_sig_flags(s, 0, str_shared);
+	}
+}
+
+//	Keywords are interned so the bang writers leave them alone
+
 PFRTAny 	string_update_bang(PFRTAny s, PFRTAny index, PFRTAny v) {
 	PFRTAny sn = s;
+	if(s->ftype == keyword_type)
+		return string_update(s, index, v);
 	if(v->fclass == scalar_class && v->ftype == character_type ) {
+		string_unshare(sn);
 		((char *) sn->value)[(uint32_t)index->value] = (char)v->value;
+		sn->hash = 0;
 	}
 	return sn;
 }
@@ -302,25 +619,44 @@ PFRTAny 	string_update_bang(PFRTAny s, PFRTAny index, PFRTAny v) {
 PFRTAny 	string_droplast(PFRTAny s) {
 	if(s->count == 1)
 		unknown_handler();
-	PFRTAny sn = allocStringWithCopy(s->value);
+	PFRTAny sn = allocStringWithCopyCnt(s->count, s->value);
 	--sn->count;
 	((char *) sn->value)[sn->count] = 0;
-	return sn;
+	return string_keyword(s, sn);
 }
 
 PFRTAny 	string_droplast_bang(PFRTAny s) {
+	if(s->ftype == keyword_type)
+		return string_droplast(s);
 	if( s->count ) {
+		string_unshare(s);
 		((char *) s->value)[s->count-1] = 0;
 		--s->count;
+		s->hash = 0;
 	}
 	return s;
 }
 
+//	A copy of the characters of s as a C string, the caller releases
+//	it with foidl_xdel
+
+char 	*string_cstr(PFRTAny s) {
+	char 	*res = foidl_xall(s->count + 1);
+	memcpy(res, s->value, s->count);
+	res[s->count] = 0;
+	return res;
+}
+
 PFRTAny 	release_string(PFRTAny s) {
 	PFRTTypeG  rs = ANYTOG(s);
-	if(rs->fsig == global_signature)
+	if(SIGOF(rs) == global_signature)
 		return s;
-	foidl_xdel(s->value);
+	if(STR_SLICE(s))
+		foidl_unref(((PFRTStrSlice) s)->owner);
+	else
+		foidl_xdel(s->value);
+	if(STR_RETIRED(s))
+		release_retired(s);
 	foidl_xdel(s);
 	return nil;
 }
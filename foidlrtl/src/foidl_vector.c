@@ -9,6 +9,7 @@
 
 #define  VECTOR_IMPL
 #include <foidlrt.h>
+#include <string.h>
 
 // Externs (may move to headers)
 
@@ -34,60 +35,166 @@ PFRTHamtNode const	empty_node = &_empty_node;
 static PFRTHamtNode cloneNode(PFRTHamtNode src) {
 	PFRTHamtNode 	dest = allocHamtNode();
 	for(ft i=0; i < 32; i++)
-		dest->slots[i] = src->slots[i];
+		dest->slots[i] = foidl_retain(src->slots[i]);
 	return dest;
 }
 
+//	Replace a slot, moving the reference from the old to the new value
+
+static void setSlot(PFRTHamtNode node, ft idx, PFRTAny value) {
+	PFRTAny old = node->slots[idx];
+	node->slots[idx] = foidl_retain(value);
+	foidl_unref(old);
+}
+
+//	Structural hash term, each element weighted by an odd factor of
+//	its position so order counts and a slot can be swapped in place
+
+static uint32_t slotHash(PFRTAny e, ft i) {
+	return hash(e) * (2 * (uint32_t) i + 1);
+}
+
+//	Relaxed radix balanced trees. Extend builds plain nodes that are
+//	dense and radix indexed. Slicing and concatenation build relaxed
+//	nodes (rrbnode_class) which index through a table of cumulative
+//	sizes. Plain subtrees may sit under relaxed nodes but never the
+//	reverse, all leaves of a plain subtree are full
+
+#define RELAXED(n) 	((n)->fclass == rrbnode_class)
+#define SIZES(n) 	(((PFRTRrbNode) (n))->sizes)
+
+static ft slotCount(PFRTHamtNode node) {
+	ft 	c = 0;
+	while(c < WCNT && node->slots[c] != end)
+		++c;
+	return c;
+}
+
+//	Elements held by the subtree of a node at level
+
+static ft treeSize(PFRTHamtNode node, ft level) {
+	ft 	c = slotCount(node);
+	if(c == 0 || level == 0)
+		return c;
+	if(RELAXED(node))
+		return SIZES(node)[c - 1];
+	return ((c - 1) << level)
+		+ treeSize((PFRTHamtNode) node->slots[c - 1], level - SHIFT);
+}
+
+//	Cumulative element count through slot j of a node with c slots
+
+static ft slotEnd(PFRTHamtNode node, ft level, ft j, ft c) {
+	if(RELAXED(node))
+		return SIZES(node)[j];
+	return j + 1 < c ? (j + 1) << level : treeSize(node, level);
+}
+
+//	Slot of the child holding index, index becomes relative to it
+
+static ft childAt(PFRTHamtNode node, ft level, ft *index) {
+	ft 	s = (*index >> level) & MASK;
+	if(RELAXED(node)) {
+		while(SIZES(node)[s] <= *index)
+			++s;
+		if(s > 0)
+			*index -= SIZES(node)[s - 1];
+	}
+	else
+		*index &= (1 << level) - 1;
+	return s;
+}
+
+//	Copies keep the node's kind
+
+static PFRTHamtNode copyNode(PFRTHamtNode src) {
+	if(RELAXED(src)) {
+		PFRTRrbNode 	dest = allocRrbNode();
+		for(ft i=0; i < WCNT; i++) {
+			dest->slots[i] = foidl_retain(src->slots[i]);
+			dest->sizes[i] = SIZES(src)[i];
+		}
+		return (PFRTHamtNode) dest;
+	}
+	return cloneNode(src);
+}
+
+//	Relaxed copy of a node at level
+
+static PFRTHamtNode relaxedClone(PFRTHamtNode src, ft level) {
+	PFRTRrbNode 	dest;
+	ft 				c;
+	if(RELAXED(src))
+		return copyNode(src);
+	dest = allocRrbNode();
+	c = slotCount(src);
+	for(ft i = 0; i < c; i++) {
+		dest->slots[i] = foidl_retain(src->slots[i]);
+		dest->sizes[i] = slotEnd(src, level, i, c);
+	}
+	return (PFRTHamtNode) dest;
+}
+
 //	Tail offset calculation
 static ft tailOffset(PFRTVector pv) {
-	if ( pv->count < 32)
+	if ( pv->count == 0)
+		return 0;
+	else if (RELAXED(pv->root))
+		return SIZES(pv->root)[slotCount(pv->root) - 1];
+	else if ( pv->count < 32)
 		return 0;
 	else
 		return ((( pv->count - 1 ) >> SHIFT) << SHIFT);
 }
 
-//	Retrieves the HAMT node array where index resolves to
-static PFRTHamtNode nodeFor(PFRTVector v, ft index){
-	PFRTHamtNode res;
-	long long i = (long long) index;
-	if(i >= 0 && i < v->count) {
-		if(i >= tailOffset(v))
-			res = v->tail;
-		else {
-			PFRTHamtNode node = v->root;
-			for(ft level = v->shift; level > 0; level -= 5)
-				node = (PFRTHamtNode) node->slots[(i >> level) & MASK];
-			res = node;
-			}
+//	Retrieves the leaf that index resolves to with the index of its
+//	first element and its length
+
+PFRTHamtNode vector_leaf(PFRTVector v, ft index, ft *start, ft *len) {
+	ft 				toff = tailOffset(v);
+	ft 				i = index;
+	PFRTHamtNode 	node = v->root;
+	if(index >= toff) {
+		*start = toff;
+		*len = v->count - toff;
+		return v->tail;
 	}
-	else {
-		//	Should be run-time exception?
-		res = empty_node;
+	*len = WCNT;
+	for(ft level = v->shift; level > 0; level -= SHIFT) {
+		ft s = childAt(node, level, &i);
+		if(level == SHIFT && RELAXED(node))
+			*len = SIZES(node)[s] - (s > 0 ? SIZES(node)[s - 1] : 0);
+		node = (PFRTHamtNode) node->slots[s];
 	}
-	return res;
+	*start = index - i;
+	return node;
 }
 
 PFRTAny vectorGetDefault(PFRTAny v, uint32_t index) {
-	return (PFRTAny) nodeFor((PFRTVector) v,(ft) index);
+	ft 	start, len;
+	if(index >= v->count)
+		return (PFRTAny) empty_node;
+	return (PFRTAny) vector_leaf((PFRTVector) v, (ft) index, &start, &len);
 }
 
 //	Retrieves value at index i
 PFRTAny 	vector_nth(PFRTVector v, ft i) {
-	PFRTHamtNode p = nodeFor(v,i);
-	if( p == empty_node) {
-		return  nil;
-	}
-	return p->slots[i&MASK];
+	ft 	start, len;
+	if((long long) i < 0 || i >= v->count)
+		return nil;
+	PFRTHamtNode p = vector_leaf(v, i, &start, &len);
+	return p->slots[i - start];
 }
 
 
 //	Utilitity functions
 
-static PFRTHamtNode newPath(ft level, PFRTHamtNode node){
+static PFRTHamtNode newPath(ft level, PFRTHamtNode node, uint32_t edit){
 	if(level == 0)
 		return node;
 	PFRTHamtNode ret = allocHamtNode();
-	ret->slots[0] = (PFRTAny) newPath(level - SHIFT, node);
+	ret->edit = edit;
+	ret->slots[0] = foidl_retain((PFRTAny) newPath(level - SHIFT, node, edit));
 	return ret;
 }
 
@@ -109,12 +216,123 @@ static PFRTHamtNode pushTail(ft cnt, ft level, PFRTHamtNode parent, PFRTHamtNode
 		PFRTAny child = parent->slots[subidx];
 		nodeToInsert = ( child != end)?
 		                pushTail(cnt, (level-5), (PFRTHamtNode) child, tailnode)
-		                : newPath((level-5), tailnode);
+		                : newPath((level-5), tailnode, 0);
 		}
-	ret->slots[subidx] = (PFRTAny) nodeToInsert;
+	setSlot(ret, subidx, (PFRTAny) nodeToInsert);
 	return ret;
 }
 
+//	Relaxed path down to a leaf of len elements
+
+static PFRTHamtNode relaxedPath(ft level, PFRTHamtNode leaf, ft len) {
+	if(level == 0)
+		return leaf;
+	PFRTRrbNode ret = allocRrbNode();
+	ret->slots[0] = foidl_retain((PFRTAny) relaxedPath(level - SHIFT, leaf, len));
+	ret->sizes[0] = len;
+	return (PFRTHamtNode) ret;
+}
+
+//	Appends a leaf of len elements to the right edge of a tree, NULL
+//	when the subtree is full. A partial leaf, or a relaxed node on the
+//	way, makes the path relaxed up to the root
+
+static PFRTHamtNode pushLeaf(PFRTHamtNode node, ft level,
+	PFRTHamtNode leaf, ft len) {
+	ft 				c = slotCount(node);
+	PFRTHamtNode 	child = NULL;
+	PFRTHamtNode 	ret;
+	if(level > SHIFT && c > 0)
+		child = pushLeaf((PFRTHamtNode) node->slots[c - 1], level - SHIFT, leaf, len);
+	if(child == NULL && c == WCNT)
+		return NULL;
+	if(RELAXED(node) || len < WCNT || (child != NULL && RELAXED(child))) {
+		ret = relaxedClone(node, level);
+		if(child != NULL) {
+			setSlot(ret, c - 1, (PFRTAny) child);
+			SIZES(ret)[c - 1] += len;
+		}
+		else {
+			ret->slots[c] = foidl_retain((PFRTAny) relaxedPath(level - SHIFT, leaf, len));
+			SIZES(ret)[c] = (c > 0 ? SIZES(ret)[c - 1] : 0) + len;
+		}
+	}
+	else {
+		ret = cloneNode(node);
+		if(child != NULL)
+			setSlot(ret, c - 1, (PFRTAny) child);
+		else
+			ret->slots[c] = foidl_retain((PFRTAny) newPath(level - SHIFT, leaf, 0));
+	}
+	return ret;
+}
+
+//	As pushLeaf, growing a new root when the tree is full
+
+static PFRTHamtNode relaxedPush(PFRTHamtNode root, ft *shift,
+	PFRTHamtNode leaf, ft len) {
+	PFRTHamtNode 	res = pushLeaf(root, *shift, leaf, len);
+	if(res == NULL) {
+		PFRTRrbNode top = allocRrbNode();
+		top->slots[0] = foidl_retain((PFRTAny) root);
+		top->sizes[0] = treeSize(root, *shift);
+		top->slots[1] = foidl_retain((PFRTAny) relaxedPath(*shift, leaf, len));
+		top->sizes[1] = top->sizes[0] + len;
+		*shift += SHIFT;
+		res = (PFRTHamtNode) top;
+	}
+	return res;
+}
+
+//	Removes the rightmost leaf of a tree, &_nil when none remain
+
+static PFRTHamtNode popLeaf(PFRTHamtNode node, ft level, PFRTHamtNode *leaf) {
+	ft 				c = slotCount(node);
+	PFRTHamtNode 	child = (PFRTHamtNode) node->slots[c - 1];
+	PFRTHamtNode 	ret;
+	if(level > SHIFT)
+		child = popLeaf(child, level - SHIFT, leaf);
+	else {
+		*leaf = child;
+		child = (PFRTHamtNode) &_nil;
+	}
+	if(child == (PFRTHamtNode) &_nil && c == 1)
+		return (PFRTHamtNode) &_nil;
+	ret = copyNode(node);
+	if(child == (PFRTHamtNode) &_nil) {
+		setSlot(ret, c - 1, end);
+		if(RELAXED(ret))
+			SIZES(ret)[c - 1] = 0;
+	}
+	else {
+		setSlot(ret, c - 1, (PFRTAny) child);
+		if(RELAXED(ret))
+			SIZES(ret)[c - 1] -= slotCount(*leaf);
+	}
+	return ret;
+}
+
+//	New vector over a root that may be emptied or have a single child.
+//	Nodes collapsed away are released once the vector holds the rest
+
+static PFRTAny vector_make(ft cnt, ft shift, PFRTHamtNode root,
+	PFRTHamtNode tail) {
+	PFRTHamtNode 	top;
+	PFRTAny 		res;
+	if(root == (PFRTHamtNode) &_nil) {
+		root = allocHamtNode();
+		shift = SHIFT;
+	}
+	top = (PFRTHamtNode) foidl_retain((PFRTAny) root);
+	while(shift > SHIFT && slotCount(root) == 1) {
+		root = (PFRTHamtNode) root->slots[0];
+		shift -= SHIFT;
+	}
+	res = (PFRTAny) allocVector(cnt, shift, root, tail);
+	foidl_unref((PFRTAny) top);
+	return res;
+}
+
 //	Get persistent vector item at index
 
 PFRTAny vector_get(PFRTVector src, PFRTAny index) {
@@ -173,13 +391,26 @@ PFRTAny 	vector_second(PFRTAny v) {
 static PFRTAny vector_extend_i(PFRTVector src, PFRTAny value) {
 
 	PFRTHamtNode 	newTail;
+	PFRTVector 		res;
 	ft 				tailcnt = src->count - tailOffset(src);
 
+	//	Empty vectors share no nodes
+	if( src->count == 0 ) {
+		newTail = allocHamtNode();
+		newTail->slots[0] = foidl_retain(value);
+		res = allocVector(1, SHIFT, allocHamtNode(), newTail);
+		res->hash = slotHash(value, 0);
+		return (PFRTAny) res;
+	}
+
 	//	Append to the tail if room
 	if( tailcnt < 32 ) {
 		newTail = cloneNode(src->tail);
-		newTail->slots[tailcnt] = value;
-		return (PFRTAny) allocVector(src->count + 1, src->shift, src->root, newTail);
+		newTail->slots[tailcnt] = foidl_retain(value);
+		res = allocVector(src->count + 1, src->shift, src->root, newTail);
+		res->hash = src->hash + slotHash(value, src->count);
+		res->unhashed = src->unhashed;
+		return (PFRTAny) res;
 	}
 
 	// Tail full, push into tree and do path work
@@ -187,11 +418,14 @@ static PFRTAny vector_extend_i(PFRTVector src, PFRTAny value) {
 	PFRTHamtNode 	tailnode = src->tail;
 	ft 				newshift = src->shift;
 
+	//	Relaxed trees find room along their right edge
+	if (RELAXED(src->root))
+		newRoot = relaxedPush(src->root, &newshift, tailnode, WCNT);
 	//	Root overflow, make root child of new root,
-	if (( src->count >> SHIFT) > (1 << src->shift) ) {
+	else if (( src->count >> SHIFT) > (1 << src->shift) ) {
 		newRoot = allocHamtNode();
-		newRoot->slots[0] = (PFRTAny) src->root;
-		newRoot->slots[1] = (PFRTAny) newPath(src->shift, tailnode);
+		newRoot->slots[0] = foidl_retain((PFRTAny) src->root);
+		newRoot->slots[1] = foidl_retain((PFRTAny) newPath(src->shift, tailnode, 0));
 		newshift += SHIFT;
 	}
 	//	Otherwise just push the tail
@@ -199,9 +433,12 @@ static PFRTAny vector_extend_i(PFRTVector src, PFRTAny value) {
 		newRoot = pushTail(src->count,src->shift,src->root,tailnode);
 
 	newTail = allocHamtNode();
-	newTail->slots[0] = value;
+	newTail->slots[0] = foidl_retain(value);
 
-	return (PFRTAny) allocVector(src->count + 1, newshift, newRoot, newTail);
+	res = allocVector(src->count + 1, newshift, newRoot, newTail);
+	res->hash = src->hash + slotHash(value, src->count);
+	res->unhashed = src->unhashed;
+	return (PFRTAny) res;
 }
 
 PFRTAny vector_extend(PFRTVector src, PFRTAny value) {
@@ -212,14 +449,14 @@ PFRTAny vector_extend(PFRTVector src, PFRTAny value) {
 //	Note: This is the assoc equiv
 
 static PFRTHamtNode vector_doupdate(ft level, PFRTHamtNode node, ft index, PFRTAny item) {
-	PFRTHamtNode 	ret = cloneNode(node);
+	PFRTHamtNode 	ret = copyNode(node);
 	if( level == 0 ) {
-		ret->slots[index & MASK] = item;
+		setSlot(ret, index & MASK, item);
 	}
 	else {
-		ft 	subidx = (index >> level) & MASK;
-		ret->slots[subidx] = (PFRTAny)
-			vector_doupdate(level - SHIFT,(PFRTHamtNode) ret->slots[subidx],index, item);
+		ft 	subidx = childAt(node, level, &index);
+		setSlot(ret, subidx, (PFRTAny)
+			vector_doupdate(level - SHIFT,(PFRTHamtNode) ret->slots[subidx],index, item));
 	}
 	return ret;
 }
@@ -229,15 +466,21 @@ PFRTAny vector_update(PFRTVector src, PFRTAny index, PFRTAny item) {
 		ft 	i = number_toft(index);
 		ft  cnt = src->count;
 		if((long long) i >= 0 && i < cnt) {
-			if(i >= tailOffset(src)) {
+			PFRTVector 	res;
+			uint32_t 	nhash = src->hash - slotHash(vector_nth(src, i), i)
+				+ slotHash(item, i);
+			ft 	toff = tailOffset(src);
+			if(i >= toff) {
 				PFRTHamtNode newTail = cloneNode(src->tail);
-				newTail->slots[i & MASK] = item;
-				return (PFRTAny)
-					allocVector(src->count, src->shift, src->root, newTail);
+				setSlot(newTail, i - toff, item);
+				res = allocVector(src->count, src->shift, src->root, newTail);
 			}
-			return (PFRTAny)
-				allocVector(cnt,src->shift,
+			else
+				res = allocVector(cnt,src->shift,
 					vector_doupdate(src->shift, src->root, i, item), src->tail);
+			res->hash = nhash;
+			res->unhashed = src->unhashed;
+			return (PFRTAny) res;
 		}
 		if(i == cnt)
 			return vector_extend(src,item);
@@ -254,18 +497,19 @@ static PFRTHamtNode popTail(ft cnt,ft level, PFRTHamtNode node) {
 
 	if(level > SHIFT) {
 		PFRTHamtNode newchild = popTail(cnt,level - 5,(PFRTHamtNode) node->slots[subidx]);
-		if((PFRTAny) newchild == end && subidx == 0)
+		if(newchild == (PFRTHamtNode) &_nil && subidx == 0)
 			ret = (PFRTHamtNode) &_nil;
 		else {
 			ret = cloneNode(node); // new Node(root.edit, node.array.clone());
-			ret->slots[subidx] = (PFRTAny) newchild;
+			setSlot(ret, subidx, newchild == (PFRTHamtNode) &_nil ? end
+				: (PFRTAny) newchild);
 			}
 		}
 	else if(subidx == 0)
 		ret = (PFRTHamtNode) &_nil;
 	else {
 		ret = cloneNode(node); // new Node(root.edit, node.array.clone());
-		ret->slots[subidx] = end;
+		setSlot(ret, subidx, end);
 		}
 	return ret;
 }
@@ -279,14 +523,20 @@ PFRTAny vector_pop(PFRTVector src) {
 		ft 	tailcnt = src->count - tailOffset(src);
 		if ( tailcnt > 1) {
 			PFRTHamtNode 	newTail = cloneNode(src->tail);
-			newTail->slots[tailcnt - 1] = end;
+			setSlot(newTail, tailcnt - 1, end);
 			ret = (PFRTAny) allocVector(src->count - 1, src->shift,src->root,newTail);
 		}
+		else if(RELAXED(src->root)) {
+			PFRTHamtNode newTail;
+			PFRTHamtNode newRoot = popLeaf(src->root, src->shift, &newTail);
+			ret = vector_make(src->count - 1, src->shift, newRoot, newTail);
+		}
 		else {
-			PFRTHamtNode newTail = nodeFor(src, src->count - 2);
+			ft 			 start, len;
+			PFRTHamtNode newTail = vector_leaf(src, src->count - 2, &start, &len);
 			PFRTHamtNode newRoot = popTail(src->count,src->shift,src->root);
 			ft 	newshift = src->shift;
-			if( (PFRTAny) newRoot == nil) {
+			if( newRoot == (PFRTHamtNode) &_nil ) {
 				newRoot = allocHamtNode();
 			}
 			if(src->shift > SHIFT && newRoot->slots[1] == end) {
@@ -295,6 +545,9 @@ PFRTAny vector_pop(PFRTVector src) {
 			}
 			ret = (PFRTAny) allocVector(src->count - 1, newshift,newRoot,newTail);
 		}
+		ret->hash = src->hash
+			- slotHash(vector_nth(src, src->count - 1), src->count - 1);
+		((PFRTVector) ret)->unhashed = src->unhashed;
 	}
 	return ret;
 }
@@ -316,16 +569,46 @@ PFRTAny vector_peek(PFRTVector src) {
 //	Transient API
 //
 
+//	Returns node when the vector's editor owns it, otherwise a copy
+//	that it does
+
+static PFRTHamtNode editable(PFRTHamtNode node, uint32_t edit) {
+	PFRTHamtNode 	res;
+	if(node->edit == edit && node != empty_node
+		&& node != (PFRTHamtNode) &_nil)
+		return node;
+	res = (node == (PFRTHamtNode) &_nil) ? allocHamtNode() : copyNode(node);
+	res->edit = edit;
+	return res;
+}
+
+static void vector_settail(PFRTVector v, PFRTHamtNode tail) {
+	if(tail != v->tail) {
+		PFRTHamtNode old = v->tail;
+		v->tail = (PFRTHamtNode) foidl_retain((PFRTAny) tail);
+		foidl_unref((PFRTAny) old);
+	}
+}
+
+static void vector_setroot(PFRTVector v, PFRTHamtNode root) {
+	if(root != v->root) {
+		PFRTHamtNode old = v->root;
+		v->root = (PFRTHamtNode) foidl_retain((PFRTAny) root);
+		foidl_unref((PFRTAny) old);
+	}
+}
+
 //	Transient vector tail transition to root tree
 
-static PFRTHamtNode tailToTree(ft cnt, ft level, PFRTHamtNode parent, PFRTHamtNode tailnode){
+static PFRTHamtNode tailToTree(ft cnt, ft level, PFRTHamtNode parent,
+	PFRTHamtNode tailnode, uint32_t edit){
 	//if parent is leaf, insert node,
 	// else does it map to an existing child? -> nodeToInsert = pushNode one more level
 	// else alloc new path
-	//return  nodeToInsert placed in copy of parent
+	//return  nodeToInsert placed in parent, copied unless owned
 
 	int subidx = ((cnt - 1) >> level) & MASK;
-	PFRTHamtNode ret = parent;
+	PFRTHamtNode ret = editable(parent, edit);
 	PFRTHamtNode nodeToInsert;
 	if(level == 5)
 		{
@@ -333,12 +616,12 @@ static PFRTHamtNode tailToTree(ft cnt, ft level, PFRTHamtNode parent, PFRTHamtNo
 		}
 	else
 		{
-		PFRTAny child = parent->slots[subidx];
+		PFRTAny child = ret->slots[subidx];
 		nodeToInsert = ( child != end)?
-		                tailToTree(cnt, (level-5), (PFRTHamtNode) child, tailnode)
-		                : newPath((level-5), tailnode);
+		                tailToTree(cnt, (level-5), (PFRTHamtNode) child, tailnode, edit)
+		                : newPath((level-5), tailnode, edit);
 		}
-	ret->slots[subidx] = (PFRTAny) nodeToInsert;
+	setSlot(ret, subidx, (PFRTAny) nodeToInsert);
 	return ret;
 }
 
@@ -348,9 +631,14 @@ static PFRTHamtNode tailToTree(ft cnt, ft level, PFRTHamtNode parent, PFRTHamtNo
 PFRTAny vector_extend_bang_i(PFRTAny v,PFRTAny e) {
 	PFRTVector 	vi = (PFRTVector) v;
 	ft 			cnt = vi->count;
+	uint32_t 	edit = (uint32_t) vi->edit;
 
-	if ( (cnt - tailOffset(vi)) < 32 ) {
-		vi->tail->slots[cnt & MASK] = e;
+	ft 			toff = tailOffset(vi);
+
+	vi->hash += slotHash(e, cnt);
+	if ( (cnt - toff) < 32 ) {
+		vector_settail(vi, editable(vi->tail, edit));
+		setSlot(vi->tail, cnt - toff, e);
 		++vi->count;
 		return v;
 	}
@@ -359,20 +647,26 @@ PFRTAny vector_extend_bang_i(PFRTAny v,PFRTAny e) {
 	PFRTHamtNode 	tailnode = vi->tail;
 	ft 				newshift = vi->shift;
 
-	vi->tail = allocHamtNode();
-	vi->tail->slots[0] = e;
+	vi->tail = (PFRTHamtNode) foidl_retain((PFRTAny) allocHamtNode());
+	vi->tail->edit = edit;
+	vi->tail->slots[0] = foidl_retain(e);
 
-	if (( cnt >> 5) > (1 << vi->shift) ) {
+	//	Relaxed trees take the persistent path
+	if (RELAXED(vi->root))
+		newRoot = relaxedPush(vi->root, &newshift, tailnode, WCNT);
+	else if (( cnt >> 5) > (1 << vi->shift) ) {
 		newRoot = allocHamtNode();
-		newRoot->slots[0] = (PFRTAny) vi->root;
-		newRoot->slots[1] = (PFRTAny) newPath(vi->shift, tailnode);
+		newRoot->edit = edit;
+		newRoot->slots[0] = foidl_retain((PFRTAny) vi->root);
+		newRoot->slots[1] = foidl_retain((PFRTAny) newPath(vi->shift, tailnode, edit));
 		newshift += SHIFT;
 	}
 	else {
-		newRoot = tailToTree(vi->count,vi->shift, vi->root,tailnode);
+		newRoot = tailToTree(vi->count,vi->shift, vi->root,tailnode,edit);
 	}
 
-	vi->root  = newRoot;
+	foidl_unref((PFRTAny) tailnode);
+	vector_setroot(vi, newRoot);
 	vi->shift = newshift;
 	++vi->count;
 	return v;
@@ -387,69 +681,121 @@ PFRTAny foidl_vector_extend_bang(PFRTAny v,PFRTAny e) {
 		return vector_extend_bang_i(v,e);
 }
 
+static PFRTHamtNode vector_doupdate_bang(uint32_t edit, ft level,
+	PFRTHamtNode node, ft index, PFRTAny item) {
+	PFRTHamtNode 	ret = editable(node, edit);
+	if( level == 0 ) {
+		setSlot(ret, index & MASK, item);
+	}
+	else {
+		ft 	subidx = childAt(node, level, &index);
+		setSlot(ret, subidx, (PFRTAny) vector_doupdate_bang(edit, level - SHIFT,
+			(PFRTHamtNode) ret->slots[subidx], index, item));
+	}
+	return ret;
+}
+
 PFRTAny vector_update_bang(PFRTVector src, PFRTAny index, PFRTAny item) {
 	if(index->ftype != number_type)
 		unknown_handler();
 	ft i =  number_toft(index);
-	nodeFor(src,i)->slots[i&MASK] = item;
+	uint32_t edit = (uint32_t) src->edit;
+	if(i >= src->count)
+		return (PFRTAny) src;
+	src->hash += slotHash(item, i) - slotHash(vector_nth(src, i), i);
+	ft toff = tailOffset(src);
+	if(i >= toff) {
+		vector_settail(src, editable(src->tail, edit));
+		setSlot(src->tail, i - toff, item);
+	}
+	else
+		vector_setroot(src, vector_doupdate_bang(edit, src->shift, src->root, i, item));
 	return (PFRTAny) src;
 }
 
 //	Mutative drop-last
 // 	TODO: Is there a memory leak when droping HAMT Nodes
 
-static PFRTHamtNode popTail_bang(ft cnt,ft level, PFRTHamtNode node) {
+static PFRTHamtNode popTail_bang(ft cnt,ft level, PFRTHamtNode node, uint32_t edit) {
 	ft subidx = ((cnt-2) >> level) & MASK;
 	PFRTHamtNode ret;
 
 	if(level > SHIFT) {
-		PFRTHamtNode newchild = popTail_bang(cnt,level - 5,(PFRTHamtNode) node->slots[subidx]);
-		if((PFRTAny) newchild == end && subidx == 0)
+		PFRTHamtNode newchild = popTail_bang(cnt,level - 5,
+			(PFRTHamtNode) node->slots[subidx], edit);
+		if(newchild == (PFRTHamtNode) &_nil && subidx == 0)
 			ret = (PFRTHamtNode) &_nil;
 		else {
-			ret = node;
-			ret->slots[subidx] = (PFRTAny) newchild;
+			ret = editable(node, edit);
+			setSlot(ret, subidx, newchild == (PFRTHamtNode) &_nil ? end
+				: (PFRTAny) newchild);
 			}
 		}
 	else if(subidx == 0)
 		ret = (PFRTHamtNode) &_nil;
 	else {
-		ret = node;
-		ret->slots[subidx] = end;
+		ret = editable(node, edit);
+		setSlot(ret, subidx, end);
 		}
 	return ret;
 }
 
 PFRTAny vector_pop_bang(PFRTVector src) {
+	uint32_t edit = (uint32_t) src->edit;
+	src->hash -= slotHash(vector_nth(src, src->count - 1), src->count - 1);
 
 	//	Only one element is in the tail
 	if (src->count == 1) {
-		src->tail->slots[0] = end;
+		vector_settail(src, editable(src->tail, edit));
+		setSlot(src->tail, 0, end);
 		--src->count;
 		return (PFRTAny) src;
 	}
 
 	//	Possible tail location
-	ft 	intail = ((src->count - 1) & MASK);
+	ft 	intail = src->count - 1 - tailOffset(src);
 	if ( intail > 0) {
-		src->tail->slots[intail] = end;
+		vector_settail(src, editable(src->tail, edit));
+		setSlot(src->tail, intail, end);
 		--src->count;
 		return (PFRTAny) src;
 	}
 
 	//	Heavier lifting
 
-	PFRTHamtNode newTail  = nodeFor(src, src->count - 2);
-	PFRTHamtNode newRoot  = popTail_bang(src->count,src->shift,src->root);
+	ft 			 start, len;
+	PFRTHamtNode newTail;
+	PFRTHamtNode newRoot;
 	ft 			 newShift = src->shift;
 
+	if(RELAXED(src->root)) {
+		PFRTVector 	v;
+		newRoot = popLeaf(src->root, src->shift, &newTail);
+		v = (PFRTVector) vector_make(src->count - 1, src->shift, newRoot, newTail);
+		vector_setroot(src, v->root);
+		vector_settail(src, v->tail);
+		src->shift = v->shift;
+		src->count = v->count;
+		foidl_release_temp((PFRTAny) v);
+		return (PFRTAny) src;
+	}
+
+	//	Held before the pop drops the tree's claim on it
+	newTail  = (PFRTHamtNode) foidl_retain((PFRTAny)
+		vector_leaf(src, src->count - 2, &start, &len));
+	newRoot  = popTail_bang(src->count,src->shift,src->root,edit);
+
 	if( newRoot == (PFRTHamtNode) &_nil ) {
 		newRoot = allocHamtNode();
+		newRoot->edit = edit;
 	}
 	if(src->shift > SHIFT && newRoot->slots[1] == end) {
 		newRoot =  (PFRTHamtNode) newRoot->slots[0];
 		newShift = newShift - SHIFT;
 	}
+	foidl_retain((PFRTAny) newRoot);
+	foidl_unref((PFRTAny) src->root);
+	foidl_unref((PFRTAny) src->tail);
 	src->root = newRoot;
 	src->tail = newTail;
 	src->shift = newShift;
@@ -478,32 +824,442 @@ PFRTAny foidl_vector_inst_bang() {
 	return (PFRTAny) allocVector(0,SHIFT,allocHamtNode(), allocHamtNode());
 }
 
+//	Transient over src, shares src's nodes until it changes them
 
-PFRTAny vector_rest(PFRTAny src) {
-	PFRTAny result = (PFRTAny) empty_vector;
-	if(src->count > 1) {
-		PFRTAny 		itm = nil;
-		PFRTAny 		v1 = foidl_vector_inst_bang();
-		PFRTIterator	vi = iteratorFor(src);
-		result = v1;
-		iteratorNext(vi);
-		while((itm = iteratorNext(vi)) != end)
-			vector_extend_bang_i((PFRTAny) v1,itm);
-		foidl_xdel(vi);
-		uint32_t s1hsh = hash(vector_first(src));
-		v1->hash = src->hash - s1hsh;
-		v1->count = src->count - 1;
+PFRTAny vector_transient_bang(PFRTAny v) {
+	PFRTVector 	src = (PFRTVector) v;
+	PFRTVector 	res;
+	if(src->count == 0)
+		res = (PFRTVector) foidl_vector_inst_bang();
+	else {
+		res = allocVector(src->count, src->shift, src->root, src->tail);
+		res->hash = src->hash;
+		res->unhashed = src->unhashed;
+	}
+	res->edit = foidl_edit_token();
+	return (PFRTAny) res;
+}
+
+
+//	Bottom up construction. Elements fill a leaf, a full leaf goes to
+//	the open interior node at level 0, a full interior node goes up a
+//	level. No path is copied and every node is written once
+
+static void vector_builder_push(PVectorBuilder b, ft level, PFRTHamtNode child) {
+	if(b->open[level] != NULL && b->fill[level] == WCNT) {
+		vector_builder_push(b, level + 1, b->open[level]);
+		b->open[level] = NULL;
+	}
+	if(b->open[level] == NULL) {
+		b->open[level] = allocHamtNode();
+		b->fill[level] = 0;
+		if(level + 1 > b->levels)
+			b->levels = level + 1;
+	}
+	b->open[level]->slots[b->fill[level]++] = foidl_retain((PFRTAny) child);
+}
+
+void vector_builder_init(PVectorBuilder b) {
+	memset(b, 0, sizeof(struct VectorBuilder));
+}
 
+void vector_builder_add(PVectorBuilder b, PFRTAny value) {
+	if(b->leaf == NULL)
+		b->leaf = allocHamtNode();
+	else if((b->count & MASK) == 0) {
+		vector_builder_push(b, 0, b->leaf);
+		b->leaf = allocHamtNode();
 	}
-	return result;
+	b->leaf->slots[b->count & MASK] = foidl_retain(value);
+	b->hash += slotHash(value, b->count);
+	++b->count;
+}
+
+//	Closes the right edge, each open node joins its parent and the
+//	highest becomes the root
+
+PFRTAny vector_builder_finish(PVectorBuilder b) {
+	PFRTVector 		res;
+	PFRTHamtNode 	root;
+	if(b->count == 0)
+		return (PFRTAny) empty_vector;
+	for(ft k = 0; k + 1 < b->levels; k++) {
+		vector_builder_push(b, k + 1, b->open[k]);
+		b->open[k] = NULL;
+	}
+	root = b->levels ? b->open[b->levels - 1] : allocHamtNode();
+	res = allocVector(b->count, SHIFT * (b->levels ? b->levels : 1),
+		root, b->leaf);
+	res->hash = b->hash;
+	return (PFRTAny) res;
+}
+
+PFRTAny vector_from_iterator(PFRTIterator itr) {
+	struct VectorBuilder 	b;
+	PFRTAny 				itm;
+	vector_builder_init(&b);
+	while((itm = iteratorNext(itr)) != end)
+		vector_builder_add(&b, itm);
+	return vector_builder_finish(&b);
 }
 
 //	Transmutes the command line into a foidl vector
 PFRTAny vector_from_argv(int cnt, char** argv) {
-	PFRTVector res = (PFRTVector) foidl_vector_inst_bang();
+	struct VectorBuilder 	b;
+	vector_builder_init(&b);
 	for(int i = 0; i < cnt;)
-		vector_extend_bang_i((PFRTAny) res,allocGlobalString(argv[i++]));
-	return (PFRTAny) res;
+		vector_builder_add(&b, allocGlobalString(argv[i++]));
+	return vector_builder_finish(&b);
+}
+
+//
+//	Slicing and concatenation
+//
+
+//	Keeps [0, to) of a subtree
+
+static PFRTHamtNode sliceRight(PFRTHamtNode node, ft level, ft to) {
+	ft 				c = slotCount(node);
+	ft 				rel = to - 1;
+	ft 				s;
+	PFRTHamtNode 	child;
+	PFRTHamtNode 	ret;
+	if(level == 0) {
+		if(to == c)
+			return node;
+		ret = allocHamtNode();
+		for(ft i = 0; i < to; i++)
+			ret->slots[i] = foidl_retain(node->slots[i]);
+		return ret;
+	}
+	s = childAt(node, level, &rel);
+	child = sliceRight((PFRTHamtNode) node->slots[s], level - SHIFT, rel + 1);
+	if(s == c - 1 && (PFRTAny) child == node->slots[s])
+		return node;
+	ret = RELAXED(node) ? (PFRTHamtNode) allocRrbNode() : allocHamtNode();
+	for(ft i = 0; i < s; i++)
+		ret->slots[i] = foidl_retain(node->slots[i]);
+	ret->slots[s] = foidl_retain((PFRTAny) child);
+	if(RELAXED(ret)) {
+		for(ft i = 0; i < s; i++)
+			SIZES(ret)[i] = SIZES(node)[i];
+		SIZES(ret)[s] = (s > 0 ? SIZES(node)[s - 1] : 0) + rel + 1;
+	}
+	return ret;
+}
+
+//	Drops [0, from) of a subtree, the left edge becomes relaxed
+
+static PFRTHamtNode sliceLeft(PFRTHamtNode node, ft level, ft from) {
+	ft 				c = slotCount(node);
+	ft 				rel = from;
+	ft 				s;
+	PFRTHamtNode 	child;
+	PFRTRrbNode 	ret;
+	if(from == 0)
+		return node;
+	if(level == 0) {
+		PFRTHamtNode leaf = allocHamtNode();
+		for(ft i = from; i < c; i++)
+			leaf->slots[i - from] = foidl_retain(node->slots[i]);
+		return leaf;
+	}
+	s = childAt(node, level, &rel);
+	child = sliceLeft((PFRTHamtNode) node->slots[s], level - SHIFT, rel);
+	ret = allocRrbNode();
+	for(ft i = s; i < c; i++) {
+		ret->slots[i - s] = foidl_retain(i == s ? (PFRTAny) child : node->slots[i]);
+		ret->sizes[i - s] = slotEnd(node, level, i, c) - from;
+	}
+	return (PFRTHamtNode) ret;
+}
+
+static PFRTAny vector_from_range(PFRTVector src, ft from, ft to) {
+	struct VectorBuilder 	b;
+	vector_builder_init(&b);
+	while(from < to)
+		vector_builder_add(&b, vector_nth(src, from++));
+	return vector_builder_finish(&b);
+}
+
+//	Elements [from, to) sharing the source's nodes. Only the edges of
+//	the cut are copied
+
+PFRTAny vector_slice(PFRTAny v, ft from, ft to) {
+	PFRTVector 		src = (PFRTVector) v;
+	PFRTHamtNode 	root = src->root;
+	PFRTHamtNode 	tail = src->tail;
+	PFRTHamtNode 	cut;
+	ft 				toff = tailOffset(src);
+	PFRTAny 		res;
+
+	if(to > src->count)
+		to = src->count;
+	if(from >= to)
+		return (PFRTAny) empty_vector;
+	if(from == 0 && to == src->count)
+		return v;
+	if(to - from <= WCNT)
+		return vector_from_range(src, from, to);
+
+	//	Right edge, the last leaf kept becomes the tail
+	if(to > toff) {
+		if(to < src->count)
+			tail = sliceRight(tail, 0, to - toff);
+		foidl_retain((PFRTAny) root);
+		foidl_retain((PFRTAny) tail);
+	}
+	else {
+		cut = (PFRTHamtNode) foidl_retain((PFRTAny)
+			sliceRight(src->root, src->shift, to));
+		root = popLeaf(cut, src->shift, &tail);
+		foidl_retain((PFRTAny) root);
+		foidl_retain((PFRTAny) tail);
+		foidl_unref((PFRTAny) cut);
+	}
+
+	//	Left edge, more than a leaf remains so it is in the tree
+	res = vector_make(to - from, src->shift,
+		sliceLeft(root, src->shift, from), tail);
+	((PFRTVector) res)->unhashed = 1;
+	foidl_unref((PFRTAny) root);
+	foidl_unref((PFRTAny) tail);
+	return res;
+}
+
+PFRTAny vector_rest(PFRTAny src) {
+	return vector_slice(src, 1, src->count);
+}
+
+//	Concatenation merges the right edge of the left tree with the left
+//	edge of the right tree a level at a time. Slots on the seam are
+//	redistributed until the level needs at most RRB_EXTRAS more nodes
+//	than a dense one would (Bagwell and Rompf, L'orange)
+
+#define RRB_EXTRAS 		2
+#define RRB_INVARIANT 	1
+
+//	Relaxed node at level over children
+
+static PFRTHamtNode relaxedOver(PFRTHamtNode *nodes, ft cnt, ft level) {
+	PFRTRrbNode 	res = allocRrbNode();
+	ft 				sum = 0;
+	for(ft i = 0; i < cnt; i++) {
+		res->slots[i] = foidl_retain((PFRTAny) nodes[i]);
+		sum += treeSize(nodes[i], level - SHIFT);
+		res->sizes[i] = sum;
+	}
+	return (PFRTHamtNode) res;
+}
+
+//	Plans how many slots each merged node takes, returns the node count
+
+static ft concatPlan(PFRTHamtNode *all, ft cnt, ft *plan) {
+	ft 	total = 0;
+	ft 	i = 0;
+	for(ft j = 0; j < cnt; j++) {
+		plan[j] = slotCount(all[j]);
+		total += plan[j];
+	}
+	ft 	optimal = ((total - 1) / WCNT) + 1;
+	while(optimal + RRB_EXTRAS < cnt) {
+		while(plan[i] > WCNT - RRB_INVARIANT)
+			++i;
+		ft 	remaining = plan[i];
+		do {
+			ft 	fill = remaining + plan[i + 1];
+			if(fill > WCNT)
+				fill = WCNT;
+			remaining = remaining + plan[i + 1] - fill;
+			plan[i++] = fill;
+		} while(remaining > 0);
+		for(ft j = i; j < cnt - 1; j++)
+			plan[j] = plan[j + 1];
+		--cnt;
+		--i;
+	}
+	return cnt;
+}
+
+//	Builds the planned nodes at level, untouched nodes are reused
+
+static void concatExecute(PFRTHamtNode *all, ft *plan, ft pcnt, ft level,
+	PFRTHamtNode *out) {
+	ft 	idx = 0;
+	ft 	offset = 0;
+	for(ft i = 0; i < pcnt; i++) {
+		ft 				want = plan[i];
+		ft 				got = 0;
+		PFRTHamtNode 	node;
+		if(offset == 0 && slotCount(all[idx]) == want) {
+			out[i] = all[idx++];
+			continue;
+		}
+		node = level > 0 ? (PFRTHamtNode) allocRrbNode() : allocHamtNode();
+		while(got < want) {
+			PFRTHamtNode 	from = all[idx];
+			ft 				avail = slotCount(from) - offset;
+			ft 				take = avail < want - got ? avail : want - got;
+			for(ft k = 0; k < take; k++)
+				node->slots[got + k] = foidl_retain(from->slots[offset + k]);
+			got += take;
+			if(take == avail) {
+				++idx;
+				offset = 0;
+			}
+			else
+				offset += take;
+		}
+		if(level > 0) {
+			ft 	sum = 0;
+			for(ft k = 0; k < got; k++) {
+				sum += treeSize((PFRTHamtNode) node->slots[k], level - SHIFT);
+				SIZES(node)[k] = sum;
+			}
+		}
+		out[i] = node;
+	}
+}
+
+//	Merges the children of left (but its last), centre and right (but
+//	its first). Returns the node at level when it fits at the top,
+//	otherwise a node a level up
+
+static PFRTHamtNode rebalance(PFRTHamtNode left, PFRTHamtNode centre,
+	PFRTHamtNode right, ft level, int top, ft *shift) {
+	PFRTHamtNode 	all[2 * WCNT + 2];
+	PFRTHamtNode 	merged[2 * WCNT + 2];
+	ft 				plan[2 * WCNT + 2];
+	ft 				cnt = 0;
+	ft 				pcnt;
+	PFRTHamtNode 	res;
+
+	if(left != NULL)
+		for(ft i = 0, c = slotCount(left); i + 1 < c; i++)
+			all[cnt++] = (PFRTHamtNode) left->slots[i];
+	for(ft i = 0, c = slotCount(centre); i < c; i++)
+		all[cnt++] = (PFRTHamtNode) centre->slots[i];
+	if(right != NULL)
+		for(ft i = 1, c = slotCount(right); i < c; i++)
+			all[cnt++] = (PFRTHamtNode) right->slots[i];
+
+	pcnt = concatPlan(all, cnt, plan);
+	concatExecute(all, plan, pcnt, level - SHIFT, merged);
+	if(pcnt <= WCNT) {
+		res = relaxedOver(merged, pcnt, level);
+		if(top)
+			*shift = level;
+		else {
+			res = relaxedOver(&res, 1, level + SHIFT);
+			*shift = level + SHIFT;
+		}
+	}
+	else {
+		PFRTHamtNode 	halves[2];
+		halves[0] = relaxedOver(merged, WCNT, level);
+		halves[1] = relaxedOver(merged + WCNT, pcnt - WCNT, level);
+		res = relaxedOver(halves, 2, level + SHIFT);
+		*shift = level + SHIFT;
+	}
+
+	//	The centre was only a carrier
+	foidl_retain((PFRTAny) centre);
+	foidl_unref((PFRTAny) centre);
+	return res;
+}
+
+static PFRTHamtNode concatSub(PFRTHamtNode left, ft lshift,
+	PFRTHamtNode right, ft rshift, int top, ft *shift) {
+	PFRTHamtNode 	centre;
+	ft 				cshift;
+	if(lshift > rshift) {
+		centre = concatSub((PFRTHamtNode) left->slots[slotCount(left) - 1],
+			lshift - SHIFT, right, rshift, 0, &cshift);
+		return rebalance(left, centre, NULL, lshift, top, shift);
+	}
+	if(lshift < rshift) {
+		centre = concatSub(left, lshift,
+			(PFRTHamtNode) right->slots[0], rshift - SHIFT, 0, &cshift);
+		return rebalance(NULL, centre, right, rshift, top, shift);
+	}
+	if(lshift == 0) {
+		PFRTHamtNode 	leaves[2] = {left, right};
+		*shift = SHIFT;
+		return relaxedOver(leaves, 2, SHIFT);
+	}
+	centre = concatSub((PFRTHamtNode) left->slots[slotCount(left) - 1],
+		lshift - SHIFT, (PFRTHamtNode) right->slots[0], rshift - SHIFT, 0, &cshift);
+	return rebalance(left, centre, right, lshift, top, shift);
+}
+
+PFRTAny vector_concat(PFRTAny l, PFRTAny r) {
+	PFRTVector 		lhs = (PFRTVector) l;
+	PFRTVector 		rhs = (PFRTVector) r;
+	PFRTHamtNode 	left;
+	PFRTHamtNode 	root;
+	ft 				lshift = lhs->shift;
+	ft 				shift;
+	ft 				ltoff = tailOffset(lhs);
+	PFRTAny 		res;
+
+	if(lhs->count == 0)
+		return r;
+	if(rhs->count == 0)
+		return l;
+
+	//	A right side held in its tail is appended
+	if(tailOffset(rhs) == 0) {
+		PFRTVector 		t = (PFRTVector) vector_transient_bang(l);
+		for(ft i = 0; i < rhs->count; i++)
+			vector_extend_bang_i((PFRTAny) t, rhs->tail->slots[i]);
+		t->edit = 0;
+		return (PFRTAny) t;
+	}
+
+	//	The left tail joins its tree, then the trees are merged
+	if(ltoff == 0) {
+		left = relaxedPath(SHIFT, lhs->tail, lhs->count);
+		lshift = SHIFT;
+	}
+	else
+		left = relaxedPush(lhs->root, &lshift, lhs->tail, lhs->count - ltoff);
+	foidl_retain((PFRTAny) left);
+	root = concatSub(left, lshift, rhs->root, rhs->shift, 1, &shift);
+	res = vector_make(lhs->count + rhs->count, shift, root, rhs->tail);
+	((PFRTVector) res)->unhashed = 1;
+	foidl_unref((PFRTAny) left);
+	return res;
+}
+
+//	Insert at index, the vector is cut there and rejoined
+
+PFRTAny vector_insert(PFRTAny v, ft index, PFRTAny item) {
+	PFRTAny 	head;
+	if(index >= v->count)
+		return vector_extend((PFRTVector) v, item);
+	head = vector_extend((PFRTVector) vector_slice(v, 0, index), item);
+	return vector_concat(head, vector_slice(v, index, v->count));
+}
+
+//	Sliced and concatenated vectors hash on first use
+
+uint32_t vector_hash(PFRTAny v) {
+	PFRTVector 	src = (PFRTVector) v;
+	if(src->unhashed) {
+		PFRTIterator 	vi = iteratorFor(v);
+		PFRTAny 		one;
+		PFRTAny 		*elems;
+		uint32_t 		h = 0;
+		ft 				i = 0;
+		ft 				n;
+		while((n = iteratorChunk(vi, &one, &elems)) > 0)
+			for(ft j = 0; j < n; j++, i++)
+				h += slotHash(elems[j], i);
+		iteratorRelease(vi);
+		src->hash = h;
+		src->unhashed = 0;
+	}
+	return src->hash;
 }
 
 //
@@ -523,20 +1279,30 @@ PFRTAny write_vector(PFRTAny channel, PFRTAny vector, channel_writer writer) {
 			writer(channel,res);
 			if(max > i++) writer(channel,comma);
 		}
-		foidl_xdel(vi);
+		iteratorRelease(vi);
 	}
 	writer(channel,rbracket);
 	return nil;
 }
 
 
+//	Builds in one pass from any collection's elements
+
 PFRTAny coerce_to_vector(PFRTAny mtemplate, PFRTAny src) {
-	unknown_handler();
-	return src;
+	PFRTAny 		res;
+	PFRTIterator 	itr;
+	if(src->ftype == vector2_type)
+		return src;
+	if(foidl_collection_qmark(src) != true)
+		unknown_handler();
+	itr = iteratorFor(src);
+	res = vector_from_iterator(itr);
+	iteratorRelease(itr);
+	return res;
 }
 
 //	Memory recovery
 
 void release_vector(PFRTVector v) {
-	unknown_handler();
+	foidl_release((PFRTAny) v);
 }
@@ -64,6 +64,44 @@ PFRTAny foidl_work_state(PFRTAny wrkref) {
 }
 
 
+/*
+    Waits that may outlast a collection request run through
+    foidl_gc_blocking so the collector does not wait on them
+*/
+
+typedef struct NapRequest {
+    ft      tmms;
+    int     ires;
+} NapRequest;
+
+static void blocked_nap(void *arg) {
+    NapRequest  *nap = (NapRequest *) arg;
+    #ifdef _MSC_VER
+    Sleep(nap->tmms);
+    nap->ires = 0;
+    #else
+    struct timespec req;
+    if(nap->tmms > 999) {
+        req.tv_sec = (int)(nap->tmms / 1000);                       /* Must be Non-Negative */
+        req.tv_nsec = (nap->tmms - ((long)req.tv_sec * 1000)) * NANO_SECOND_MULTIPLIER;
+    }
+    else {
+        req.tv_sec = 0;
+        req.tv_nsec = nap->tmms * NANO_SECOND_MULTIPLIER;
+    }
+    nap->ires = nanosleep(&req , NULL);
+    #endif
+}
+
+static void blocked_join(void *arg) {
+    PFRTWorker wrk = (PFRTWorker) arg;
+#ifdef _MSC_VER
+    WaitForSingleObject(wrk->thread_id, INFINITE);
+#else
+    pthread_join(wrk->thread_id, NULL);
+#endif
+}
+
 /*
     Sleeps for timeout milliseconds
 */
@@ -72,28 +110,14 @@ PFRTAny foidl_nap_bang(PFRTAny timeout) {
     PFRTAny res = nil;
     if(timeout->fclass == scalar_class &&
         timeout->ftype == number_type) {
-        ft  tmms = number_toft(timeout);
-        #ifdef _MSC_VER
-        Sleep(tmms);
-        res = zero;
-        #else
-        struct timespec req;
-        if(tmms > 999) {
-            req.tv_sec = (int)(tmms / 1000);                            /* Must be Non-Negative */
-            req.tv_nsec = (tmms - ((long)req.tv_sec * 1000)) * NANO_SECOND_MULTIPLIER;
-        }
-        else {
-            req.tv_sec = 0;
-            req.tv_nsec = tmms * NANO_SECOND_MULTIPLIER;
-        }
-        int ires = nanosleep(&req , NULL);
-        if(ires == 0) {
+        NapRequest  nap = {number_toft(timeout), 0};
+        foidl_gc_blocking(blocked_nap, &nap);
+        if(nap.ires == 0) {
             res = zero;
         }
         else {
-            res = foidl_reg_intnum(ires);
+            res = foidl_reg_intnum(nap.ires);
         }
-        #endif
     }
     else {
         unknown_handler();
@@ -117,6 +141,7 @@ static void *worker(void *arg)
 #endif
 {
     PFRTWorker wrk = (PFRTWorker) arg;
+    foidl_gc_register_thread();
     wrk->work_state = wrk_run;
     PFRTFuncRef2 iref = (PFRTFuncRef2) wrk->fnptr;
     PFRTAny res = (PFRTAny) iref;
@@ -134,9 +159,11 @@ static void *worker(void *arg)
                 unknown_handler();
             }
         }
-        foidl_xdel(itr);
+        iteratorRelease(itr);
     }
     wrk->result = res;
+    foidl_thread_cache_release();
+    foidl_gc_release_thread();
 #ifdef _MSC_VER
     ExitThread(0);
     return 0;
@@ -191,12 +218,8 @@ PFRTAny foidl_wait_bang(PFRTAny thrdref) {
         thrdref->ftype == worker_type) {
         PFRTWorker wrk = (PFRTWorker) thrdref;
         if(wrk->work_state != wrk_complete) {
-#ifdef _MSC_VER
-            WaitForSingleObject(wrk->thread_id, INFINITE);
+            foidl_gc_blocking(blocked_join, wrk);
             res = wrk->result;
-#else
-            pthread_join(wrk->thread_id, (void *) &res);
-#endif
             wrk->work_state = wrk_complete;
         }
         else {
@@ -258,7 +281,8 @@ static void create_pool_controls(PFRTThreadPool poolref) {
 #endif
 }
 
-static void lock_pool(PFRTThreadPool poolref) {
+static void blocked_lock_pool(void *arg) {
+    PFRTThreadPool poolref = (PFRTThreadPool) arg;
 #ifdef _MSC_VER
     WaitForSingleObject(poolref->pool_mutex,INFINITE);
 #else
@@ -266,6 +290,10 @@ static void lock_pool(PFRTThreadPool poolref) {
 #endif
 }
 
+static void lock_pool(PFRTThreadPool poolref) {
+    foidl_gc_blocking(blocked_lock_pool, poolref);
+}
+
 static void unlock_pool(PFRTThreadPool poolref) {
 #ifdef _MSC_VER
     ReleaseMutex(poolref->pool_mutex);
@@ -274,7 +302,8 @@ static void unlock_pool(PFRTThreadPool poolref) {
 #endif
 }
 
-static void lock_run(PFRTThreadPool poolref) {
+static void blocked_lock_run(void *arg) {
+    PFRTThreadPool poolref = (PFRTThreadPool) arg;
 #ifdef _MSC_VER
     EnterCriticalSection(&poolref->run_mutex);
 #else
@@ -282,6 +311,10 @@ static void lock_run(PFRTThreadPool poolref) {
 #endif
 }
 
+static void lock_run(PFRTThreadPool poolref) {
+    foidl_gc_blocking(blocked_lock_run, poolref);
+}
+
 static void unlock_run(PFRTThreadPool poolref) {
 #ifdef _MSC_VER
     LeaveCriticalSection(&poolref->run_mutex);
@@ -290,13 +323,18 @@ static void unlock_run(PFRTThreadPool poolref) {
 #endif
 }
 
-static void wait_for_work_to_run(PFRTThreadPool poolref) {
-    while(!poolref->work_list->count) {
+static void blocked_run_wait(void *arg) {
+    PFRTThreadPool poolref = (PFRTThreadPool) arg;
 #ifdef _MSC_VER
-        SleepConditionVariableCS(&poolref->run_condition, &poolref->run_mutex,INFINITE);
+    SleepConditionVariableCS(&poolref->run_condition, &poolref->run_mutex,INFINITE);
 #else
-        pthread_cond_wait(&poolref->run_condition, &poolref->run_mutex);
+    pthread_cond_wait(&poolref->run_condition, &poolref->run_mutex);
 #endif
+}
+
+static void wait_for_work_to_run(PFRTThreadPool poolref) {
+    while(!poolref->work_list->count) {
+        foidl_gc_blocking(blocked_run_wait, poolref);
     }
 }
 
@@ -416,6 +454,7 @@ static void *pool_worker(void *arg)
 {
     PFRTThread  pthrd = (PFRTThread) arg;
     PFRTThreadPool poolref = (PFRTThreadPool) pthrd->pool_parent;
+    foidl_gc_register_thread();
     lock_pool(poolref);
     poolref->active_threads++;
     pthrd->thread_state = pthrd_init;
@@ -459,7 +498,7 @@ static void *pool_worker(void *arg)
                         unknown_handler();
                     }
                 }
-                foidl_xdel(itr);
+                iteratorRelease(itr);
             }
             wrk->result = res;
             wrk->work_state = wrk_complete;
@@ -473,6 +512,8 @@ static void *pool_worker(void *arg)
     printf("    Thread %d ended\n", pthrd->thid);
     printf("Released shutdown lock\n");
     unlock_pool(poolref);
+    foidl_thread_cache_release();
+    foidl_gc_release_thread();
 #ifdef _MSC_VER
     ExitThread(0);
     return 0;
@@ -493,6 +534,16 @@ static PFRTThread create_pool_thread(PFRTThreadPool poolref, int id) {
 }
 
 
+static void await_active_threads(void *arg) {
+    PFRTThreadPool poolref = (PFRTThreadPool) arg;
+    while(poolref->count != poolref->active_threads) {}
+}
+
+static void await_ended_threads(void *arg) {
+    PFRTThreadPool poolref = (PFRTThreadPool) arg;
+    while(poolref->active_threads > 0) {;}
+}
+
 static PFRTThreadPool initialize_pool(PFRTThreadPool poolref) {
     create_pool_controls(poolref);
     for(ft x=0; x < poolref->count; ++x) {
@@ -500,7 +551,7 @@ static PFRTThreadPool initialize_pool(PFRTThreadPool poolref) {
         foidl_list_extend_bang(poolref->thread_list,(PFRTAny)pthrd);
     }
     unlock_pool(poolref);
-    while(poolref->count != poolref->active_threads) {}
+    foidl_gc_blocking(await_active_threads, poolref);
     poolref->pool_state = pool_running;
     return poolref;
 }
@@ -583,7 +634,7 @@ PFRTAny foidl_exit_thread_pool_bang(PFRTAny pool) {
             run_broadcast(poolref);
             unlock_run(poolref);
             printf("Posted shutdown, waiting for active thread kill\n");
-            while(poolref->active_threads > 0) {;}
+            foidl_gc_blocking(await_ended_threads, poolref);
             destroy_pool(poolref);
         }
         else {
@@ -625,7 +676,7 @@ PFRTAny     foidl_pool_thread_states(PFRTAny pool) {
             PFRTThread pthrd = (PFRTThread) iNext;
             foidl_list_extend_bang(tlist,pthrd->thread_state);
         }
-        foidl_xdel(itr);
+        iteratorRelease(itr);
         unlock_pool(poolref);
     }
     else {